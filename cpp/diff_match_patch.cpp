@@ -23,8 +23,159 @@
 #include <limits>
 // Code known to compile and run with Qt 4.3 through Qt 4.7.
 #include <QtCore>
+#include <string.h>
 #include <time.h>
 #include "diff_match_patch.h"
+#include "diff_match_patch_core.h"
+
+
+//////////////////////////
+//
+// %xx Escaping
+//
+//////////////////////////
+
+
+// ASCII characters which the patch and delta formats leave unescaped.
+// Same set as QUrl::toPercentEncoding(text, " !~*'();/?:@&=+$,#").
+static const bool UNESCAPED[128] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0x00
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0x10
+  1, 1, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  // 0x20
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1,  // 0x30
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  // 0x40
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 1,  // 0x50
+  0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  // 0x60
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 0   // 0x70
+};
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+
+/**
+ * Value of a hexadecimal digit.
+ * @param c Character
+ * @return Value from 0 to 15, or -1 if c is not a hex digit
+ */
+static inline int hexValue(ushort c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+
+/**
+ * Append one byte to a string in %xx notation.
+ * @param out String to append to
+ * @param c Byte to escape
+ */
+static inline void appendEscaped(QString &out, uchar c) {
+  out += QChar('%');
+  out += QChar(HEX_DIGITS[c >> 4]);
+  out += QChar(HEX_DIGITS[c & 0xF]);
+}
+
+
+/**
+ * Append text to a string, encoded as UTF-8 and escaped with %xx notation.
+ * Gives the same result as QUrl::toPercentEncoding(text, " !~*'();/?:@&=+$,#")
+ * but copies runs of unescaped characters in bulk, with no temporary
+ * QByteArray.
+ * @param out String to append to
+ * @param text Text to escape
+ */
+static void appendEncoded(QString &out, const QString &text) {
+  const ushort *chars = text.utf16();
+  const int length = text.length();
+  int i = 0;
+  while (i < length) {
+    int end = i;
+    while (end < length && chars[end] < 0x80 && UNESCAPED[chars[end]]) {
+      end++;
+    }
+    if (end != i) {
+      out += QString::fromRawData(text.unicode() + i, end - i);
+      i = end;
+      if (i == length) {
+        break;
+      }
+    }
+    uint u = chars[i];
+    if (u < 0x80) {
+      appendEscaped(out, static_cast<uchar>(u));
+    } else if (u < 0x800) {
+      appendEscaped(out, static_cast<uchar>(0xC0 | (u >> 6)));
+      appendEscaped(out, static_cast<uchar>(0x80 | (u & 0x3F)));
+    } else if ((u & 0xF800) != 0xD800) {
+      appendEscaped(out, static_cast<uchar>(0xE0 | (u >> 12)));
+      appendEscaped(out, static_cast<uchar>(0x80 | ((u >> 6) & 0x3F)));
+      appendEscaped(out, static_cast<uchar>(0x80 | (u & 0x3F)));
+    } else if (u < 0xDC00 && i + 1 < length
+        && (chars[i + 1] & 0xFC00) == 0xDC00) {
+      // Surrogate pair.
+      u = 0x10000 + ((u - 0xD800) << 10) + (chars[i + 1] - 0xDC00);
+      i++;
+      appendEscaped(out, static_cast<uchar>(0xF0 | (u >> 18)));
+      appendEscaped(out, static_cast<uchar>(0x80 | ((u >> 12) & 0x3F)));
+      appendEscaped(out, static_cast<uchar>(0x80 | ((u >> 6) & 0x3F)));
+      appendEscaped(out, static_cast<uchar>(0x80 | (u & 0x3F)));
+    } else {
+      // Unpaired surrogate, encode it the way QString does.
+      const QByteArray utf8 = QString(QChar(static_cast<ushort>(u))).toUtf8();
+      for (int j = 0; j < utf8.size(); j++) {
+        appendEscaped(out, static_cast<uchar>(utf8[j]));
+      }
+    }
+    i++;
+  }
+}
+
+
+/**
+ * Decode text escaped with %xx notation.  Unlike QUrl::fromPercentEncoding()
+ * characters outside ASCII may appear unescaped, '+' is left alone and
+ * malformed escapes are rejected.
+ * @param text Text to decode
+ * @return Decoded text
+ * @throws QString If an escape is malformed
+ */
+static QString decodeEscapes(const QString &text) {
+  int i = text.indexOf(QChar('%'));
+  if (i == -1) {
+    // Nothing to unescape (speedup).
+    return text;
+  }
+  const ushort *chars = text.utf16();
+  const int length = text.length();
+  QString out = text.left(i);
+  QByteArray bytes;
+  while (i < length) {
+    // Decode consecutive escapes together, one character may span several.
+    bytes.truncate(0);
+    while (i < length && chars[i] == '%') {
+      const int high = i + 2 < length ? hexValue(chars[i + 1]) : -1;
+      const int low = i + 2 < length ? hexValue(chars[i + 2]) : -1;
+      if (high == -1 || low == -1) {
+        throw QString("Invalid escape in: %1").arg(text);
+      }
+      bytes.append(static_cast<char>(high * 16 + low));
+      i += 3;
+    }
+    out += QString::fromUtf8(bytes.constData(), bytes.size());
+    int end = text.indexOf(QChar('%'), i);
+    if (end == -1) {
+      end = length;
+    }
+    out += QString::fromRawData(text.unicode() + i, end - i);
+    i = end;
+  }
+  return out;
+}
 
 
 //////////////////////////
@@ -150,8 +301,8 @@ QString Patch::toString() {
         text += QString(' ');
         break;
     }
-    text += QString(QUrl::toPercentEncoding(aDiff.text, " !~*'();/?:@&=+$,#"))
-        + QString("\n");
+    appendEncoded(text, aDiff.text);
+    text += QChar('\n');
   }
 
   return text;
@@ -160,349 +311,2741 @@ QString Patch::toString() {
 
 /////////////////////////////////////////////
 //
-// diff_match_patch Class
+// DiffIndex Class
 //
 /////////////////////////////////////////////
 
-diff_match_patch::diff_match_patch() :
-  Diff_Timeout(1.0f),
-  Diff_EditCost(4),
-  Match_Threshold(0.5f),
-  Match_Distance(1000),
-  Patch_DeleteThreshold(0.5f),
-  Patch_Margin(4),
-  Match_MaxBits(32) {
+
+/**
+ * Constructor.  Computes the cumulative offsets of the provided diffs.
+ * @param diffs LinkedList of Diff objects
+ */
+DiffIndex::DiffIndex(const QList<Diff> &diffs) :
+  ends1(diffs.size()), ends2(diffs.size()), deleted(diffs.size()) {
+  int chars1 = 0;
+  int chars2 = 0;
+  for (int i = 0; i < diffs.size(); i++) {
+    const Diff &aDiff = diffs.at(i);
+    if (aDiff.operation != INSERT) {
+      // Equality or deletion.
+      chars1 += aDiff.text.length();
+    }
+    if (aDiff.operation != DELETE) {
+      // Equality or insertion.
+      chars2 += aDiff.text.length();
+    }
+    ends1[i] = chars1;
+    ends2[i] = chars2;
+    deleted[i] = (aDiff.operation == DELETE);
+  }
 }
 
 
-QList<Diff> diff_match_patch::diff_main(const QString &text1,
-                                        const QString &text2) {
-  return diff_main(text1, text2, true);
+/**
+ * loc is a location in text1, compute and return the equivalent location in
+ * text2.
+ * @param loc Location within text1
+ * @return Location within text2
+ */
+int DiffIndex::xIndex(int loc) const {
+  // Find the first diff which overshoots the location.  ends1 never
+  // decreases, so this is the same diff that diff_xIndex would stop at.
+  const int i = std::upper_bound(ends1.constBegin(), ends1.constEnd(), loc)
+      - ends1.constBegin();
+  const int last_chars1 = (i == 0) ? 0 : ends1[i - 1];
+  const int last_chars2 = (i == 0) ? 0 : ends2[i - 1];
+  if (i < deleted.size() && deleted[i]) {
+    // The location was deleted.
+    return last_chars2;
+  }
+  // Add the remaining character length.
+  return last_chars2 + (loc - last_chars1);
 }
 
-QList<Diff> diff_match_patch::diff_main(const QString &text1,
-    const QString &text2, bool checklines) {
-  // Set a deadline by which time the diff must be complete.
-  clock_t deadline;
-  if (Diff_Timeout <= 0) {
-    deadline = std::numeric_limits<clock_t>::max();
-  } else {
-    deadline = clock() + (clock_t)(Diff_Timeout * CLOCKS_PER_SEC);
-  }
-  return diff_main(text1, text2, checklines, deadline);
+
+/////////////////////////////////////////////
+//
+// DiffMove Class
+//
+/////////////////////////////////////////////
+
+
+DiffMove::DiffMove(int _index1, int _index2, int _length) :
+  index1(_index1), index2(_index2), length(_length) {
+  // Construct a move with the specified positions and length.
 }
 
-QList<Diff> diff_match_patch::diff_main(const QString &text1,
-    const QString &text2, bool checklines, clock_t deadline) {
-  // Check for null inputs.
-  if (text1.isNull() || text2.isNull()) {
-    throw "Null inputs. (diff_main)";
-  }
+DiffMove::DiffMove() : index1(0), index2(0), length(0) {
+}
 
-  // Check for equality (speedup).
-  QList<Diff> diffs;
-  if (text1 == text2) {
-    if (!text1.isEmpty()) {
-      diffs.append(Diff(EQUAL, text1));
+
+/**
+ * Display a human-readable version of this DiffMove.
+ * @return text version
+ */
+QString DiffMove::toString() const {
+  return QString("DiffMove(%1,%2,%3)").arg(index1).arg(index2).arg(length);
+}
+
+/**
+ * Is this DiffMove equivalent to another DiffMove?
+ * @param m Another DiffMove to compare against
+ * @return true or false
+ */
+bool DiffMove::operator==(const DiffMove &m) const {
+  return m.index1 == index1 && m.index2 == index2 && m.length == length;
+}
+
+bool DiffMove::operator!=(const DiffMove &m) const {
+  return !(operator == (m));
+}
+
+
+/////////////////////////////////////////////
+//
+// PatchReader Class
+//
+/////////////////////////////////////////////
+
+
+/**
+ * Parse a (possibly empty) run of decimal digits.
+ * @param line Text to parse
+ * @param length Length of line
+ * @param i Offset to start parsing at, advanced past the digits
+ * @param value Set to the value of the digits
+ * @return Number of digits parsed, or -1 on overflow
+ */
+static int parseDigits(const char *line, int length, int &i, int &value) {
+  const int start = i;
+  value = 0;
+  while (i < length && line[i] >= '0' && line[i] <= '9') {
+    if (value > (std::numeric_limits<int>::max() - 9) / 10) {
+      return -1;
     }
-    return diffs;
+    value = value * 10 + (line[i] - '0');
+    i++;
   }
+  return i - start;
+}
+
+
+/**
+ * Constructor.  Reads the patch text incrementally from a device.
+ * @param device Open device positioned at the start of the patch text
+ */
+PatchReader::PatchReader(QIODevice *_device) :
+  device(_device), pos(0), lineStart(0), lineLength(0), pending(false) {
+}
+
+
+/**
+ * Constructor.  Reads the patch text from memory.
+ * @param data UTF-8 encoded patch text
+ */
+PatchReader::PatchReader(const QByteArray &data) :
+  device(NULL), buffer(data), pos(0), lineStart(0), lineLength(0),
+  pending(false) {
+}
 
-  // Trim off common prefix (speedup).
-  int commonlength = diff_commonPrefix(text1, text2);
-  const QString &commonprefix = text1.left(commonlength);
-  QString textChopped1 = text1.mid(commonlength);
-  QString textChopped2 = text2.mid(commonlength);
 
-  // Trim off common suffix (speedup).
-  commonlength = diff_commonSuffix(textChopped1, textChopped2);
-  const QString &commonsuffix = textChopped1.right(commonlength);
-  textChopped1 = textChopped1.left(textChopped1.length() - commonlength);
-  textChopped2 = textChopped2.left(textChopped2.length() - commonlength);
+bool PatchReader::readPatch(Patch &patch) {
+  if (!nextLine()) {
+    return false;
+  }
+  patch = Patch();
+  parseHeader(patch);
+
+  while (nextLine()) {
+    const char sign = buffer.at(lineStart);
+    if (sign == '@') {
+      // Start of next patch.
+      pending = true;
+      break;
+    }
+    const QString line = decodeLine(1);
+    if (sign == '-') {
+      // Deletion.
+      patch.diffs.append(Diff(DELETE, line));
+    } else if (sign == '+') {
+      // Insertion.
+      patch.diffs.append(Diff(INSERT, line));
+    } else if (sign == ' ') {
+      // Minor equality.
+      patch.diffs.append(Diff(EQUAL, line));
+    } else {
+      throw QString("Invalid patch mode '%1' in: %2").arg(sign).arg(line);
+    }
+  }
+  return true;
+}
 
-  // Compute the diff on the middle block.
-  diffs = diff_compute(textChopped1, textChopped2, checklines, deadline);
 
-  // Restore the prefix and suffix.
-  if (!commonprefix.isEmpty()) {
-    diffs.prepend(Diff(EQUAL, commonprefix));
+bool PatchReader::nextLine() {
+  if (pending) {
+    pending = false;
+    return true;
   }
-  if (!commonsuffix.isEmpty()) {
-    diffs.append(Diff(EQUAL, commonsuffix));
+  int from = pos;  // Bytes before this are known to contain no newline.
+  while (true) {
+    const char *data = buffer.constData();
+    const int size = buffer.size();
+    const char *newline = static_cast<const char *>(
+        memchr(data + from, '\n', size - from));
+    int end;
+    if (newline != NULL) {
+      end = newline - data;
+    } else {
+      const int scanned = size - pos;
+      if (readMore()) {
+        from = pos + scanned;
+        continue;
+      }
+      if (pos == buffer.size()) {
+        return false;
+      }
+      // Last line has no trailing newline.
+      end = buffer.size();
+    }
+    lineStart = pos;
+    lineLength = end - pos;
+    pos = std::min(end + 1, buffer.size());
+    from = pos;
+    if (lineLength > 0) {
+      // Blank lines are skipped.
+      return true;
+    }
   }
+}
 
-  diff_cleanupMerge(diffs);
 
-  return diffs;
+bool PatchReader::readMore() {
+  if (device == NULL) {
+    return false;
+  }
+  const int chunkSize = 64 * 1024;
+  if (pos > 0) {
+    buffer.remove(0, pos);
+    pos = 0;
+  }
+  const int size = buffer.size();
+  buffer.resize(size + chunkSize);
+  qint64 count = device->read(buffer.data() + size, chunkSize);
+  while (count == 0 && device->isSequential()
+      && device->waitForReadyRead(-1)) {
+    count = device->read(buffer.data() + size, chunkSize);
+  }
+  if (count < 0) {
+    // A failed read must not pass for the end of a shorter patch list.
+    buffer.resize(size);
+    throw QString("Unable to read patch: %1").arg(device->errorString());
+  }
+  buffer.resize(size + static_cast<int>(count));
+  return count > 0;
 }
 
 
-QList<Diff> diff_match_patch::diff_compute(QString text1, QString text2,
-    bool checklines, clock_t deadline) {
-  QList<Diff> diffs;
+void PatchReader::parseHeader(Patch &patch) {
+  // Equivalent to "^@@ -(\\d+),?(\\d*) \\+(\\d+),?(\\d*) @@$".
+  const char *line = buffer.constData() + lineStart;
+  const int length = lineLength;
+  int i = 0;
+  int start1, len1, start2, len2;
+  int digits1, digits2;
+  bool valid = length >= 4 && memcmp(line, "@@ -", 4) == 0;
+  if (valid) {
+    i = 4;
+    valid = parseDigits(line, length, i, start1) > 0;
+  }
+  if (valid) {
+    if (i < length && line[i] == ',') {
+      i++;
+    }
+    digits1 = parseDigits(line, length, i, len1);
+    valid = digits1 >= 0 && i + 2 <= length && memcmp(line + i, " +", 2) == 0;
+  }
+  if (valid) {
+    i += 2;
+    valid = parseDigits(line, length, i, start2) > 0;
+  }
+  if (valid) {
+    if (i < length && line[i] == ',') {
+      i++;
+    }
+    digits2 = parseDigits(line, length, i, len2);
+    valid = digits2 >= 0 && i + 3 == length && memcmp(line + i, " @@", 3) == 0;
+  }
+  if (!valid) {
+    throw QString("Invalid patch string: %1")
+        .arg(QString::fromUtf8(line, length));
+  }
 
-  if (text1.isEmpty()) {
-    // Just add some text (speedup).
-    diffs.append(Diff(INSERT, text2));
-    return diffs;
+  patch.start1 = start1;
+  if (digits1 == 0) {
+    patch.start1--;
+    patch.length1 = 1;
+  } else if (digits1 == 1 && len1 == 0) {
+    patch.length1 = 0;
+  } else {
+    patch.start1--;
+    patch.length1 = len1;
   }
 
-  if (text2.isEmpty()) {
-    // Just delete some text (speedup).
-    diffs.append(Diff(DELETE, text1));
-    return diffs;
+  patch.start2 = start2;
+  if (digits2 == 0) {
+    patch.start2--;
+    patch.length2 = 1;
+  } else if (digits2 == 1 && len2 == 0) {
+    patch.length2 = 0;
+  } else {
+    patch.start2--;
+    patch.length2 = len2;
   }
+}
 
-  {
-    const QString longtext = text1.length() > text2.length() ? text1 : text2;
-    const QString shorttext = text1.length() > text2.length() ? text2 : text1;
-    const int i = longtext.indexOf(shorttext);
-    if (i != -1) {
-      // Shorter text is inside the longer text (speedup).
-      const Operation op = (text1.length() > text2.length()) ? DELETE : INSERT;
-      diffs.append(Diff(op, longtext.left(i)));
-      diffs.append(Diff(EQUAL, shorttext));
-      diffs.append(Diff(op, safeMid(longtext, i + shorttext.length())));
-      return diffs;
-    }
 
-    if (shorttext.length() == 1) {
-      // Single character string.
-      // After the previous speedup, the character can't be an equality.
-      diffs.append(Diff(DELETE, text1));
-      diffs.append(Diff(INSERT, text2));
-      return diffs;
+QString PatchReader::decodeLine(int from) {
+  const char *line = buffer.constData() + lineStart;
+  const int length = lineLength;
+  if (memchr(line + from, '%', length - from) == NULL) {
+    // Nothing to unescape (speedup).
+    return QString::fromUtf8(line + from, length - from);
+  }
+  scratch.resize(length - from);
+  char *out = scratch.data();
+  int count = 0;
+  for (int i = from; i < length; i++) {
+    if (line[i] != '%') {
+      out[count++] = line[i];
+      continue;
     }
-    // Garbage collect longtext and shorttext by scoping out.
-  }
-
-  // Check to see if the problem can be split in two.
-  const QStringList hm = diff_halfMatch(text1, text2);
-  if (hm.count() > 0) {
-    // A half-match was found, sort out the return data.
-    const QString text1_a = hm[0];
-    const QString text1_b = hm[1];
-    const QString text2_a = hm[2];
-    const QString text2_b = hm[3];
-    const QString mid_common = hm[4];
-    // Send both pairs off for separate processing.
-    const QList<Diff> diffs_a = diff_main(text1_a, text2_a,
-                                          checklines, deadline);
-    const QList<Diff> diffs_b = diff_main(text1_b, text2_b,
-                                          checklines, deadline);
-    // Merge the results.
-    diffs = diffs_a;
-    diffs.append(Diff(EQUAL, mid_common));
-    diffs += diffs_b;
-    return diffs;
-  }
-
-  // Perform a real diff.
-  if (checklines && text1.length() > 100 && text2.length() > 100) {
-    return diff_lineMode(text1, text2, deadline);
+    const int high = i + 2 < length ? hexValue(static_cast<uchar>(line[i + 1])) : -1;
+    const int low = i + 2 < length ? hexValue(static_cast<uchar>(line[i + 2])) : -1;
+    if (high == -1 || low == -1) {
+      throw QString("Invalid escape in patch: %1")
+          .arg(QString::fromUtf8(line, length));
+    }
+    out[count++] = static_cast<char>(high * 16 + low);
+    i += 2;
   }
-
-  return diff_bisect(text1, text2, deadline);
+  return QString::fromUtf8(out, count);
 }
 
 
-QList<Diff> diff_match_patch::diff_lineMode(QString text1, QString text2,
-    clock_t deadline) {
-  // Scan the text on a line-by-line basis first.
-  const QList<QVariant> b = diff_linesToChars(text1, text2);
-  text1 = b[0].toString();
-  text2 = b[1].toString();
-  QStringList linearray = b[2].toStringList();
+/////////////////////////////////////////////
+//
+// PatchWriter Class
+//
+/////////////////////////////////////////////
 
-  QList<Diff> diffs = diff_main(text1, text2, false, deadline);
 
-  // Convert the diff back to original text.
-  diff_charsToLines(diffs, linearray);
-  // Eliminate freak matches (e.g. blank lines)
-  diff_cleanupSemantic(diffs);
+/**
+ * Constructor.
+ * @param device Open device to write to
+ */
+PatchWriter::PatchWriter(QIODevice *_device) :
+  device(_device), buffer(64 * 1024, '\0'), used(0), deltaStarted(false) {
+  data = buffer.data();
+}
 
-  // Rediff any replacement blocks, this time character-by-character.
-  // Add a dummy entry at the end.
-  diffs.append(Diff(EQUAL, ""));
-  int count_delete = 0;
-  int count_insert = 0;
-  QString text_delete = "";
-  QString text_insert = "";
 
-  QMutableListIterator<Diff> pointer(diffs);
-  Diff *thisDiff = pointer.hasNext() ? &pointer.next() : NULL;
-  while (thisDiff != NULL) {
-    switch (thisDiff->operation) {
+PatchWriter::~PatchWriter() {
+  try {
+    flush();
+  } catch (QString) {
+    // Don't throw out of a destructor.  Call flush() to catch errors.
+  }
+}
+
+
+void PatchWriter::writePatch(const Patch &patch) {
+  // Header: @@ -382,8 +481,9 @@
+  // Indicies are printed as 1-based, not 0-based.
+  put('@');
+  put('@');
+  put(' ');
+  put('-');
+  if (patch.length1 == 0) {
+    putNumber(patch.start1);
+    put(',');
+    put('0');
+  } else {
+    putNumber(patch.start1 + 1);
+    if (patch.length1 != 1) {
+      put(',');
+      putNumber(patch.length1);
+    }
+  }
+  put(' ');
+  put('+');
+  if (patch.length2 == 0) {
+    putNumber(patch.start2);
+    put(',');
+    put('0');
+  } else {
+    putNumber(patch.start2 + 1);
+    if (patch.length2 != 1) {
+      put(',');
+      putNumber(patch.length2);
+    }
+  }
+  put(' ');
+  put('@');
+  put('@');
+  put('\n');
+  // Escape the body of the patch with %xx notation.
+  foreach (const Diff &aDiff, patch.diffs) {
+    switch (aDiff.operation) {
       case INSERT:
-        count_insert++;
-        text_insert += thisDiff->text;
+        put('+');
         break;
       case DELETE:
-        count_delete++;
-        text_delete += thisDiff->text;
+        put('-');
         break;
       case EQUAL:
-        // Upon reaching an equality, check for prior redundancies.
-        if (count_delete >= 1 && count_insert >= 1) {
-          // Delete the offending records and add the merged ones.
-          pointer.previous();
-          for (int j = 0; j < count_delete + count_insert; j++) {
-            pointer.previous();
-            pointer.remove();
-          }
-          foreach(Diff newDiff,
-              diff_main(text_delete, text_insert, false, deadline)) {
-            pointer.insert(newDiff);
-          }
-        }
-        count_insert = 0;
-        count_delete = 0;
-        text_delete = "";
-        text_insert = "";
+        put(' ');
         break;
     }
-    thisDiff = pointer.hasNext() ? &pointer.next() : NULL;
+    putText(aDiff.text);
+    put('\n');
   }
-  diffs.removeLast();  // Remove the dummy entry at the end.
-
-  return diffs;
 }
 
 
-QList<Diff> diff_match_patch::diff_bisect(const QString &text1,
-    const QString &text2, clock_t deadline) {
-  // Cache the text lengths to prevent multiple calls.
-  const int text1_length = text1.length();
-  const int text2_length = text2.length();
-  const int max_d = (text1_length + text2_length + 1) / 2;
-  const int v_offset = max_d;
-  const int v_length = 2 * max_d;
-  int *v1 = new int[v_length];
-  int *v2 = new int[v_length];
-  for (int x = 0; x < v_length; x++) {
-    v1[x] = -1;
-    v2[x] = -1;
-  }
-  v1[v_offset + 1] = 0;
-  v2[v_offset + 1] = 0;
-  const int delta = text1_length - text2_length;
-  // If the total number of characters is odd, then the front path will
-  // collide with the reverse path.
-  const bool front = (delta % 2 != 0);
-  // Offsets for start and end of k loop.
-  // Prevents mapping of space beyond the grid.
-  int k1start = 0;
-  int k1end = 0;
-  int k2start = 0;
-  int k2end = 0;
-  for (int d = 0; d < max_d; d++) {
-    // Bail out if deadline is reached.
-    if (clock() > deadline) {
-      break;
+void PatchWriter::writeDelta(const QList<Diff> &diffs) {
+  deltaStarted = false;
+  foreach (const Diff &aDiff, diffs) {
+    if (aDiff.operation == INSERT) {
+      writeDeltaText(aDiff.text);
+    } else {
+      writeDeltaLength(aDiff.operation, aDiff.text.length());
     }
+  }
+}
 
-    // Walk the front path one step.
-    for (int k1 = -d + k1start; k1 <= d - k1end; k1 += 2) {
-      const int k1_offset = v_offset + k1;
-      int x1;
-      if (k1 == -d || (k1 != d && v1[k1_offset - 1] < v1[k1_offset + 1])) {
-        x1 = v1[k1_offset + 1];
-      } else {
-        x1 = v1[k1_offset - 1] + 1;
-      }
-      int y1 = x1 - k1;
-      while (x1 < text1_length && y1 < text2_length
-          && text1[x1] == text2[y1]) {
-        x1++;
-        y1++;
-      }
-      v1[k1_offset] = x1;
-      if (x1 > text1_length) {
-        // Ran off the right of the graph.
-        k1end += 2;
-      } else if (y1 > text2_length) {
-        // Ran off the bottom of the graph.
-        k1start += 2;
-      } else if (front) {
-        int k2_offset = v_offset + delta - k1;
-        if (k2_offset >= 0 && k2_offset < v_length && v2[k2_offset] != -1) {
-          // Mirror x2 onto top-left coordinate system.
-          int x2 = text1_length - v2[k2_offset];
-          if (x1 >= x2) {
-            // Overlap detected.
-            delete [] v1;
-            delete [] v2;
-            return diff_bisectSplit(text1, text2, x1, y1, deadline);
-          }
-        }
-      }
-    }
 
-    // Walk the reverse path one step.
-    for (int k2 = -d + k2start; k2 <= d - k2end; k2 += 2) {
-      const int k2_offset = v_offset + k2;
-      int x2;
-      if (k2 == -d || (k2 != d && v2[k2_offset - 1] < v2[k2_offset + 1])) {
-        x2 = v2[k2_offset + 1];
-      } else {
-        x2 = v2[k2_offset - 1] + 1;
-      }
-      int y2 = x2 - k2;
-      while (x2 < text1_length && y2 < text2_length
-          && text1[text1_length - x2 - 1] == text2[text2_length - y2 - 1]) {
-        x2++;
-        y2++;
-      }
-      v2[k2_offset] = x2;
-      if (x2 > text1_length) {
-        // Ran off the left of the graph.
-        k2end += 2;
-      } else if (y2 > text2_length) {
-        // Ran off the top of the graph.
-        k2start += 2;
-      } else if (!front) {
-        int k1_offset = v_offset + delta - k2;
-        if (k1_offset >= 0 && k1_offset < v_length && v1[k1_offset] != -1) {
-          int x1 = v1[k1_offset];
-          int y1 = v_offset + x1 - k1_offset;
-          // Mirror x2 onto top-left coordinate system.
-          x2 = text1_length - x2;
-          if (x1 >= x2) {
-            // Overlap detected.
-            delete [] v1;
-            delete [] v2;
-            return diff_bisectSplit(text1, text2, x1, y1, deadline);
-          }
-        }
-      }
+void PatchWriter::writeDeltaLength(Operation op, qint64 length) {
+  putDeltaSeparator();
+  put(op == EQUAL ? '=' : '-');
+  putNumber(length);
+}
+
+
+void PatchWriter::writeDeltaText(const QString &text) {
+  putDeltaSeparator();
+  put('+');
+  putText(text);
+}
+
+
+void PatchWriter::writeDeltaText(const char *data, qint64 length) {
+  putDeltaSeparator();
+  put('+');
+  for (qint64 i = 0; i < length; i++) {
+    putEncoded(static_cast<uchar>(data[i]));
+  }
+}
+
+
+void PatchWriter::flush() {
+  int written = 0;
+  while (written < used) {
+    const qint64 count = device->write(data + written, used - written);
+    if (count <= 0) {
+      used = 0;
+      throw QString("Unable to write patch: %1").arg(device->errorString());
     }
+    written += static_cast<int>(count);
   }
-  delete [] v1;
-  delete [] v2;
-  // Diff took too long and hit the deadline or
-  // number of diffs equals number of characters, no commonality at all.
-  QList<Diff> diffs;
-  diffs.append(Diff(DELETE, text1));
-  diffs.append(Diff(INSERT, text2));
-  return diffs;
+  used = 0;
+}
+
+
+void PatchWriter::putNumber(qint64 n) {
+  char digits[24];
+  int count = 0;
+  quint64 u = (n < 0) ? 0u - static_cast<quint64>(n) : n;
+  do {
+    digits[count++] = static_cast<char>('0' + u % 10);
+    u /= 10;
+  } while (u != 0);
+  if (n < 0) {
+    put('-');
+  }
+  while (count > 0) {
+    put(digits[--count]);
+  }
+}
+
+
+void PatchWriter::putEncoded(uchar c) {
+  if (c < 0x80 && UNESCAPED[c]) {
+    put(static_cast<char>(c));
+  } else {
+    put('%');
+    put(HEX_DIGITS[c >> 4]);
+    put(HEX_DIGITS[c & 0xF]);
+  }
+}
+
+
+void PatchWriter::putText(const QString &text) {
+  const ushort *chars = text.utf16();
+  const int length = text.length();
+  for (int i = 0; i < length; i++) {
+    uint u = chars[i];
+    if (u < 0x80) {
+      putEncoded(static_cast<uchar>(u));
+    } else if (u < 0x800) {
+      putEncoded(static_cast<uchar>(0xC0 | (u >> 6)));
+      putEncoded(static_cast<uchar>(0x80 | (u & 0x3F)));
+    } else if ((u & 0xF800) != 0xD800) {
+      putEncoded(static_cast<uchar>(0xE0 | (u >> 12)));
+      putEncoded(static_cast<uchar>(0x80 | ((u >> 6) & 0x3F)));
+      putEncoded(static_cast<uchar>(0x80 | (u & 0x3F)));
+    } else if ((u & 0xFC00) == 0xD800 && i + 1 < length
+        && (chars[i + 1] & 0xFC00) == 0xDC00) {
+      // Surrogate pair.
+      u = 0x10000 + ((u - 0xD800) << 10) + (chars[i + 1] - 0xDC00);
+      i++;
+      putEncoded(static_cast<uchar>(0xF0 | (u >> 18)));
+      putEncoded(static_cast<uchar>(0x80 | ((u >> 12) & 0x3F)));
+      putEncoded(static_cast<uchar>(0x80 | ((u >> 6) & 0x3F)));
+      putEncoded(static_cast<uchar>(0x80 | (u & 0x3F)));
+    } else {
+      // Unpaired surrogate, encode it however QString does.
+      const QByteArray utf8 = QString(QChar(static_cast<ushort>(u))).toUtf8();
+      for (int j = 0; j < utf8.size(); j++) {
+        putEncoded(static_cast<uchar>(utf8[j]));
+      }
+    }
+  }
+}
+
+
+/////////////////////////////////////////////
+//
+// Binary Patch Format
+//
+/////////////////////////////////////////////
+
+// Every binary patch list or delta starts with:
+//   "DMP", a version byte, a type byte ('P' or 'D') and a flags byte,
+//   followed by a 4 byte big-endian checksum if BINARY_CHECKSUM is set.
+// A patch list is then a sequence of:
+//   zigzag(start1 - previous start1), zigzag(start2 - start1), length1,
+//   length2, number of diffs, then per diff:
+//     (byte length << 2 | operation) and the UTF-8 text.
+// A delta is a sequence of:
+//   (character count << 2 | operation) for equalities and deletions,
+//   (byte length << 2 | operation) and the UTF-8 text for insertions.
+// All integers are unsigned LEB128 varints.
+static const char BINARY_VERSION = 1;
+static const char BINARY_PATCHES = 'P';
+static const char BINARY_DELTA = 'D';
+static const char BINARY_CHECKSUM = 0x01;
+
+
+/**
+ * Continue a 32 bit FNV-1a hash over the UTF-16 code units of some text.
+ * @param hash Hash so far (2166136261 to start)
+ * @param text Text to add to the hash
+ * @return Updated hash
+ */
+static quint32 binaryChecksum(quint32 hash, const QString &text) {
+  const ushort *chars = text.utf16();
+  const int length = text.length();
+  for (int i = 0; i < length; i++) {
+    hash = (hash ^ (chars[i] & 0xFF)) * 16777619u;
+    hash = (hash ^ (chars[i] >> 8)) * 16777619u;
+  }
+  return hash;
+}
+
+
+static void binaryAppendVarint(QByteArray &out, quint32 n) {
+  while (n >= 0x80) {
+    out.append(static_cast<char>((n & 0x7F) | 0x80));
+    n >>= 7;
+  }
+  out.append(static_cast<char>(n));
+}
+
+
+// Largest length which fits in a tag beside its operation.
+static const quint32 BINARY_MAX_LENGTH = 0x3FFFFFFF;
+
+static void binaryAppendTag(QByteArray &out, int length, Operation op) {
+  if (static_cast<quint32>(length) > BINARY_MAX_LENGTH) {
+    throw QString("Diff too large for the binary format: %1").arg(length);
+  }
+  binaryAppendVarint(out, (static_cast<quint32>(length) << 2) | op);
+}
+
+
+static inline quint32 binaryZigzag(int n) {
+  return (static_cast<quint32>(n) << 1) ^ static_cast<quint32>(n >> 31);
+}
+
+
+static inline int binaryUnzigzag(quint32 n) {
+  return static_cast<int>(n >> 1) ^ -static_cast<int>(n & 1);
+}
+
+
+static void binaryAppendText(QByteArray &out, Operation op,
+                             const QString &text) {
+  const QByteArray utf8 = text.toUtf8();
+  binaryAppendTag(out, utf8.size(), op);
+  out.append(utf8);
+}
+
+
+static void binaryAppendHeader(QByteArray &out, char type, bool checksum,
+                               quint32 hash) {
+  out.append("DMP");
+  out.append(BINARY_VERSION);
+  out.append(type);
+  out.append(checksum ? BINARY_CHECKSUM : '\0');
+  if (checksum) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+      out.append(static_cast<char>((hash >> shift) & 0xFF));
+    }
+  }
+}
+
+
+static void binaryAppendPatches(QByteArray &out, const QList<Patch> &patches) {
+  int start1 = 0;
+  foreach(const Patch &aPatch, patches) {
+    binaryAppendVarint(out, binaryZigzag(aPatch.start1 - start1));
+    binaryAppendVarint(out, binaryZigzag(aPatch.start2 - aPatch.start1));
+    binaryAppendVarint(out, aPatch.length1);
+    binaryAppendVarint(out, aPatch.length2);
+    binaryAppendVarint(out, aPatch.diffs.size());
+    foreach(const Diff &aDiff, aPatch.diffs) {
+      binaryAppendText(out, aDiff.operation, aDiff.text);
+    }
+    start1 = aPatch.start1;
+  }
+}
+
+
+static quint32 binaryReadVarint(const char *&pos, const char *end) {
+  quint32 n = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (pos == end) {
+      throw QString("Truncated binary patch.");
+    }
+    const uchar c = static_cast<uchar>(*pos++);
+    if (shift == 28 && c > 0x0F) {
+      // The fifth byte holds the top four bits and ends the varint.
+      break;
+    }
+    n |= static_cast<quint32>(c & 0x7F) << shift;
+    if ((c & 0x80) == 0) {
+      return n;
+    }
+  }
+  throw QString("Invalid varint in binary patch.");
+}
+
+
+/**
+ * Read a varint which must fit in an int.
+ * @param pos Position of the varint, advanced past it
+ * @param end End of the data
+ * @return The value
+ */
+static int binaryReadInt(const char *&pos, const char *end) {
+  const quint32 n = binaryReadVarint(pos, end);
+  if (n > static_cast<quint32>(std::numeric_limits<int>::max())) {
+    throw QString("Value out of range in binary patch: %1").arg(n);
+  }
+  return static_cast<int>(n);
+}
+
+
+/**
+ * Add a zigzag-encoded offset to a position, which must stay within an int.
+ * @param base Position to start from
+ * @param pos Position of the varint, advanced past it
+ * @param end End of the data
+ * @return The new position
+ */
+static int binaryReadOffset(int base, const char *&pos, const char *end) {
+  const qint64 n = static_cast<qint64>(base)
+      + binaryUnzigzag(binaryReadVarint(pos, end));
+  if (n < 0 || n > std::numeric_limits<int>::max()) {
+    throw QString("Value out of range in binary patch: %1").arg(n);
+  }
+  return static_cast<int>(n);
+}
+
+
+static Diff binaryReadText(const char *&pos, const char *end) {
+  const quint32 tag = binaryReadVarint(pos, end);
+  const quint32 length = tag >> 2;
+  if ((tag & 3) > EQUAL) {
+    throw QString("Invalid diff operation in binary patch: %1").arg(tag & 3);
+  }
+  if (length > static_cast<quint32>(end - pos)) {
+    throw QString("Truncated binary patch.");
+  }
+  const QString text = QString::fromUtf8(pos, length);
+  pos += length;
+  return Diff(static_cast<Operation>(tag & 3), text);
+}
+
+
+/**
+ * Check the header of a binary patch list or delta.
+ * @param pos Start of the data, advanced past the header
+ * @param end End of the data
+ * @param type Expected type byte
+ * @param hash Set to the stored checksum, if any
+ * @return True if a checksum was stored
+ */
+static bool binaryReadHeader(const char *&pos, const char *end, char type,
+                             quint32 &hash) {
+  if (end - pos < 6 || memcmp(pos, "DMP", 3) != 0 || pos[4] != type) {
+    throw QString("Not a binary patch.");
+  }
+  if (pos[3] != BINARY_VERSION) {
+    throw QString("Unsupported binary patch version: %1")
+        .arg(static_cast<int>(pos[3]));
+  }
+  const bool checksum = (pos[5] & BINARY_CHECKSUM) != 0;
+  pos += 6;
+  hash = 0;
+  if (checksum) {
+    if (end - pos < 4) {
+      throw QString("Truncated binary patch.");
+    }
+    for (int i = 0; i < 4; i++) {
+      hash = (hash << 8) | static_cast<uchar>(*pos++);
+    }
+  }
+  return checksum;
+}
+
+
+/////////////////////////////////////////////
+//
+// Mapped Files
+//
+/////////////////////////////////////////////
+
+
+/**
+ * Open a file and map all of it into memory.  The mapping lasts until the
+ * file is closed.
+ * @param file File to map.
+ * @param length Set to the length of the file.
+ * @return Contents of the file, or NULL if it is empty.
+ * @throws QString If the file cannot be opened or mapped.
+ */
+static const char *mapFile(QFile &file, qint64 &length) {
+  if (!file.open(QIODevice::ReadOnly)) {
+    throw QString("Unable to open %1: %2")
+        .arg(file.fileName(), file.errorString());
+  }
+  length = file.size();
+  if (length == 0) {
+    return NULL;
+  }
+  const uchar *data = file.map(0, length);
+  if (data == NULL) {
+    throw QString("Unable to map %1: %2")
+        .arg(file.fileName(), file.errorString());
+  }
+  return reinterpret_cast<const char *>(data);
+}
+
+
+/**
+ * Count the UTF-16 units that some UTF-8 text decodes to, without
+ * decoding it.
+ * @param data UTF-8 text.
+ * @param length Length of the text in bytes.
+ * @return Number of UTF-16 units.
+ */
+static qint64 mappedLength(const char *data, qint64 length) {
+  qint64 count = 0;
+  for (qint64 i = 0; i < length; i++) {
+    const uchar c = static_cast<uchar>(data[i]);
+    if ((c & 0xC0) != 0x80) {
+      // Four byte sequences become surrogate pairs.
+      count += c >= 0xF0 ? 2 : 1;
+    }
+  }
+  return count;
+}
+
+
+/**
+ * Decode part of a mapped file.
+ * @param data UTF-8 text.
+ * @param length Length of the text in bytes, no more than INT_MAX.
+ * @return Decoded text.
+ */
+static QString mappedText(const char *data, qint64 length) {
+  return QString::fromUtf8(data, static_cast<int>(length));
+}
+
+
+/**
+ * Split mapped text into lines and give each distinct line an id, like
+ * diff_linesToCharsMunge() but without its limit of 65535 distinct lines.
+ * The hash holds views of the mapped lines rather than copies.
+ * @param data UTF-8 text.
+ * @param length Length of the text in bytes.
+ * @param lineHash Map of lines to their ids, shared by both texts.
+ * @param unhashed Number of lines too long to hash, shared by both texts.
+ * @param ids Set to the id of each line.
+ * @param starts Set to the offset of each line, then the end of the text.
+ */
+static void mappedLinesToIds(const char *data, qint64 length,
+                             QHash<QByteArray, int> &lineHash, int &unhashed,
+                             QVector<int> &ids, QVector<qint64> &starts) {
+  qint64 lineStart = 0;
+  while (lineStart < length) {
+    const char *newline = static_cast<const char *>(
+        memchr(data + lineStart, '\n', length - lineStart));
+    const qint64 lineEnd = newline == NULL ? length : newline - data + 1;
+    if (lineEnd - lineStart > std::numeric_limits<int>::max()) {
+      // Too long for a QByteArray to view, so give it an id of its own.
+      ids.append(-++unhashed);
+    } else {
+      const QByteArray line = QByteArray::fromRawData(data + lineStart,
+          static_cast<int>(lineEnd - lineStart));
+      QHash<QByteArray, int>::const_iterator i = lineHash.constFind(line);
+      if (i == lineHash.constEnd()) {
+        i = lineHash.insert(line, lineHash.size());
+      }
+      ids.append(i.value());
+    }
+    starts.append(lineStart);
+    lineStart = lineEnd;
+  }
+  starts.append(length);
+}
+
+
+/**
+ * Eliminate equalities of lines which are no longer than the edits on
+ * either side of them (e.g. blank lines), as diff_cleanupSemantic() does
+ * for text.
+ * @param ids1 Line ids of the old text.
+ * @param ids2 Line ids of the new text.
+ * @param runs List of DiffRun objects.
+ */
+static void mappedCleanupLines(const int *ids1, const int *ids2,
+                               QList<DiffRun> &runs) {
+  bool changes = true;
+  while (changes) {
+    changes = false;
+    int insertionsBefore = 0;  // Edits between the last two equalities
+    int deletionsBefore = 0;
+    int insertions = 0;  // Edits since the last equality
+    int deletions = 0;
+    int equality = -1;  // Index of the last equality
+    for (int x = 0; x <= runs.size(); x++) {
+      if (x < runs.size() && runs[x].operation != EQUAL) {
+        (runs[x].operation == INSERT ? insertions : deletions)
+            += runs[x].length;
+        continue;
+      }
+      if (equality >= 0) {
+        const int length = runs[equality].length;
+        if (length <= qMax(insertionsBefore, deletionsBefore)
+            && length <= qMax(insertions, deletions)) {
+          // Replace the equality with a delete and an insert.
+          runs[equality] = DiffRun(DELETE, length);
+          runs.insert(equality + 1, DiffRun(INSERT, length));
+          x++;
+          // The edits on both sides now form one block.
+          insertions += insertionsBefore + length;
+          deletions += deletionsBefore + length;
+          changes = true;
+        }
+      }
+      insertionsBefore = insertions;
+      deletionsBefore = deletions;
+      insertions = 0;
+      deletions = 0;
+      equality = x;
+    }
+    if (changes) {
+      diff_core<const int *>::diff_cleanupMerge(ids1, ids2, runs);
+    }
+  }
+}
+
+
+/**
+ * Append a pending equality to a delta.
+ * @param writer Writer of the delta.
+ * @param equal Length of the equality, reset to zero.
+ */
+static void mappedFlushEqual(PatchWriter &writer, qint64 &equal) {
+  if (equal != 0) {
+    writer.writeDeltaLength(EQUAL, equal);
+    equal = 0;
+  }
+}
+
+
+/////////////////////////////////////////////
+//
+// Unique Line Anchors
+//
+/////////////////////////////////////////////
+
+
+/**
+ * Find the end of a line, including its newline.
+ * @param text Text to split.
+ * @param lineStart Start of the line.
+ * @return Index just past the line.
+ */
+static int findLineEnd(const QString &text, int lineStart) {
+  const int newline = text.indexOf('\n', lineStart);
+  return newline == -1 ? text.length() : newline + 1;
+}
+
+
+/**
+ * Number a line, giving it the next free number if it has none yet.
+ * @param line Line to number.
+ * @param ids Map of lines to their numbers.
+ * @param baseIds Numbers already given to lines, which ids continues, or
+ *     NULL.
+ * @return Number of the line.
+ */
+static int lineId(const QString &line, QHash<QString, int> &ids,
+                  const QHash<QString, int> *baseIds = NULL) {
+  const int baseSize = baseIds == NULL ? 0 : baseIds->size();
+  if (baseIds != NULL) {
+    const int baseId = baseIds->value(line, -1);
+    if (baseId != -1) {
+      return baseId;
+    }
+  }
+  QHash<QString, int>::const_iterator it = ids.constFind(line);
+  if (it == ids.constEnd()) {
+    it = ids.insert(line, baseSize + ids.size());
+  }
+  return it.value();
+}
+
+
+/**
+ * Split a text into lines and number each distinct line.
+ * @param text Text to split.
+ * @param ids Map of lines to their numbers, shared between texts.
+ * @param lines Number of each line, appended to.
+ * @param starts Start of each line, followed by the length of the text.
+ * @param baseIds Numbers already given to lines, which ids continues, or
+ *     NULL.
+ */
+static void anchorLines(const QString &text, QHash<QString, int> &ids,
+                        QVector<int> &lines, QVector<int> &starts,
+                        const QHash<QString, int> *baseIds = NULL) {
+  int lineStart = 0;
+  while (lineStart < text.length()) {
+    const int end = findLineEnd(text, lineStart);
+    lines.append(lineId(text.mid(lineStart, end - lineStart), ids, baseIds));
+    starts.append(lineStart);
+    lineStart = end;
+  }
+  starts.append(text.length());
+}
+
+
+/**
+ * Find the lines which occur exactly once in each text and keep the
+ * longest run of them which is in the same order in both, by patience
+ * sorting them.
+ * @param lines1 Line numbers of the first text.
+ * @param lines2 Line numbers of the second text.
+ * @param count Number of distinct lines.
+ * @return Alternating indices into lines1 and lines2 of the anchors.
+ */
+static QVector<int> uniqueAnchors(const QVector<int> &lines1,
+                                  const QVector<int> &lines2, int count) {
+  QVector<int> count1(count, 0);
+  QVector<int> count2(count, 0);
+  QVector<int> where1(count, -1);
+  for (int i = 0; i < lines1.size(); i++) {
+    count1[lines1[i]]++;
+    where1[lines1[i]] = i;
+  }
+  foreach (int line, lines2) {
+    count2[line]++;
+  }
+
+  // Patience sort the candidates by their index in lines1.
+  QVector<int> candidates1;
+  QVector<int> candidates2;
+  QVector<int> previous;
+  QVector<int> tails;  // Candidate ending each increasing run, by length.
+  for (int j = 0; j < lines2.size(); j++) {
+    const int line = lines2[j];
+    if (count1[line] != 1 || count2[line] != 1) {
+      continue;
+    }
+    const int i = where1[line];
+    int low = 0;
+    int high = tails.size();
+    while (low < high) {
+      const int mid = (low + high) / 2;
+      if (candidates1[tails[mid]] < i) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    candidates1.append(i);
+    candidates2.append(j);
+    previous.append(low == 0 ? -1 : tails[low - 1]);
+    if (low == tails.size()) {
+      tails.append(candidates1.size() - 1);
+    } else {
+      tails[low] = candidates1.size() - 1;
+    }
+  }
+
+  QVector<int> anchors(tails.size() * 2);
+  int candidate = tails.isEmpty() ? -1 : tails.last();
+  for (int a = tails.size() - 1; a >= 0; a--) {
+    anchors[a * 2] = candidates1[candidate];
+    anchors[a * 2 + 1] = candidates2[candidate];
+    candidate = previous[candidate];
+  }
+  return anchors;
+}
+
+
+/////////////////////////////////////////////
+//
+// Streaming Diff
+//
+/////////////////////////////////////////////
+
+
+/**
+ * Read one byte from a device, waiting for it if the device is sequential.
+ * @param device Device to read from.
+ * @param c Set to the byte read.
+ * @return False if the device has no more data.
+ */
+static bool streamGetChar(QIODevice *device, char *c) {
+  while (!device->getChar(c)) {
+    if (!device->isSequential() || !device->waitForReadyRead(-1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+/**
+ * Read whole lines from a device until the window is full.  A line too long
+ * to fit in the window is split into pieces which do.
+ * @param device Device to read from.
+ * @param lines Window of lines to append to.
+ * @param size Number of characters in the window, updated.
+ * @param limit Maximum number of characters in the window.
+ * @param line Buffer of limit + 4 bytes to read each line into, room for a
+ *     whole piece, the rest of its last character, and a null.
+ * @return True if the device has no more data.
+ */
+static bool streamReadLines(QIODevice *device, QStringList &lines, int &size,
+                            int limit, char *line) {
+  while (size < limit) {
+    int length = 0;
+    while (length < limit && (length == 0 || line[length - 1] != '\n')) {
+      const qint64 count = device->readLine(line + length,
+                                            limit + 1 - length);
+      if (count > 0) {
+        length += static_cast<int>(count);
+      } else if (!device->isSequential() || !device->waitForReadyRead(-1)) {
+        break;
+      }
+    }
+    if (length == 0) {
+      return true;
+    }
+    if (line[length - 1] != '\n') {
+      // Don't split a character between two pieces.
+      char c;
+      while (length < limit + 3 && streamGetChar(device, &c)) {
+        if ((static_cast<uchar>(c) & 0xC0) != 0x80) {
+          device->ungetChar(c);
+          break;
+        }
+        line[length++] = c;
+      }
+    }
+    lines.append(QString::fromUtf8(line, length));
+    size += lines.last().length();
+  }
+  // A sequential device may have more data on its way.
+  return !device->isSequential() && device->atEnd();
+}
+
+
+/**
+ * Find a line which occurs exactly once in each window, to keep the two
+ * streams in step.  The candidates are reduced to their longest increasing
+ * subsequence, so that a line which has moved is not chosen.  The last such
+ * line in the first half of both windows is picked, leaving the rest of the
+ * windows as lookahead for the next anchor.
+ * @param lines1 Window of old lines.
+ * @param lines2 Window of new lines.
+ * @param index1 Set to the index of the anchor in lines1.
+ * @param index2 Set to the index of the anchor in lines2.
+ * @return False if there is no anchor.
+ */
+static bool streamAnchor(const QStringList &lines1, const QStringList &lines2,
+                         int &index1, int &index2) {
+  QHash<QString, int> ids;
+  QVector<int> numbers1;
+  QVector<int> numbers2;
+  foreach (const QString &line, lines1) {
+    numbers1.append(lineId(line, ids));
+  }
+  foreach (const QString &line, lines2) {
+    numbers2.append(lineId(line, ids));
+  }
+  const QVector<int> anchors = uniqueAnchors(numbers1, numbers2, ids.size());
+  if (anchors.isEmpty()) {
+    return false;
+  }
+
+  // Take the last anchor in the first half of both windows, or else the
+  // first anchor.
+  int anchor = 0;
+  for (int a = anchors.size() - 2; a >= 0; a -= 2) {
+    if (anchors[a] <= lines1.size() / 2
+        && anchors[a + 1] <= lines2.size() / 2) {
+      anchor = a;
+      break;
+    }
+  }
+  index1 = anchors[anchor];
+  index2 = anchors[anchor + 1];
+  return true;
+}
+
+
+/**
+ * Pass a diff on to a sink, merging it with the previous one if they share
+ * an operation.
+ * @param sink Receiver of the diffs.
+ * @param pending Diff not yet sent, or one with empty text.
+ * @param aDiff Next diff.
+ * @param limit Length beyond which pending is sent without waiting.
+ */
+static void streamSend(DiffSink *sink, Diff &pending, const Diff &aDiff,
+                       int limit) {
+  if (aDiff.text.isEmpty()) {
+    return;
+  }
+  if (aDiff.operation == pending.operation) {
+    pending.text += aDiff.text;
+  } else {
+    if (!pending.text.isEmpty()) {
+      sink->receiveDiff(pending);
+    }
+    pending = aDiff;
+  }
+  if (pending.text.length() >= limit) {
+    sink->receiveDiff(pending);
+    pending.text = "";
+  }
+}
+
+
+/////////////////////////////////////////////
+//
+// Diff Runs
+//
+/////////////////////////////////////////////
+
+
+/**
+ * Convert the runs of a diff of two QStrings back to Diff objects.
+ * @param runs List of DiffRun objects.
+ * @param text1 Old string.
+ * @param text2 New string.
+ * @return LinkedList of Diff objects.
+ */
+static QList<Diff> runsToDiffs(const QList<DiffRun> &runs,
+                               const QString &text1, const QString &text2) {
+  QList<Diff> diffs;
+  int index1 = 0;
+  int index2 = 0;
+  foreach (const DiffRun &run, runs) {
+    if (run.operation == INSERT) {
+      diffs.append(Diff(INSERT, text2.mid(index2, run.length)));
+      index2 += run.length;
+    } else {
+      diffs.append(Diff(run.operation, text1.mid(index1, run.length)));
+      index1 += run.length;
+      if (run.operation == EQUAL) {
+        index2 += run.length;
+      }
+    }
+  }
+  return diffs;
+}
+
+
+/////////////////////////////////////////////
+//
+// Narrow Strings
+//
+/////////////////////////////////////////////
+
+
+/**
+ * Is a UTF-8 sequence split by the end of some text?
+ * @param text UTF-8 text.
+ * @param start Offset of the start of the text.
+ * @param end Offset of the end of the text.
+ * @return Offset of the start of the split sequence, or end if none is.
+ */
+static int utf8SplitTail(const char *text, int start, int end) {
+  int lead = end;
+  while (lead > start && (static_cast<uchar>(text[lead - 1]) & 0xC0) == 0x80) {
+    lead--;
+  }
+  if (lead == start) {
+    return end;
+  }
+  lead--;
+  const uchar c = static_cast<uchar>(text[lead]);
+  const int length = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+  return lead + length > end ? lead : end;
+}
+
+
+/**
+ * Convert a diff of two narrow strings from runs back to Diff objects.
+ * For UTF-8, equalities are first shrunk to whole characters, with the
+ * bytes they lose going to the surrounding deletion and insertion.
+ * @param runs List of DiffRun objects.
+ * @param text1 Old string.
+ * @param text2 New string.
+ * @param utf8 True for UTF-8, false for Latin-1.
+ * @return Linked List of Diff objects.
+ */
+static QList<Diff> narrowRunsToDiffs(const QList<DiffRun> &runs,
+                                     const QByteArray &text1,
+                                     const QByteArray &text2, bool utf8) {
+  const char *data1 = text1.constData();
+  const char *data2 = text2.constData();
+  QList<Diff> diffs;
+  int pointer1 = 0;  // Cursor in text1 past the last equality.
+  int pointer2 = 0;  // Cursor in text2 past the last equality.
+  int index1 = 0;
+  int index2 = 0;
+  for (int x = 0; x <= runs.size(); x++) {
+    // Treat the end of the texts as an empty equality.
+    int start1 = index1;
+    int end1 = index1;
+    if (x < runs.size()) {
+      const DiffRun &run = runs[x];
+      if (run.operation != INSERT) {
+        index1 += run.length;
+      }
+      if (run.operation != DELETE) {
+        index2 += run.length;
+      }
+      if (run.operation != EQUAL) {
+        continue;
+      }
+      end1 = index1;
+      if (utf8) {
+        while (start1 < end1
+            && (static_cast<uchar>(data1[start1]) & 0xC0) == 0x80) {
+          start1++;
+        }
+        end1 = utf8SplitTail(data1, start1, end1);
+      }
+    }
+    const int start2 = start1 + (index2 - index1);
+    if (start1 != pointer1) {
+      diffs.append(Diff(DELETE, utf8
+          ? QString::fromUtf8(data1 + pointer1, start1 - pointer1)
+          : QString::fromLatin1(data1 + pointer1, start1 - pointer1)));
+    }
+    if (start2 != pointer2) {
+      diffs.append(Diff(INSERT, utf8
+          ? QString::fromUtf8(data2 + pointer2, start2 - pointer2)
+          : QString::fromLatin1(data2 + pointer2, start2 - pointer2)));
+    }
+    if (end1 != start1) {
+      diffs.append(Diff(EQUAL, utf8
+          ? QString::fromUtf8(data1 + start1, end1 - start1)
+          : QString::fromLatin1(data1 + start1, end1 - start1)));
+    }
+    pointer1 = end1;
+    pointer2 = end1 + (index2 - index1);
+  }
+  return diffs;
+}
+
+
+/////////////////////////////////////////////
+//
+// Block Moves
+//
+/////////////////////////////////////////////
+
+// Multiplier of the rolling hash.
+static const uint BLOCK_HASH_BASE = 0x01000193;
+// Most places in text1 a block of text2 is checked against.  Repetitive
+// texts would otherwise extend every copy of a block.
+static const int BLOCK_CANDIDATES = 8;
+
+
+/**
+ * Hash a block of characters.
+ * @param data Start of the block.
+ * @param length Length of the block.
+ * @return Hash of the block.
+ */
+static uint blockHash(const QChar *data, int length) {
+  uint hash = 0;
+  for (int i = 0; i < length; i++) {
+    hash = hash * BLOCK_HASH_BASE + data[i].unicode();
+  }
+  return hash;
+}
+
+
+/**
+ * Find long common blocks of two texts in any order, as rsync does: text1
+ * is hashed in consecutive blocks and a rolling hash is slid along text2.
+ * Each hit is checked and then extended as far as it goes both ways.
+ * @param text1 Old string.
+ * @param text2 New string.
+ * @param blockSize Length of the hashed blocks.
+ * @return Common blocks in order of index2, not overlapping in text2.
+ */
+static QList<DiffMove> blockMatches(const QString &text1,
+                                    const QString &text2, int blockSize) {
+  const QChar *data1 = text1.constData();
+  const QChar *data2 = text2.constData();
+  const int length1 = text1.length();
+  const int length2 = text2.length();
+  QList<DiffMove> matches;
+  if (blockSize <= 0 || length1 < blockSize || length2 < blockSize) {
+    return matches;
+  }
+
+  // Hash chains of the blocks of text1: the last block with each hash, and
+  // for each block the one before it with the same hash.
+  QHash<uint, int> lastBlock;
+  QVector<int> previousBlock(length1 / blockSize, -1);
+  for (int b = 0; b < previousBlock.size(); b++) {
+    const uint hash = blockHash(data1 + b * blockSize, blockSize);
+    previousBlock[b] = lastBlock.value(hash, -1);
+    lastBlock.insert(hash, b);
+  }
+  // Weight of the character leaving the rolling hash.
+  uint power = 1;
+  for (int i = 1; i < blockSize; i++) {
+    power *= BLOCK_HASH_BASE;
+  }
+
+  int start = 0;  // Earliest place in text2 a match may extend back to.
+  int j = 0;
+  uint hash = blockHash(data2, blockSize);
+  while (true) {
+    DiffMove best;
+    int b = lastBlock.value(hash, -1);
+    for (int candidates = 0; candidates < BLOCK_CANDIDATES && b != -1;
+        candidates++, b = previousBlock[b]) {
+      const int i = b * blockSize;
+      if (memcmp(data1 + i, data2 + j, blockSize * sizeof(QChar)) != 0) {
+        // Hash collision.
+        continue;
+      }
+      int start1 = i;
+      int start2 = j;
+      while (start1 > 0 && start2 > start
+          && data1[start1 - 1] == data2[start2 - 1]) {
+        start1--;
+        start2--;
+      }
+      int end2 = j + blockSize;
+      while (end2 - start2 + start1 < length1 && end2 < length2
+          && data1[end2 - start2 + start1] == data2[end2]) {
+        end2++;
+      }
+      if (end2 - start2 > best.length) {
+        best = DiffMove(start1, start2, end2 - start2);
+      }
+    }
+
+    if (best.length != 0) {
+      matches.append(best);
+      start = j = best.index2 + best.length;
+      if (j + blockSize > length2) {
+        break;
+      }
+      hash = blockHash(data2 + j, blockSize);
+    } else {
+      if (j + blockSize >= length2) {
+        break;
+      }
+      hash = (hash - data2[j].unicode() * power) * BLOCK_HASH_BASE
+          + data2[j + blockSize].unicode();
+      j++;
+    }
+  }
+  return matches;
+}
+
+
+/**
+ * Choose the blocks with the greatest total length which keep their order
+ * in both texts.  A Fenwick tree over the block ends in text1 holds the
+ * heaviest chain ending at or before each point.
+ * @param matches Common blocks in order of index2, not overlapping in text2.
+ * @return Indices into matches of the chosen blocks, in order.
+ */
+static QList<int> blockChain(const QList<DiffMove> &matches) {
+  const int count = matches.size();
+  QVector<int> ends(count);
+  for (int m = 0; m < count; m++) {
+    ends[m] = matches[m].index1 + matches[m].length;
+  }
+  std::sort(ends.begin(), ends.end());
+
+  QVector<qint64> treeWeight(count + 1, 0);
+  QVector<int> treeMatch(count + 1, -1);
+  QVector<int> previous(count);
+  qint64 bestWeight = 0;
+  int bestMatch = -1;
+  for (int m = 0; m < count; m++) {
+    // Heaviest chain which ends before this block starts.
+    qint64 weight = 0;
+    previous[m] = -1;
+    int k = std::upper_bound(ends.begin(), ends.end(), matches[m].index1)
+        - ends.begin();
+    for (; k > 0; k -= k & -k) {
+      if (treeWeight[k] > weight) {
+        weight = treeWeight[k];
+        previous[m] = treeMatch[k];
+      }
+    }
+    weight += matches[m].length;
+    if (weight > bestWeight) {
+      bestWeight = weight;
+      bestMatch = m;
+    }
+    k = std::lower_bound(ends.begin(), ends.end(),
+                         matches[m].index1 + matches[m].length)
+        - ends.begin() + 1;
+    for (; k <= count; k += k & -k) {
+      if (weight > treeWeight[k]) {
+        treeWeight[k] = weight;
+        treeMatch[k] = m;
+      }
+    }
+  }
+
+  QList<int> chain;
+  for (int m = bestMatch; m != -1; m = previous[m]) {
+    chain.prepend(m);
+  }
+  return chain;
+}
+
+
+/////////////////////////////////////////////
+//
+// DiffDocument Class
+//
+/////////////////////////////////////////////
+
+
+DiffDocument::DiffDocument(const QString &text) : base(text) {
+  anchorLines(base, ids, lines, starts);
+}
+
+
+const QString &DiffDocument::text() const {
+  return base;
+}
+
+
+/////////////////////////////////////////////
+//
+// DiffCache Class
+//
+/////////////////////////////////////////////
+
+
+/**
+ * Rotate a 64-bit value left.
+ */
+static inline quint64 rotl64(quint64 x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+
+/**
+ * Final avalanche of MurmurHash3.
+ */
+static inline quint64 fmix64(quint64 k) {
+  k ^= k >> 33;
+  k *= Q_UINT64_C(0xff51afd7ed558ccd);
+  k ^= k >> 33;
+  k *= Q_UINT64_C(0xc4ceb9fe1a85ec53);
+  k ^= k >> 33;
+  return k;
+}
+
+
+/**
+ * Hash some data with MurmurHash3 (x64, 128-bit).
+ * @param data Data to hash.
+ * @param length Length of the data in bytes.
+ * @param seed Seed, so that the same data hashes differently per use.
+ * @param h1 Set to the high half of the hash.
+ * @param h2 Set to the low half of the hash.
+ */
+static void murmurHash128(const char *data, int length, quint64 seed,
+                          quint64 &h1, quint64 &h2) {
+  const quint64 c1 = Q_UINT64_C(0x87c37b91114253d5);
+  const quint64 c2 = Q_UINT64_C(0x4cf5ad432745937f);
+  h1 = seed;
+  h2 = seed;
+  const int blocks = length / 16;
+  for (int i = 0; i < blocks; i++) {
+    quint64 k1;
+    quint64 k2;
+    memcpy(&k1, data + i * 16, 8);
+    memcpy(&k2, data + i * 16 + 8, 8);
+    k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+    h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+    k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+    h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+  }
+
+  const uchar *tail = reinterpret_cast<const uchar *>(data + blocks * 16);
+  quint64 k1 = 0;
+  quint64 k2 = 0;
+  for (int i = (length & 15) - 1; i >= 0; i--) {
+    if (i >= 8) {
+      k2 ^= static_cast<quint64>(tail[i]) << ((i - 8) * 8);
+    } else {
+      k1 ^= static_cast<quint64>(tail[i]) << (i * 8);
+    }
+  }
+  if ((length & 15) > 8) {
+    k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+  }
+  if ((length & 15) != 0) {
+    k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+  }
+
+  h1 ^= static_cast<quint64>(length);
+  h2 ^= static_cast<quint64>(length);
+  h1 += h2;
+  h2 += h1;
+  h1 = fmix64(h1);
+  h2 = fmix64(h2);
+  h1 += h2;
+  h2 += h1;
+}
+
+
+/**
+ * Approximate the memory held by a list of diffs.
+ * @param diffs LinkedList of Diff objects.
+ * @return Number of bytes.
+ */
+static int diffsCost(const QList<Diff> &diffs) {
+  int cost = sizeof(QList<Diff>);
+  foreach (const Diff &aDiff, diffs) {
+    cost += sizeof(Diff) + sizeof(void *) + 32
+        + aDiff.text.length() * sizeof(QChar);
+  }
+  return cost;
+}
+
+
+DiffCache::DiffCache(int maxBytes) :
+  cache(maxBytes), hitCount(0), missCount(0), evictionCount(0) {
+}
+
+
+bool DiffCache::find(const DiffCacheKey &key, QList<Diff> &diffs) {
+  QMutexLocker locker(&mutex);
+  const QList<Diff> *cached = cache.object(key);
+  if (cached == NULL) {
+    missCount++;
+    return false;
+  }
+  hitCount++;
+  diffs = *cached;
+  return true;
+}
+
+
+void DiffCache::insert(const DiffCacheKey &key, const QList<Diff> &diffs) {
+  const int cost = diffsCost(diffs);
+  QMutexLocker locker(&mutex);
+  if (cache.contains(key)) {
+    // Another thread got here first.
+    return;
+  }
+  const int count = cache.size();
+  if (cache.insert(key, new QList<Diff>(diffs), cost)) {
+    evictionCount += count + 1 - cache.size();
+  }
+}
+
+
+void DiffCache::clear() {
+  QMutexLocker locker(&mutex);
+  cache.clear();
+}
+
+
+int DiffCache::maxBytes() const {
+  QMutexLocker locker(&mutex);
+  return cache.maxCost();
+}
+
+
+void DiffCache::setMaxBytes(int maxBytes) {
+  QMutexLocker locker(&mutex);
+  const int count = cache.size();
+  cache.setMaxCost(maxBytes);
+  evictionCount += count - cache.size();
+}
+
+
+int DiffCache::totalBytes() const {
+  QMutexLocker locker(&mutex);
+  return cache.totalCost();
+}
+
+
+int DiffCache::size() const {
+  QMutexLocker locker(&mutex);
+  return cache.size();
+}
+
+
+qint64 DiffCache::hits() const {
+  QMutexLocker locker(&mutex);
+  return hitCount;
+}
+
+
+qint64 DiffCache::misses() const {
+  QMutexLocker locker(&mutex);
+  return missCount;
+}
+
+
+qint64 DiffCache::evictions() const {
+  QMutexLocker locker(&mutex);
+  return evictionCount;
+}
+
+
+/////////////////////////////////////////////
+//
+// DiffCancelToken Class
+//
+/////////////////////////////////////////////
+
+DiffCancelToken::DiffCancelToken() : cancelled(0) {
+}
+
+
+void DiffCancelToken::cancel() {
+  cancelled.fetchAndStoreOrdered(1);
+}
+
+
+void DiffCancelToken::reset() {
+  cancelled.fetchAndStoreOrdered(0);
+}
+
+
+bool DiffCancelToken::isCancelled() const {
+  return cancelled != 0;
+}
+
+
+/////////////////////////////////////////////
+//
+// DiffPrefilter Class
+//
+/////////////////////////////////////////////
+
+DiffPrefilter::DiffPrefilter(float threshold, int minLength) :
+  similarityThreshold(threshold), minimumLength(minLength), checkCount(0),
+  skipCount(0) {
+}
+
+
+bool DiffPrefilter::similar(float similarity) {
+  QMutexLocker locker(&mutex);
+  checkCount++;
+  if (similarity < similarityThreshold) {
+    skipCount++;
+    return false;
+  }
+  return true;
+}
+
+
+void DiffPrefilter::resetCounters() {
+  QMutexLocker locker(&mutex);
+  checkCount = 0;
+  skipCount = 0;
+}
+
+
+float DiffPrefilter::threshold() const {
+  QMutexLocker locker(&mutex);
+  return similarityThreshold;
+}
+
+
+void DiffPrefilter::setThreshold(float threshold) {
+  QMutexLocker locker(&mutex);
+  similarityThreshold = threshold;
+}
+
+
+int DiffPrefilter::minLength() const {
+  QMutexLocker locker(&mutex);
+  return minimumLength;
+}
+
+
+void DiffPrefilter::setMinLength(int minLength) {
+  QMutexLocker locker(&mutex);
+  minimumLength = minLength;
+}
+
+
+qint64 DiffPrefilter::checked() const {
+  QMutexLocker locker(&mutex);
+  return checkCount;
+}
+
+
+qint64 DiffPrefilter::skipped() const {
+  QMutexLocker locker(&mutex);
+  return skipCount;
+}
+
+
+// Length of the substrings compared by diff_similarity().
+static const int SIMILARITY_GRAM = 8;
+// Number of hashes kept in each MinHash sketch.
+static const int SIMILARITY_SKETCH = 128;
+
+/**
+ * Compute a bottom-k MinHash sketch of a text: the least distinct hashes of
+ * its substrings of SIMILARITY_GRAM characters, in increasing order.
+ * @param text Text to sketch.
+ * @return Up to SIMILARITY_SKETCH hashes.
+ */
+static QVector<quint64> similaritySketch(const QString &text) {
+  QVector<quint64> sketch;
+  if (text.isEmpty()) {
+    return sketch;
+  }
+  sketch.reserve(SIMILARITY_SKETCH);
+  // Hashes in the sketch, to skip repeated substrings.
+  QSet<quint64> members;
+  members.reserve(SIMILARITY_SKETCH);
+  const ushort *data = text.utf16();
+  const int length = text.length();
+  const int gramLength = std::min(length, SIMILARITY_GRAM);
+  // Hash each substring as a polynomial in its characters, rolled along
+  // the text.
+  const quint64 base = Q_UINT64_C(0x100000001b3);
+  quint64 top = 1;
+  quint64 gram = 0;
+  for (int i = 0; i < gramLength; i++) {
+    gram = gram * base + data[i];
+    top = i == 0 ? 1 : top * base;
+  }
+  for (int i = 0; i + gramLength <= length; i++) {
+    if (i > 0) {
+      gram = (gram - data[i - 1] * top) * base + data[i + gramLength - 1];
+    }
+    const quint64 hash = fmix64(gram);
+    // The sketch is kept as a max-heap until it is full.
+    if (sketch.size() < SIMILARITY_SKETCH) {
+      if (!members.contains(hash)) {
+        members.insert(hash);
+        sketch.append(hash);
+        std::push_heap(sketch.begin(), sketch.end());
+      }
+    } else if (hash < sketch.first() && !members.contains(hash)) {
+      std::pop_heap(sketch.begin(), sketch.end());
+      members.remove(sketch.last());
+      members.insert(hash);
+      sketch.last() = hash;
+      std::push_heap(sketch.begin(), sketch.end());
+    }
+  }
+  std::sort(sketch.begin(), sketch.end());
+  return sketch;
+}
+
+
+/**
+ * Estimate the similarity of two texts from their MinHash sketches.
+ * @param text1 First string.
+ * @param text2 Second string.
+ * @return Similarity from 0.0 (nothing shared) to 1.0 (the same).
+ */
+static float sketchSimilarity(const QString &text1, const QString &text2) {
+  const QVector<quint64> sketch1 = similaritySketch(text1);
+  const QVector<quint64> sketch2 = similaritySketch(text2);
+
+  // The least hashes of the union sample it evenly; count how many of them
+  // are in both texts.
+  int taken = 0;
+  int shared = 0;
+  int i1 = 0;
+  int i2 = 0;
+  while (taken < SIMILARITY_SKETCH
+         && (i1 < sketch1.size() || i2 < sketch2.size())) {
+    if (i2 == sketch2.size()
+        || (i1 < sketch1.size() && sketch1[i1] < sketch2[i2])) {
+      i1++;
+    } else if (i1 == sketch1.size() || sketch2[i2] < sketch1[i1]) {
+      i2++;
+    } else {
+      i1++;
+      i2++;
+      shared++;
+    }
+    taken++;
+  }
+  return taken == 0 ? 1.0f : shared / static_cast<float>(taken);
+}
+
+
+/////////////////////////////////////////////
+//
+// DiffJob Class
+//
+/////////////////////////////////////////////
+
+/**
+* Class representing one replacement block to be rediffed by
+* diff_match_patch::diff_refine(), possibly on another thread.
+*/
+class DiffJob {
+ public:
+  DiffJob(const diff_match_patch *_dmp, const QString &_text1,
+          const QString &_text2, Granularity _granularity,
+          DiffDeadline _deadline, int _index, int _count) :
+    dmp(_dmp), text1(_text1), text2(_text2), granularity(_granularity),
+    deadline(_deadline), index(_index), count(_count), budget(0),
+    finished(NULL), total(0) {
+  }
+
+  void run() {
+    if (dmp->diff_cancelled()) {
+      // Leave the block as it is.
+      diffs.append(Diff(DELETE, text1));
+      diffs.append(Diff(INSERT, text2));
+      return;
+    }
+    diffs = dmp->diff_granular(text1, text2, granularity, deadline);
+    if (granularity != CHARACTERS) {
+      // Eliminate freak matches (e.g. lone spaces)
+      dmp->diff_cleanupSemantic(diffs);
+      dmp->diff_cleanupEmpty(diffs);
+    }
+    dmp->diff_progress("diff_refine", finished->fetchAndAddOrdered(1) + 1,
+                       total);
+  }
+
+  /**
+   * Order jobs largest first.
+   */
+  static bool largerThan(const DiffJob *job1, const DiffJob *job2) {
+    return job1->text1.length() + job1->text2.length()
+        > job2->text1.length() + job2->text2.length();
+  }
+
+  const diff_match_patch *dmp;
+  QString text1;
+  QString text2;
+  Granularity granularity;
+  DiffDeadline deadline;
+  // Position and number of the diffs being replaced.
+  int index;
+  int count;
+  // This block's share of the work budget, if there is one.
+  qint64 budget;
+  // The result of the rediff.
+  QList<Diff> diffs;
+  // Number of the jobs of the same diff_refine() done, out of total.
+  QAtomicInt *finished;
+  int total;
+};
+
+
+/**
+* Class handing out the jobs of one diff_refine() to the calling thread and
+* any helper threads, largest first.
+*/
+class DiffJobQueue {
+ public:
+  DiffJobQueue(const QList<DiffJob *> &_jobs) : jobs(_jobs), next(0),
+      helpers(0) {
+  }
+
+  /**
+   * Run jobs until none are left.
+   */
+  void work() {
+    int x;
+    while ((x = next.fetchAndAddOrdered(1)) < jobs.size()) {
+      jobs[x]->run();
+    }
+  }
+
+  /**
+   * Note that a helper thread has finished its work.
+   */
+  void helperDone() {
+    QMutexLocker locker(&mutex);
+    helpers--;
+    done.wakeAll();
+  }
+
+  int size() const {
+    return jobs.size();
+  }
+
+  const QList<DiffJob *> &jobs;
+  // Index of the next unclaimed job.
+  QAtomicInt next;
+  // Number of helper threads still working, guarded by mutex.
+  int helpers;
+  QMutex mutex;
+  QWaitCondition done;
+};
+
+
+/////////////////////////////////////////////
+//
+// Batches
+//
+/////////////////////////////////////////////
+
+
+/**
+* Class holding the progress of a diff_match_patch::diff_many() or
+* patch_make_many() call.  Every worker, the calling thread included, claims
+* the next unstarted pair from a shared counter until none are left, so a few
+* slow pairs never leave the other threads idle.
+*/
+class DiffBatch {
+ public:
+  DiffBatch(const diff_match_patch *_dmp,
+            const QList<QPair<QString, QString> > &_pairs, bool _checklines,
+            QList<Diff> *_diffs, QList<Patch> *_patches) :
+    dmp(_dmp), pairs(_pairs), checklines(_checklines), diffs(_diffs),
+    patches(_patches), next(0), helpers(0) {
+  }
+
+  /**
+   * Work through pairs until none are left.
+   */
+  void work() {
+    int x;
+    while ((x = next.fetchAndAddOrdered(1)) < pairs.size()) {
+      const QPair<QString, QString> &pair = pairs[x];
+      if (patches != NULL) {
+        patches[x] = dmp->patch_make(pair.first, pair.second);
+      } else {
+        diffs[x] = dmp->diff_main(pair.first, pair.second, checklines);
+      }
+    }
+  }
+
+  /**
+   * Note that a helper thread has finished its work.
+   */
+  void helperDone() {
+    QMutexLocker locker(&mutex);
+    helpers--;
+    done.wakeAll();
+  }
+
+  int size() const {
+    return pairs.size();
+  }
+
+  const diff_match_patch *dmp;
+  const QList<QPair<QString, QString> > &pairs;
+  bool checklines;
+  // Results, indexed as pairs.  Exactly one of these is used.
+  QList<Diff> *diffs;
+  QList<Patch> *patches;
+  // Index of the next unclaimed pair.
+  QAtomicInt next;
+  // Number of helper threads still working, guarded by mutex.
+  int helpers;
+  QMutex mutex;
+  QWaitCondition done;
+};
+
+
+/**
+* Class running a DiffBatch or DiffJobQueue on a pool thread.
+*/
+template <class Batch>
+class DiffBatchHelper : public QRunnable {
+ public:
+  DiffBatchHelper(Batch *_batch) : batch(_batch) {
+  }
+
+  void run() {
+    batch->work();
+    batch->helperDone();
+  }
+
+  Batch *batch;
+};
+
+
+/**
+ * Run a batch on the calling thread and up to threads - 1 threads of the
+ * global pool.  Pool threads which are all busy are not waited for.
+ * @param batch DiffBatch or DiffJobQueue to run.
+ * @param threads Maximum number of threads.
+ */
+template <class Batch>
+static void runBatch(Batch &batch, int threads) {
+  threads = qMin(threads, batch.size());
+  for (int x = 1; x < threads; x++) {
+    DiffBatchHelper<Batch> *helper = new DiffBatchHelper<Batch>(&batch);
+    batch.mutex.lock();
+    batch.helpers++;
+    batch.mutex.unlock();
+    if (!QThreadPool::globalInstance()->tryStart(helper)) {
+      delete helper;
+      batch.helperDone();
+      break;
+    }
+  }
+  batch.work();
+  QMutexLocker locker(&batch.mutex);
+  while (batch.helpers > 0) {
+    batch.done.wait(&batch.mutex);
+  }
+}
+
+
+/**
+ * Check a batch for null inputs before any thread sees it.
+ * @param pairs List of text pairs.
+ * @param error Error to throw, naming the calling method.
+ * @throws const char* If any text is null.
+ */
+static void checkBatch(const QList<QPair<QString, QString> > &pairs,
+                       const char *error) {
+  typedef QPair<QString, QString> TextPair;
+  foreach (const TextPair &pair, pairs) {
+    if (pair.first.isNull() || pair.second.isNull()) {
+      throw error;
+    }
+  }
+}
+
+
+// Scratch buffers of diff_core::diff_bisect(), one per thread.
+QThreadStorage<BisectArrays::BisectScratch *> BisectArrays::buffers;
+
+
+/////////////////////////////////////////////
+//
+// DiffOptions Class
+//
+/////////////////////////////////////////////
+
+DiffOptions::DiffOptions() :
+  Diff_Timeout(1.0f),
+  Diff_EditCost(4),
+  Diff_StreamWindow(1 << 20),
+  Diff_Threads(1),
+  Diff_MoveBlockSize(0),
+  Diff_AnchorLines(0),
+  Diff_Cache(NULL),
+  Diff_Cancel(NULL),
+  Diff_Progress(NULL),
+  Diff_WorkBudget(0),
+  Diff_Degrade(false),
+  Diff_Prefilter(NULL),
+  Match_Threshold(0.5f),
+  Match_Distance(1000),
+  Patch_DeleteThreshold(0.5f),
+  Patch_Margin(4),
+  Match_MaxBits(32) {
+}
+
+
+/////////////////////////////////////////////
+//
+// diff_match_patch Class
+//
+/////////////////////////////////////////////
+
+diff_match_patch::diff_match_patch() {
+}
+
+
+diff_match_patch::diff_match_patch(const DiffOptions &options) :
+  DiffOptions(options) {
+}
+
+
+const DiffOptions &diff_match_patch::options() const {
+  return *this;
+}
+
+
+QList<Diff> diff_match_patch::diff_main(const QString &text1,
+                                        const QString &text2) const {
+  return diff_main(text1, text2, true);
+}
+
+QList<Diff> diff_match_patch::diff_main(const QString &text1,
+    const QString &text2, bool checklines) const {
+  return diff_cached(text1, text2, checklines, NULL);
+}
+
+
+QList<Diff> diff_match_patch::diff_cached(const QString &text1,
+    const QString &text2, bool checklines, const DiffDocument *base) const {
+  // Check for null inputs.
+  if (text1.isNull() || text2.isNull()) {
+    throw "Null inputs. (diff_main)";
+  }
+
+  // Check for a cached result.
+  DiffCacheKey key;
+  QList<Diff> diffs;
+  bool expired = false;
+  if (Diff_Cache != NULL) {
+    key = diff_cacheKey(text1, text2, checklines, base != NULL);
+    if (Diff_Cache->find(key, diffs)) {
+      return diffs;
+    }
+  }
+
+  bool dissimilar = false;
+  int prefix = 0;
+  int suffix = 0;
+  if (Diff_Prefilter != NULL && text1 != text2
+      && std::min(text1.length(), text2.length())
+         >= Diff_Prefilter->minLength()) {
+    // Only what differs is estimated, as in diff_similarity().
+    prefix = diff_commonPrefix(text1, text2);
+    suffix = std::min(diff_commonSuffix(text1, text2),
+        std::min(text1.length(), text2.length()) - prefix);
+    const int length1 = text1.length() - prefix - suffix;
+    const int length2 = text2.length() - prefix - suffix;
+    // The similarity can be no more than the ratio of the lengths, so a
+    // short text inside a long one always looks dissimilar.  Leave such
+    // pairs, and short changes, to the diff.
+    dissimilar = std::min(length1, length2) >= Diff_Prefilter->minLength()
+        && std::min(length1, length2)
+           >= Diff_Prefilter->threshold() * std::max(length1, length2)
+        && !Diff_Prefilter->similar(sketchSimilarity(
+               text1.mid(prefix, length1), text2.mid(prefix, length2)));
+  }
+
+  if (dissimilar) {
+    // Too dissimilar to be worth diffing (speedup).  Keep any common prefix
+    // and suffix, and replace the rest whole.
+    diffs.append(Diff(EQUAL, text1.left(prefix)));
+    diffs.append(Diff(DELETE,
+        text1.mid(prefix, text1.length() - prefix - suffix)));
+    diffs.append(Diff(INSERT,
+        text2.mid(prefix, text2.length() - prefix - suffix)));
+    diffs.append(Diff(EQUAL, text1.right(suffix)));
+    diff_cleanupEmpty(diffs);
+  } else {
+    // Set a deadline by which time the diff must be complete.
+    qint64 budget;
+    const DiffDeadline deadline = diff_deadline(budget);
+    if (base != NULL) {
+      diffs = diff_document(*base, text2, deadline);
+    } else if (Diff_MoveBlockSize > 0) {
+      diffs = diff_blockMoves(text1, text2, checklines, deadline, NULL);
+    } else {
+      diffs = diff_main(text1, text2, checklines, deadline);
+    }
+    expired = deadline.expired();
+  }
+
+  if (Diff_Cache != NULL && !expired && !diff_cancelled()) {
+    // A diff which ran out of time or work, or was cancelled, may be
+    // coarser than the same diff given longer.
+    Diff_Cache->insert(key, diffs);
+  }
+  return diffs;
+}
+
+
+bool diff_match_patch::diff_bounded(const QString &text1,
+    const QString &text2, int maxEdits, QList<Diff> &diffs) const {
+  // Check for null inputs.
+  if (text1.isNull() || text2.isNull()) {
+    throw "Null inputs. (diff_bounded)";
+  }
+  diffs.clear();
+  if (maxEdits < 0 || qAbs(text1.length() - text2.length()) > maxEdits) {
+    // Fail fast: every extra character is an edit.
+    return false;
+  }
+
+  bool exceeded = false;
+  DiffDeadline deadline(std::numeric_limits<clock_t>::max());
+  deadline.maxEdits = maxEdits;
+  deadline.exceeded = &exceeded;
+  QList<Diff> bounded = diff_main(text1, text2, false, deadline);
+  int edits = 0;
+  foreach(Diff aDiff, bounded) {
+    if (aDiff.operation != EQUAL) {
+      edits += aDiff.text.length();
+    }
+  }
+  if (exceeded || edits > maxEdits) {
+    return false;
+  }
+  diffs = bounded;
+  return true;
+}
+
+
+DiffCacheKey diff_match_patch::diff_cacheKey(const QString &text1,
+    const QString &text2, bool checklines, bool document) const {
+  quint64 high1, low1, high2, low2;
+  murmurHash128(reinterpret_cast<const char *>(text1.constData()),
+                text1.length() * sizeof(QChar), 1, high1, low1);
+  murmurHash128(reinterpret_cast<const char *>(text2.constData()),
+                text2.length() * sizeof(QChar), 2, high2, low2);
+
+  // Fold in everything which changes the result.
+  quint32 timeout;
+  memcpy(&timeout, &Diff_Timeout, sizeof(timeout));
+  quint32 threshold = 0;
+  quint32 minLength = 0;
+  if (Diff_Prefilter != NULL) {
+    const float similarity = Diff_Prefilter->threshold();
+    memcpy(&threshold, &similarity, sizeof(threshold));
+    minLength = static_cast<quint32>(Diff_Prefilter->minLength());
+  }
+  const quint64 settings[5] = {
+    (static_cast<quint64>(timeout) << 32)
+        | (Diff_Degrade ? Q_UINT64_C(1) << 17 : 0)
+        | (document ? Q_UINT64_C(1) << 18 : 0)
+        | (static_cast<quint64>(static_cast<quint16>(Diff_EditCost)) << 1)
+        | (checklines ? 1 : 0),
+    static_cast<quint64>(Diff_MoveBlockSize),
+    static_cast<quint64>(Diff_AnchorLines),
+    static_cast<quint64>(Diff_WorkBudget),
+    (static_cast<quint64>(threshold) << 32) | minLength
+  };
+  quint64 high3, low3;
+  murmurHash128(reinterpret_cast<const char *>(settings), sizeof(settings), 3,
+                high3, low3);
+
+  DiffCacheKey key;
+  key.high = fmix64(high1 ^ rotl64(high2, 17) ^ rotl64(high3, 41));
+  key.low = fmix64(low1 ^ rotl64(low2, 23) ^ rotl64(low3, 47));
+  return key;
+}
+
+
+DiffDeadline diff_match_patch::diff_deadline(qint64 &budget) const {
+  clock_t time;
+  if (Diff_Timeout <= 0) {
+    time = std::numeric_limits<clock_t>::max();
+  } else {
+    time = clock() + (clock_t)(Diff_Timeout * CLOCKS_PER_SEC);
+  }
+  budget = Diff_WorkBudget;
+  DiffDeadline deadline(time, Diff_WorkBudget > 0 ? &budget : NULL);
+  deadline.cancel = Diff_Cancel;
+  deadline.progress = Diff_Progress;
+  deadline.degrade = Diff_Degrade;
+  if (Diff_Timeout > 0) {
+    deadline.grace = (clock_t)(Diff_Timeout * CLOCKS_PER_SEC / 4);
+  }
+  return deadline;
+}
+
+
+DiffDeadline diff_match_patch::diff_coreDeadline(DiffDeadline deadline,
+                                                 bool checklines) const {
+  deadline.cancel = Diff_Cancel;
+  deadline.progress = Diff_Progress;
+  deadline.degrade = Diff_Degrade;
+  deadline.lines = this;
+  deadline.checklines = checklines;
+  return deadline;
+}
+
+
+bool diff_match_patch::diff_halfMatchAllowed() const {
+  return Diff_Timeout > 0 || Diff_WorkBudget > 0;
+}
+
+
+bool diff_match_patch::diff_cancelled() const {
+  return Diff_Cancel != NULL && Diff_Cancel->isCancelled();
+}
+
+
+void diff_match_patch::diff_progress(const char *stage, int done,
+                                     int total) const {
+  if (Diff_Progress != NULL) {
+    Diff_Progress->reportProgress(stage, done, total);
+  }
+}
+
+QList<Diff> diff_match_patch::diff_main(const QString &text1,
+    const QString &text2, bool checklines, DiffDeadline deadline) const {
+  // Check for null inputs.
+  if (text1.isNull() || text2.isNull()) {
+    throw "Null inputs. (diff_main)";
+  }
+
+  const QList<DiffRun> runs = diff_core<const QChar *>::diff_main(
+      text1.unicode(), text1.length(), text2.unicode(), text2.length(),
+      diff_halfMatchAllowed(), diff_coreDeadline(deadline, checklines));
+  return runsToDiffs(runs, text1, text2);
+}
+
+
+QList<Diff> diff_match_patch::diff_mainLatin1(const QByteArray &text1,
+                                              const QByteArray &text2) const {
+  // Set a deadline by which time the diff must be complete.
+  qint64 budget;
+  const DiffDeadline deadline = diff_deadline(budget);
+  const QList<DiffRun> runs = diff_core<const char *>::diff_main(
+      text1.constData(), text1.size(), text2.constData(), text2.size(),
+      diff_halfMatchAllowed(), deadline);
+  QList<Diff> diffs = narrowRunsToDiffs(runs, text1, text2, false);
+  diff_cleanupMerge(diffs);
+  return diffs;
+}
+
+
+QList<Diff> diff_match_patch::diff_mainUtf8(const QByteArray &text1,
+                                            const QByteArray &text2) const {
+  // Set a deadline by which time the diff must be complete.
+  qint64 budget;
+  const DiffDeadline deadline = diff_deadline(budget);
+  const QList<DiffRun> runs = diff_core<const char *>::diff_main(
+      text1.constData(), text1.size(), text2.constData(), text2.size(),
+      diff_halfMatchAllowed(), deadline);
+  QList<Diff> diffs = narrowRunsToDiffs(runs, text1, text2, true);
+  diff_cleanupMerge(diffs);
+  return diffs;
+}
+
+
+QList<Diff> diff_match_patch::diff_main(const DiffDocument &base,
+                                        const QString &text2) const {
+  return diff_cached(base.base, text2, true, &base);
+}
+
+
+QList<Diff> diff_match_patch::diff_document(const DiffDocument &base,
+    const QString &text2, DiffDeadline deadline) const {
+  if (base.base.length() <= 100 || text2.length() <= 100) {
+    // Too short for line mode to pay off.
+    return diff_main(base.base, text2, true, deadline);
+  }
+
+  // Number the lines of the revision, continuing the base's numbering for
+  // lines the base doesn't have.
+  QHash<QString, int> ids;
+  QVector<int> lines2;
+  QVector<int> starts2;
+  anchorLines(text2, ids, lines2, starts2, &base.ids);
+
+  // Diff the line numbers.
+  const QList<DiffRun> runs = diff_core<const int *>::diff_main(
+      base.lines.constData(), base.lines.size(),
+      lines2.constData(), lines2.size(), diff_halfMatchAllowed(), deadline);
+
+  // Convert the diff back to the original text.
+  QList<Diff> diffs;
+  int line1 = 0;
+  int line2 = 0;
+  foreach (const DiffRun &run, runs) {
+    if (run.operation == INSERT) {
+      diffs.append(Diff(INSERT, text2.mid(starts2[line2],
+          starts2[line2 + run.length] - starts2[line2])));
+      line2 += run.length;
+    } else {
+      diffs.append(Diff(run.operation, base.base.mid(base.starts[line1],
+          base.starts[line1 + run.length] - base.starts[line1])));
+      line1 += run.length;
+      if (run.operation == EQUAL) {
+        line2 += run.length;
+      }
+    }
+  }
+  // Eliminate freak matches (e.g. blank lines)
+  diff_cleanupSemantic(diffs);
+
+  // Rediff any replacement blocks, this time character-by-character.
+  diff_refine(diffs, CHARACTERS, deadline);
+  diff_cleanupMerge(diffs);
+  return diffs;
+}
+
+
+QList<QList<Diff> > diff_match_patch::diff_many(
+    const QList<QPair<QString, QString> > &pairs) const {
+  return diff_many(pairs, true);
+}
+
+
+QList<QList<Diff> > diff_match_patch::diff_many(
+    const QList<QPair<QString, QString> > &pairs, bool checklines) const {
+  checkBatch(pairs, "Null inputs. (diff_many)");
+  QVector<QList<Diff> > results(pairs.size());
+  DiffBatch batch(this, pairs, checklines, results.data(), NULL);
+  runBatch(batch, Diff_Threads);
+  return results.toList();
+}
+
+
+QList<DiffRun> diff_match_patch::diff_lineRuns(const QChar *text1,
+    int length1, const QChar *text2, int length2,
+    DiffDeadline deadline) const {
+  const QString longtext1(text1, length1);
+  const QString longtext2(text2, length2);
+  const QList<Diff> diffs = Diff_AnchorLines > 0
+      ? diff_anchorMode(longtext1, longtext2, deadline)
+      : diff_lineMode(longtext1, longtext2, deadline);
+  QList<DiffRun> runs;
+  foreach (const Diff &aDiff, diffs) {
+    if (!aDiff.text.isEmpty()) {
+      runs.append(DiffRun(aDiff.operation, aDiff.text.length()));
+    }
+  }
+  return runs;
+}
+
+
+QList<Diff> diff_match_patch::diff_lineMode(QString text1, QString text2,
+    DiffDeadline deadline) const {
+  // Scan the text on a line-by-line basis first.
+  const QList<QVariant> b = diff_linesToChars(text1, text2);
+  text1 = b[0].toString();
+  text2 = b[1].toString();
+  QStringList linearray = b[2].toStringList();
+
+  QList<Diff> diffs = diff_main(text1, text2, false, deadline);
+
+  // Convert the diff back to original text.
+  diff_charsToLines(diffs, linearray);
+  // Eliminate freak matches (e.g. blank lines)
+  diff_cleanupSemantic(diffs);
+
+  // Rediff any replacement blocks, this time character-by-character.
+  diff_refine(diffs, CHARACTERS, deadline);
+  return diffs;
+}
+
+
+QList<Diff> diff_match_patch::diff_anchorMode(const QString &text1,
+    const QString &text2, DiffDeadline deadline) const {
+  QHash<QString, int> ids;
+  QVector<int> lines1;
+  QVector<int> lines2;
+  QVector<int> starts1;
+  QVector<int> starts2;
+  anchorLines(text1, ids, lines1, starts1);
+  anchorLines(text2, ids, lines2, starts2);
+  if (lines1.size() < Diff_AnchorLines || lines2.size() < Diff_AnchorLines) {
+    return diff_lineMode(text1, text2, deadline);
+  }
+  const QVector<int> anchors = uniqueAnchors(lines1, lines2, ids.size());
+  if (anchors.isEmpty()) {
+    return diff_lineMode(text1, text2, deadline);
+  }
+
+  // Each anchor line is an equality and each gap a replacement block.
+  QList<Diff> diffs;
+  int line1 = 0;
+  int line2 = 0;
+  for (int a = 0; a <= anchors.size(); a += 2) {
+    const int anchor1 = a < anchors.size() ? anchors[a] : lines1.size();
+    const int anchor2 = a < anchors.size() ? anchors[a + 1] : lines2.size();
+    if (anchor1 > line1) {
+      diffs.append(Diff(DELETE, text1.mid(starts1[line1],
+                                          starts1[anchor1] - starts1[line1])));
+    }
+    if (anchor2 > line2) {
+      diffs.append(Diff(INSERT, text2.mid(starts2[line2],
+                                          starts2[anchor2] - starts2[line2])));
+    }
+    if (a < anchors.size()) {
+      diffs.append(Diff(EQUAL, text1.mid(starts1[anchor1],
+          starts1[anchor1 + 1] - starts1[anchor1])));
+    }
+    line1 = anchor1 + 1;
+    line2 = anchor2 + 1;
+  }
+
+  // Diff the gaps as diff_lineMode() would: line by line, then rediff the
+  // replaced lines character by character.
+  diff_refine(diffs, LINES, deadline);
+  diff_refine(diffs, CHARACTERS, deadline);
+  return diffs;
+}
+
+
+QList<Diff> diff_match_patch::diff_wordMode(const QString &text1,
+                                            const QString &text2) const {
+  return diff_wordMode(text1, text2, false);
+}
+
+
+QList<Diff> diff_match_patch::diff_wordMode(const QString &text1,
+    const QString &text2, bool refine) const {
+  // Set a deadline by which time the diff must be complete.
+  qint64 budget;
+  const DiffDeadline deadline = diff_deadline(budget);
+  return diff_wordMode(text1, text2, refine, deadline);
+}
+
+
+QList<Diff> diff_match_patch::diff_wordMode(QString text1, QString text2,
+    bool refine, DiffDeadline deadline) const {
+  // Scan the text on a word-by-word basis first.
+  const QList<QVariant> b = diff_wordsToChars(text1, text2);
+  text1 = b[0].toString();
+  text2 = b[1].toString();
+  QStringList wordarray = b[2].toStringList();
+
+  QList<Diff> diffs = diff_main(text1, text2, false, deadline);
+
+  // Convert the diff back to original text.
+  diff_charsToLines(diffs, wordarray);
+  // Eliminate freak matches (e.g. lone spaces)
+  diff_cleanupSemantic(diffs);
+  // The overlap elimination can leave empty edits behind.
+  diff_cleanupEmpty(diffs);
+
+  if (refine) {
+    diff_refine(diffs, CHARACTERS, deadline);
+    diff_cleanupMerge(diffs);
+  }
+  return diffs;
+}
+
+
+QList<Diff> diff_match_patch::diff_hierarchical(const QString &text1,
+    const QString &text2, const QList<Granularity> &levels) const {
+  // Set a deadline by which time the diff must be complete.
+  qint64 budget;
+  const DiffDeadline deadline = diff_deadline(budget);
+  return diff_hierarchical(text1, text2, levels, deadline);
+}
+
+
+QList<Diff> diff_match_patch::diff_hierarchical(const QString &text1,
+    const QString &text2, const QList<Granularity> &levels,
+    DiffDeadline deadline) const {
+  // Check for null inputs.
+  if (text1.isNull() || text2.isNull()) {
+    throw "Null inputs. (diff_hierarchical)";
+  }
+  if (levels.isEmpty()) {
+    return diff_main(text1, text2, false, deadline);
+  }
+
+  // The first level diffs the whole text, each later one only the
+  // replacement blocks left by the level above.
+  QList<Diff> diffs = diff_granular(text1, text2, levels.first(), deadline);
+  if (levels.first() != CHARACTERS) {
+    // Eliminate freak matches (e.g. blank lines)
+    diff_cleanupSemantic(diffs);
+    // The overlap elimination can leave empty edits behind.
+    diff_cleanupEmpty(diffs);
+  }
+  for (int x = 1; x < levels.size(); x++) {
+    diff_refine(diffs, levels[x], deadline);
+  }
+
+  if (levels.last() == CHARACTERS) {
+    diff_cleanupMerge(diffs);
+  }
+  return diffs;
+}
+
+
+QList<Diff> diff_match_patch::diff_granular(const QString &text1,
+    const QString &text2, Granularity granularity, DiffDeadline deadline) const {
+  if (granularity == CHARACTERS || text1.isEmpty() || text2.isEmpty()) {
+    return diff_main(text1, text2, false, deadline);
+  }
+  const QList<QVariant> b = diff_tokensToChars(text1, text2, granularity);
+  QList<Diff> diffs = diff_main(b[0].toString(), b[1].toString(), false,
+                                deadline);
+  diff_charsToLines(diffs, b[2].toStringList());
+  return diffs;
+}
+
+
+void diff_match_patch::diff_refine(QList<Diff> &diffs,
+                                   Granularity granularity,
+                                   DiffDeadline deadline) const {
+  // Collect the replacement blocks.  The end of the list acts as a final
+  // equality.
+  QList<DiffJob *> jobs;
+  int count_delete = 0;
+  int count_insert = 0;
+  QString text_delete = "";
+  QString text_insert = "";
+  for (int x = 0; x <= diffs.size(); x++) {
+    const Operation op = x < diffs.size() ? diffs[x].operation : EQUAL;
+    if (op == DELETE) {
+      count_delete++;
+      text_delete += diffs[x].text;
+    } else if (op == INSERT) {
+      count_insert++;
+      text_insert += diffs[x].text;
+    } else {
+      if (count_delete >= 1 && count_insert >= 1) {
+        const int count = count_delete + count_insert;
+        jobs.append(new DiffJob(this, text_delete, text_insert, granularity,
+                                deadline, x - count, count));
+      }
+      count_delete = 0;
+      count_insert = 0;
+      text_delete = "";
+      text_insert = "";
+    }
+  }
+
+  QAtomicInt finished(0);
+  foreach (DiffJob *job, jobs) {
+    job->finished = &finished;
+    job->total = jobs.size();
+  }
+
+  if (deadline.budget != NULL) {
+    // Give each block a share of the work left in proportion to its length,
+    // so that the result doesn't depend on the order the blocks finish in.
+    qint64 length = 0;
+    foreach (DiffJob *job, jobs) {
+      length += job->text1.length() + job->text2.length();
+    }
+    const double left = qMax(*deadline.budget, Q_INT64_C(0));
+    foreach (DiffJob *job, jobs) {
+      job->budget = static_cast<qint64>(
+          left * (job->text1.length() + job->text2.length()) / length);
+      job->deadline.budget = &job->budget;
+      *deadline.budget -= job->budget;
+    }
+  }
+
+  if (Diff_Threads > 1 && jobs.size() > 1) {
+    // Start the largest blocks first so that none is left running alone.
+    QList<DiffJob *> largest = jobs;
+    qSort(largest.begin(), largest.end(), DiffJob::largerThan);
+    DiffJobQueue queue(largest);
+    runBatch(queue, Diff_Threads);
+  } else {
+    foreach (DiffJob *job, jobs) {
+      job->run();
+    }
+  }
+
+  // Splice the results back in.
+  QList<Diff> refined;
+  int pointer = 0;
+  foreach (DiffJob *job, jobs) {
+    while (pointer < job->index) {
+      refined.append(diffs[pointer++]);
+    }
+    refined += job->diffs;
+    pointer += job->count;
+    if (deadline.budget != NULL && job->budget > 0) {
+      // Return the unspent share.
+      *deadline.budget += job->budget;
+    }
+    delete job;
+  }
+  while (pointer < diffs.size()) {
+    refined.append(diffs[pointer++]);
+  }
+  diffs = refined;
+}
+
+
+void diff_match_patch::diff_cleanupEmpty(QList<Diff> &diffs) const {
+  QList<Diff> merged;
+  foreach (const Diff &aDiff, diffs) {
+    if (aDiff.text.isEmpty()) {
+      continue;
+    }
+    if (!merged.isEmpty() && merged.last().operation == aDiff.operation) {
+      merged.last().text += aDiff.text;
+    } else {
+      merged.append(aDiff);
+    }
+  }
+  diffs = merged;
 }
 
-QList<Diff> diff_match_patch::diff_bisectSplit(const QString &text1,
-    const QString &text2, int x, int y, clock_t deadline) {
-  QString text1a = text1.left(x);
-  QString text2a = text2.left(y);
-  QString text1b = safeMid(text1, x);
-  QString text2b = safeMid(text2, y);
 
-  // Compute both diffs serially.
-  QList<Diff> diffs = diff_main(text1a, text2a, false, deadline);
-  QList<Diff> diffsb = diff_main(text1b, text2b, false, deadline);
+QList<Diff> diff_match_patch::diff_bisect(const QString &text1,
+    const QString &text2, DiffDeadline deadline) const {
+  const QList<DiffRun> runs = diff_core<const QChar *>::diff_bisect(
+      text1.unicode(), text1.length(), text2.unicode(), text2.length(),
+      diff_halfMatchAllowed(), diff_coreDeadline(deadline, false));
+  return runsToDiffs(runs, text1, text2);
+}
 
-  return diffs + diffsb;
+QList<Diff> diff_match_patch::diff_bitLcs(const QString &text1,
+    const QString &text2, DiffDeadline deadline) const {
+  deadline.spend(std::max(text1.length(), text2.length()));
+  const QList<DiffRun> runs = diff_core<const QChar *>::diff_bitLcs(
+      text1.unicode(), text1.length(), text2.unicode(), text2.length());
+  return runsToDiffs(runs, text1, text2);
 }
 
+
 QList<QVariant> diff_match_patch::diff_linesToChars(const QString &text1,
-                                                    const QString &text2) {
+                                                    const QString &text2) const {
   QStringList lineArray;
   QMap<QString, int> lineHash;
   // e.g. linearray[4] == "Hello\n"
@@ -512,8 +3055,11 @@ QList<QVariant> diff_match_patch::diff_linesToChars(const QString &text1,
   // So we'll insert a junk entry to avoid generating a null character.
   lineArray.append("");
 
-  const QString chars1 = diff_linesToCharsMunge(text1, lineArray, lineHash);
-  const QString chars2 = diff_linesToCharsMunge(text2, lineArray, lineHash);
+  // Leave room in the hashes for text2 once text1 has been encoded.
+  const QString chars1 = diff_linesToCharsMunge(text1, lineArray, lineHash,
+                                                40000);
+  const QString chars2 = diff_linesToCharsMunge(text2, lineArray, lineHash,
+                                                65535);
 
   QList<QVariant> listRet;
   listRet.append(QVariant::fromValue(chars1));
@@ -525,7 +3071,8 @@ QList<QVariant> diff_match_patch::diff_linesToChars(const QString &text1,
 
 QString diff_match_patch::diff_linesToCharsMunge(const QString &text,
                                                  QStringList &lineArray,
-                                                 QMap<QString, int> &lineHash) {
+                                                 QMap<QString, int> &lineHash,
+                                                 int maxLines) const {
   int lineStart = 0;
   int lineEnd = -1;
   QString line;
@@ -533,13 +3080,15 @@ QString diff_match_patch::diff_linesToCharsMunge(const QString &text,
   // Walk the text, pulling out a substring for each line.
   // text.split('\n') would would temporarily double our memory footprint.
   // Modifying text would create many large strings to garbage collect.
-  while (lineEnd < text.length() - 1) {
-    lineEnd = text.indexOf('\n', lineStart);
-    if (lineEnd == -1) {
-      lineEnd = text.length() - 1;
+  while (lineStart < text.length()) {
+    if (lineArray.size() == maxLines) {
+      // Out of hashes, so the rest of the text becomes one line.
+      lineEnd = text.length();
+    } else {
+      lineEnd = findLineEnd(text, lineStart);
     }
-    line = safeMid(text, lineStart, lineEnd + 1 - lineStart);
-    lineStart = lineEnd + 1;
+    line = safeMid(text, lineStart, lineEnd - lineStart);
+    lineStart = lineEnd;
 
     if (lineHash.contains(line)) {
       chars += QChar(static_cast<ushort>(lineHash.value(line)));
@@ -553,9 +3102,133 @@ QString diff_match_patch::diff_linesToCharsMunge(const QString &text,
 }
 
 
+QList<QVariant> diff_match_patch::diff_wordsToChars(const QString &text1,
+                                                    const QString &text2) const {
+  return diff_tokensToChars(text1, text2, WORDS);
+}
+
+
+QList<QVariant> diff_match_patch::diff_tokensToChars(const QString &text1,
+    const QString &text2, Granularity granularity) const {
+  QStringList tokenArray;
+  QMap<QString, int> tokenHash;
+  // e.g. tokenArray[4] == "Hello"
+  // e.g. tokenHash.get("Hello") == 4
+
+  // "\x00" is a valid character, but various debuggers don't like it.
+  // So we'll insert a junk entry to avoid generating a null character.
+  tokenArray.append("");
+
+  // Leave room in the hashes for text2 once text1 has been encoded.
+  QString chars1;
+  QString chars2;
+  switch (granularity) {
+    case PARAGRAPHS:
+      chars1 = diff_paragraphsToCharsMunge(text1, tokenArray, tokenHash,
+                                           40000);
+      chars2 = diff_paragraphsToCharsMunge(text2, tokenArray, tokenHash,
+                                           65535);
+      break;
+    case LINES:
+      chars1 = diff_linesToCharsMunge(text1, tokenArray, tokenHash, 40000);
+      chars2 = diff_linesToCharsMunge(text2, tokenArray, tokenHash, 65535);
+      break;
+    case WORDS:
+      chars1 = diff_wordsToCharsMunge(text1, tokenArray, tokenHash, 40000);
+      chars2 = diff_wordsToCharsMunge(text2, tokenArray, tokenHash, 65535);
+      break;
+    case CHARACTERS:
+      throw "Characters are not tokens. (diff_tokensToChars)";
+  }
+
+  QList<QVariant> listRet;
+  listRet.append(QVariant::fromValue(chars1));
+  listRet.append(QVariant::fromValue(chars2));
+  listRet.append(QVariant::fromValue(tokenArray));
+  return listRet;
+}
+
+
+QString diff_match_patch::diff_wordsToCharsMunge(const QString &text,
+                                                 QStringList &lineArray,
+                                                 QMap<QString, int> &lineHash,
+                                                 int maxTokens) const {
+  const int length = text.length();
+  int tokenStart = 0;
+  QString token;
+  QString chars = "";
+  while (tokenStart < length) {
+    const QChar ch = text[tokenStart];
+    int tokenEnd = tokenStart + 1;
+    if (lineArray.size() == maxTokens) {
+      // Out of hashes, so the rest of the text becomes one token.
+      tokenEnd = length;
+    } else if (ch.isLetterOrNumber()) {
+      while (tokenEnd < length && text[tokenEnd].isLetterOrNumber()) {
+        tokenEnd++;
+      }
+    } else if (ch.isSpace()) {
+      while (tokenEnd < length && text[tokenEnd].isSpace()) {
+        tokenEnd++;
+      }
+    } else if (ch.isHighSurrogate() && tokenEnd < length
+        && text[tokenEnd].isLowSurrogate()) {
+      // Keep surrogate pairs together.
+      tokenEnd++;
+    }
+    token = safeMid(text, tokenStart, tokenEnd - tokenStart);
+    tokenStart = tokenEnd;
+
+    if (lineHash.contains(token)) {
+      chars += QChar(static_cast<ushort>(lineHash.value(token)));
+    } else {
+      lineArray.append(token);
+      lineHash.insert(token, lineArray.size() - 1);
+      chars += QChar(static_cast<ushort>(lineArray.size() - 1));
+    }
+  }
+  return chars;
+}
+
+
+QString diff_match_patch::diff_paragraphsToCharsMunge(const QString &text,
+    QStringList &lineArray, QMap<QString, int> &lineHash, int maxTokens) const {
+  const int length = text.length();
+  int paragraphStart = 0;
+  int paragraphEnd;
+  QString paragraph;
+  QString chars = "";
+  // Walk the text, pulling out a substring for each paragraph.
+  while (paragraphStart < length) {
+    paragraphEnd = text.indexOf("\n\n", paragraphStart);
+    if (paragraphEnd == -1 || lineArray.size() == maxTokens) {
+      paragraphEnd = length;
+    } else {
+      // Keep the whole run of blank lines with the paragraph.
+      paragraphEnd += 2;
+      while (paragraphEnd < length && text[paragraphEnd] == '\n') {
+        paragraphEnd++;
+      }
+    }
+    paragraph = safeMid(text, paragraphStart,
+                        paragraphEnd - paragraphStart);
+    paragraphStart = paragraphEnd;
+
+    if (lineHash.contains(paragraph)) {
+      chars += QChar(static_cast<ushort>(lineHash.value(paragraph)));
+    } else {
+      lineArray.append(paragraph);
+      lineHash.insert(paragraph, lineArray.size() - 1);
+      chars += QChar(static_cast<ushort>(lineArray.size() - 1));
+    }
+  }
+  return chars;
+}
+
+
 
 void diff_match_patch::diff_charsToLines(QList<Diff> &diffs,
-                                         const QStringList &lineArray) {
+                                         const QStringList &lineArray) const {
   // Qt has no mutable foreach construct.
   QMutableListIterator<Diff> i(diffs);
   while (i.hasNext()) {
@@ -570,34 +3243,22 @@ void diff_match_patch::diff_charsToLines(QList<Diff> &diffs,
 
 
 int diff_match_patch::diff_commonPrefix(const QString &text1,
-                                        const QString &text2) {
+                                        const QString &text2) const {
   // Performance analysis: http://neil.fraser.name/news/2007/10/09/
-  const int n = std::min(text1.length(), text2.length());
-  for (int i = 0; i < n; i++) {
-    if (text1[i] != text2[i]) {
-      return i;
-    }
-  }
-  return n;
+  return diff_core<const QChar *>::diff_commonPrefix(text1.unicode(),
+      text1.length(), text2.unicode(), text2.length());
 }
 
 
 int diff_match_patch::diff_commonSuffix(const QString &text1,
-                                        const QString &text2) {
+                                        const QString &text2) const {
   // Performance analysis: http://neil.fraser.name/news/2007/10/09/
-  const int text1_length = text1.length();
-  const int text2_length = text2.length();
-  const int n = std::min(text1_length, text2_length);
-  for (int i = 1; i <= n; i++) {
-    if (text1[text1_length - i] != text2[text2_length - i]) {
-      return i - 1;
-    }
-  }
-  return n;
+  return diff_core<const QChar *>::diff_commonSuffix(text1.unicode(),
+      text1.length(), text2.unicode(), text2.length());
 }
 
 int diff_match_patch::diff_commonOverlap(const QString &text1,
-                                         const QString &text2) {
+                                         const QString &text2) const {
   // Cache the text lengths to prevent multiple calls.
   const int text1_length = text1.length();
   const int text2_length = text2.length();
@@ -639,81 +3300,32 @@ int diff_match_patch::diff_commonOverlap(const QString &text1,
 }
 
 QStringList diff_match_patch::diff_halfMatch(const QString &text1,
-                                             const QString &text2) {
-  if (Diff_Timeout <= 0) {
-    // Don't risk returning a non-optimal diff if we have unlimited time.
-    return QStringList();
-  }
-  const QString longtext = text1.length() > text2.length() ? text1 : text2;
-  const QString shorttext = text1.length() > text2.length() ? text2 : text1;
-  if (longtext.length() < 4 || shorttext.length() * 2 < longtext.length()) {
-    return QStringList();  // Pointless.
-  }
+                                             const QString &text2) const {
+  return diff_halfMatch(text1, text2, std::numeric_limits<clock_t>::max());
+}
+
 
-  // First check if the second quarter is the seed for a half-match.
-  const QStringList hm1 = diff_halfMatchI(longtext, shorttext,
-      (longtext.length() + 3) / 4);
-  // Check again based on the third quarter.
-  const QStringList hm2 = diff_halfMatchI(longtext, shorttext,
-      (longtext.length() + 1) / 2);
-  QStringList hm;
-  if (hm1.isEmpty() && hm2.isEmpty()) {
+QStringList diff_match_patch::diff_halfMatch(const QString &text1,
+    const QString &text2, DiffDeadline deadline) const {
+  if (!diff_halfMatchAllowed()) {
+    // Don't risk returning a non-optimal diff if we have unlimited time.
     return QStringList();
-  } else if (hm2.isEmpty()) {
-    hm = hm1;
-  } else if (hm1.isEmpty()) {
-    hm = hm2;
-  } else {
-    // Both matched.  Select the longest.
-    hm = hm1[4].length() > hm2[4].length() ? hm1 : hm2;
   }
-
-  // A half-match was found, sort out the return data.
-  if (text1.length() > text2.length()) {
-    return hm;
-  } else {
-    QStringList listRet;
-    listRet << hm[2] << hm[3] << hm[0] << hm[1] << hm[4];
-    return listRet;
-  }
-}
-
-
-QStringList diff_match_patch::diff_halfMatchI(const QString &longtext,
-                                              const QString &shorttext,
-                                              int i) {
-  // Start with a 1/4 length substring at position i as a seed.
-  const QString seed = safeMid(longtext, i, longtext.length() / 4);
-  int j = -1;
-  QString best_common;
-  QString best_longtext_a, best_longtext_b;
-  QString best_shorttext_a, best_shorttext_b;
-  while ((j = shorttext.indexOf(seed, j + 1)) != -1) {
-    const int prefixLength = diff_commonPrefix(safeMid(longtext, i),
-        safeMid(shorttext, j));
-    const int suffixLength = diff_commonSuffix(longtext.left(i),
-        shorttext.left(j));
-    if (best_common.length() < suffixLength + prefixLength) {
-      best_common = safeMid(shorttext, j - suffixLength, suffixLength)
-          + safeMid(shorttext, j, prefixLength);
-      best_longtext_a = longtext.left(i - suffixLength);
-      best_longtext_b = safeMid(longtext, i + prefixLength);
-      best_shorttext_a = shorttext.left(j - suffixLength);
-      best_shorttext_b = safeMid(shorttext, j + prefixLength);
-    }
-  }
-  if (best_common.length() * 2 >= longtext.length()) {
-    QStringList listRet;
-    listRet << best_longtext_a << best_longtext_b << best_shorttext_a
-        << best_shorttext_b << best_common;
-    return listRet;
-  } else {
+  int common1, common2, commonLength;
+  if (!diff_core<const QChar *>::diff_halfMatch(text1.unicode(),
+      text1.length(), text2.unicode(), text2.length(), deadline, common1,
+      common2, commonLength)) {
     return QStringList();
   }
+  QStringList listRet;
+  listRet << text1.left(common1) << safeMid(text1, common1 + commonLength)
+      << text2.left(common2) << safeMid(text2, common2 + commonLength)
+      << text1.mid(common1, commonLength);
+  return listRet;
 }
 
 
-void diff_match_patch::diff_cleanupSemantic(QList<Diff> &diffs) {
+void diff_match_patch::diff_cleanupSemantic(QList<Diff> &diffs) const {
   if (diffs.isEmpty()) {
     return;
   }
@@ -856,7 +3468,7 @@ void diff_match_patch::diff_cleanupSemantic(QList<Diff> &diffs) {
 }
 
 
-void diff_match_patch::diff_cleanupSemanticLossless(QList<Diff> &diffs) {
+void diff_match_patch::diff_cleanupSemanticLossless(QList<Diff> &diffs) const {
   QString equality1, edit, equality2;
   QString commonString;
   int commonOffset;
@@ -937,8 +3549,49 @@ void diff_match_patch::diff_cleanupSemanticLossless(QList<Diff> &diffs) {
 }
 
 
+/**
+ * Does the text end with a blank line (matches /\n\r?\n$/)?
+ * Plain character tests rather than a shared QRegExp, which keeps
+ * diff_cleanupSemanticScore reentrant.
+ * @param text Text to test.
+ * @return True if there is a blank line at the end.
+ */
+static bool blankLineEnd(const QString &text) {
+  int i = text.length() - 1;
+  if (i < 1 || text[i] != '\n') {
+    return false;
+  }
+  i--;
+  if (text[i] == '\r') {
+    i--;
+  }
+  return i >= 0 && text[i] == '\n';
+}
+
+
+/**
+ * Does the text start with a blank line (matches /^\r?\n\r?\n/)?
+ * @param text Text to test.
+ * @return True if there is a blank line at the start.
+ */
+static bool blankLineStart(const QString &text) {
+  const int length = text.length();
+  int i = 0;
+  for (int lines = 0; lines < 2; lines++) {
+    if (i < length && text[i] == '\r') {
+      i++;
+    }
+    if (i >= length || text[i] != '\n') {
+      return false;
+    }
+    i++;
+  }
+  return true;
+}
+
+
 int diff_match_patch::diff_cleanupSemanticScore(const QString &one,
-                                                const QString &two) {
+                                                const QString &two) const {
   if (one.isEmpty() || two.isEmpty()) {
     // Edges are the best.
     return 6;
@@ -957,8 +3610,8 @@ int diff_match_patch::diff_cleanupSemanticScore(const QString &one,
   bool whitespace2 = nonAlphaNumeric2 && char2.isSpace();
   bool lineBreak1 = whitespace1 && char1.category() == QChar::Other_Control;
   bool lineBreak2 = whitespace2 && char2.category() == QChar::Other_Control;
-  bool blankLine1 = lineBreak1 && BLANKLINEEND.indexIn(one) != -1;
-  bool blankLine2 = lineBreak2 && BLANKLINESTART.indexIn(two) != -1;
+  bool blankLine1 = lineBreak1 && blankLineEnd(one);
+  bool blankLine2 = lineBreak2 && blankLineStart(two);
 
   if (blankLine1 || blankLine2) {
     // Five points for blank lines.
@@ -980,12 +3633,7 @@ int diff_match_patch::diff_cleanupSemanticScore(const QString &one,
 }
 
 
-// Define some regex patterns for matching boundaries.
-QRegExp diff_match_patch::BLANKLINEEND = QRegExp("\\n\\r?\\n$");
-QRegExp diff_match_patch::BLANKLINESTART = QRegExp("^\\r?\\n\\r?\\n");
-
-
-void diff_match_patch::diff_cleanupEfficiency(QList<Diff> &diffs) {
+void diff_match_patch::diff_cleanupEfficiency(QList<Diff> &diffs) const {
   if (diffs.isEmpty()) {
     return;
   }
@@ -1093,7 +3741,7 @@ void diff_match_patch::diff_cleanupEfficiency(QList<Diff> &diffs) {
 }
 
 
-void diff_match_patch::diff_cleanupMerge(QList<Diff> &diffs) {
+void diff_match_patch::diff_cleanupMerge(QList<Diff> &diffs) const {
   diffs.append(Diff(EQUAL, ""));  // Add a dummy entry at the end.
   QMutableListIterator<Diff> pointer(diffs);
   int count_delete = 0;
@@ -1241,7 +3889,7 @@ void diff_match_patch::diff_cleanupMerge(QList<Diff> &diffs) {
 }
 
 
-int diff_match_patch::diff_xIndex(const QList<Diff> &diffs, int loc) {
+int diff_match_patch::diff_xIndex(const QList<Diff> &diffs, int loc) const {
   int chars1 = 0;
   int chars2 = 0;
   int last_chars1 = 0;
@@ -1273,7 +3921,7 @@ int diff_match_patch::diff_xIndex(const QList<Diff> &diffs, int loc) {
 }
 
 
-QString diff_match_patch::diff_prettyHtml(const QList<Diff> &diffs) {
+QString diff_match_patch::diff_prettyHtml(const QList<Diff> &diffs) const {
   QString html;
   QString text;
   foreach(Diff aDiff, diffs) {
@@ -1298,7 +3946,7 @@ QString diff_match_patch::diff_prettyHtml(const QList<Diff> &diffs) {
 }
 
 
-QString diff_match_patch::diff_text1(const QList<Diff> &diffs) {
+QString diff_match_patch::diff_text1(const QList<Diff> &diffs) const {
   QString text;
   foreach(Diff aDiff, diffs) {
     if (aDiff.operation != INSERT) {
@@ -1309,7 +3957,7 @@ QString diff_match_patch::diff_text1(const QList<Diff> &diffs) {
 }
 
 
-QString diff_match_patch::diff_text2(const QList<Diff> &diffs) {
+QString diff_match_patch::diff_text2(const QList<Diff> &diffs) const {
   QString text;
   foreach(Diff aDiff, diffs) {
     if (aDiff.operation != DELETE) {
@@ -1320,7 +3968,7 @@ QString diff_match_patch::diff_text2(const QList<Diff> &diffs) {
 }
 
 
-int diff_match_patch::diff_levenshtein(const QList<Diff> &diffs) {
+int diff_match_patch::diff_levenshtein(const QList<Diff> &diffs) const {
   int levenshtein = 0;
   int insertions = 0;
   int deletions = 0;
@@ -1345,16 +3993,137 @@ int diff_match_patch::diff_levenshtein(const QList<Diff> &diffs) {
 }
 
 
-QString diff_match_patch::diff_toDelta(const QList<Diff> &diffs) {
+int diff_match_patch::diff_editDistance(const QString &text1,
+                                         const QString &text2) const {
+  return diff_editDistance(text1, text2, -1);
+}
+
+
+int diff_match_patch::diff_editDistance(const QString &text1,
+    const QString &text2, int maxDistance) const {
+  // Check for null inputs.
+  if (text1.isNull() || text2.isNull()) {
+    throw "Null inputs. (diff_editDistance)";
+  }
+
+  // Trim off common prefix and suffix (speedup).
+  const int prefix = diff_commonPrefix(text1, text2);
+  const int suffix = std::min(diff_commonSuffix(text1, text2),
+      std::min(text1.length(), text2.length()) - prefix);
+
+  // The shorter text runs down the rows of the grid, one bit per row.
+  const bool swapped = text1.length() > text2.length();
+  const QChar *a = (swapped ? text2 : text1).unicode() + prefix;
+  const QChar *b = (swapped ? text1 : text2).unicode() + prefix;
+  const int m = (swapped ? text2 : text1).length() - prefix - suffix;
+  const int n = (swapped ? text1 : text2).length() - prefix - suffix;
+  if (maxDistance >= 0 && n - m > maxDistance) {
+    // Every extra character is an edit.
+    return -1;
+  }
+  if (m == 0) {
+    return n;
+  }
+
+  // Bit i of word w of a character's row is set where row 64 * w + i holds
+  // the character.  ASCII rows are looked up directly.
+  const int words = (m + 63) / 64;
+  QVector<quint64> peq((128 + 1) * words, 0);
+  QHash<ushort, int> rows;
+  for (int i = 0; i < m; i++) {
+    const ushort c = a[i].unicode();
+    int row = c;
+    if (c >= 128) {
+      row = rows.value(c, -1);
+      if (row == -1) {
+        row = peq.size() / words;
+        rows.insert(c, row);
+        peq.resize(peq.size() + words);
+      }
+    }
+    peq[row * words + i / 64] |= quint64(1) << (i % 64);
+  }
+  const quint64 *eqs = peq.constData();
+  // Row 128 has no bits set, for characters which don't occur in a.
+  const quint64 *none = eqs + 128 * words;
+
+  // Myers 1999: A Fast Bit-Vector Algorithm for Approximate String Matching
+  // Based on Dynamic Programming, with the blocks of Hyyro 2003.  Each
+  // column holds the vertical deltas of the edit distance table as a set
+  // of +1 bits (pv) and -1 bits (mv); score tracks the bottom row.
+  QVector<quint64> pvs(words, ~quint64(0));
+  QVector<quint64> mvs(words, 0);
+  quint64 *pv = pvs.data();
+  quint64 *mv = mvs.data();
+  const quint64 last = quint64(1) << ((m - 1) % 64);
+  int score = m;
+  for (int j = 0; j < n; j++) {
+    const ushort c = b[j].unicode();
+    const quint64 *eq = c < 128 ? eqs + c * words
+        : (rows.contains(c) ? eqs + rows.value(c) * words : none);
+    // The top row of the table counts up by one per column.
+    int carry = 1;
+    for (int w = 0; w < words; w++) {
+      quint64 e = eq[w];
+      const quint64 xv = e | mv[w];
+      if (carry < 0) {
+        e |= 1;
+      }
+      const quint64 xh = (((e & pv[w]) + pv[w]) ^ pv[w]) | e;
+      quint64 ph = mv[w] | ~(xh | pv[w]);
+      quint64 mh = pv[w] & xh;
+      const quint64 high = w == words - 1 ? last : quint64(1) << 63;
+      const int out = (ph & high) ? 1 : ((mh & high) ? -1 : 0);
+      ph <<= 1;
+      mh <<= 1;
+      if (carry < 0) {
+        mh |= 1;
+      } else if (carry > 0) {
+        ph |= 1;
+      }
+      pv[w] = mh | ~(xv | ph);
+      mv[w] = ph & xv;
+      carry = out;
+    }
+    score += carry;
+    // The bottom row changes by at most one per column, so give up once it
+    // can't come back under the bound.
+    if (maxDistance >= 0 && score - (n - 1 - j) > maxDistance) {
+      return -1;
+    }
+  }
+  return score;
+}
+
+
+float diff_match_patch::diff_similarity(const QString &text1,
+                                        const QString &text2) const {
+  // Check for null inputs.
+  if (text1.isNull() || text2.isNull()) {
+    throw "Null inputs. (diff_similarity)";
+  }
+  if (text1 == text2) {
+    return 1.0f;
+  }
+  // Compare only what is left once the common prefix and suffix are gone,
+  // as that is all a diff has to work on.
+  const int prefix = diff_commonPrefix(text1, text2);
+  const int suffix = std::min(diff_commonSuffix(text1, text2),
+      std::min(text1.length(), text2.length()) - prefix);
+  return sketchSimilarity(text1.mid(prefix, text1.length() - prefix - suffix),
+                          text2.mid(prefix, text2.length() - prefix - suffix));
+}
+
+
+QString diff_match_patch::diff_toDelta(const QList<Diff> &diffs) const {
   QString text;
   foreach(Diff aDiff, diffs) {
     switch (aDiff.operation) {
-      case INSERT: {
-        QString encoded = QString(QUrl::toPercentEncoding(aDiff.text,
-            " !~*'();/?:@&=+$,#"));
-        text += QString("+") + encoded + QString("\t");
+      case INSERT:
+        text += QChar('+');
+        appendEncoded(text, aDiff.text);
+        text += QChar('\t');
         break;
-      }
       case DELETE:
         text += QString("-") + QString::number(aDiff.text.length())
             + QString("\t");
@@ -1373,8 +4142,16 @@ QString diff_match_patch::diff_toDelta(const QList<Diff> &diffs) {
 }
 
 
+void diff_match_patch::diff_toDelta(const QList<Diff> &diffs,
+                                    QIODevice *device) const {
+  PatchWriter writer(device);
+  writer.writeDelta(diffs);
+  writer.flush();
+}
+
+
 QList<Diff> diff_match_patch::diff_fromDelta(const QString &text1,
-                                             const QString &delta) {
+                                             const QString &delta) const {
   QList<Diff> diffs;
   int pointer = 0;  // Cursor in text1
   QStringList tokens = delta.split("\t");
@@ -1388,7 +4165,7 @@ QList<Diff> diff_match_patch::diff_fromDelta(const QString &text1,
     QString param = safeMid(token, 1);
     switch (token[0].toAscii()) {
       case '+':
-        param = QUrl::fromPercentEncoding(qPrintable(param));
+        param = decodeEscapes(param);
         diffs.append(Diff(INSERT, param));
         break;
       case '-':
@@ -1422,11 +4199,339 @@ QList<Diff> diff_match_patch::diff_fromDelta(const QString &text1,
 }
 
 
+QByteArray diff_match_patch::diff_toBinaryDelta(const QList<Diff> &diffs) const {
+  return diff_toBinaryDelta(diffs, true);
+}
+
+
+QByteArray diff_match_patch::diff_toBinaryDelta(const QList<Diff> &diffs,
+                                                bool checksum) const {
+  quint32 hash = 2166136261u;
+  if (checksum) {
+    foreach(const Diff &aDiff, diffs) {
+      if (aDiff.operation != INSERT) {
+        hash = binaryChecksum(hash, aDiff.text);
+      }
+    }
+  }
+  QByteArray delta;
+  binaryAppendHeader(delta, BINARY_DELTA, checksum, hash);
+  foreach(const Diff &aDiff, diffs) {
+    if (aDiff.operation == INSERT) {
+      binaryAppendText(delta, INSERT, aDiff.text);
+    } else {
+      binaryAppendTag(delta, aDiff.text.length(), aDiff.operation);
+    }
+  }
+  return delta;
+}
+
+
+QList<Diff> diff_match_patch::diff_fromBinaryDelta(const QString &text1,
+                                                   const QByteArray &delta) const {
+  const char *pos = delta.constData();
+  const char *end = pos + delta.size();
+  quint32 hash;
+  if (binaryReadHeader(pos, end, BINARY_DELTA, hash)
+      && binaryChecksum(2166136261u, text1) != hash) {
+    throw QString("Source text does not match the checksum of the delta.");
+  }
+  QList<Diff> diffs;
+  int pointer = 0;  // Cursor in text1
+  while (pos != end) {
+    const char *start = pos;
+    const quint32 tag = binaryReadVarint(pos, end);
+    if ((tag & 3) == INSERT) {
+      pos = start;
+      diffs.append(binaryReadText(pos, end));
+    } else if ((tag & 3) == DELETE || (tag & 3) == EQUAL) {
+      const quint32 n = tag >> 2;
+      if (n > static_cast<quint32>(text1.length() - pointer)) {
+        throw QString("Delta length (%1) larger than source text length (%2)")
+            .arg(pointer + n).arg(text1.length());
+      }
+      diffs.append(Diff(static_cast<Operation>(tag & 3),
+          safeMid(text1, pointer, n)));
+      pointer += n;
+    } else {
+      throw QString("Invalid diff operation in binary delta: %1")
+          .arg(tag & 3);
+    }
+  }
+  if (pointer != text1.length()) {
+    throw QString("Delta length (%1) smaller than source text length (%2)")
+        .arg(pointer).arg(text1.length());
+  }
+  return diffs;
+}
+
+
+QString diff_match_patch::diff_filesToDelta(const QString &path1,
+                                            const QString &path2) const {
+  QBuffer buffer;
+  buffer.open(QIODevice::WriteOnly);
+  diff_filesToDelta(path1, path2, &buffer);
+  // Deltas escape everything outside of ASCII.
+  return QString::fromLatin1(buffer.data().constData(), buffer.data().size());
+}
+
+
+void diff_match_patch::diff_filesToDelta(const QString &path1,
+                                         const QString &path2,
+                                         QIODevice *device) const {
+  // Set a deadline by which time the diff must be complete.
+  qint64 budget;
+  const DiffDeadline deadline = diff_deadline(budget);
+
+  QFile file1(path1);
+  QFile file2(path2);
+  qint64 length1, length2;
+  const char *text1 = mapFile(file1, length1);
+  const char *text2 = mapFile(file2, length2);
+  PatchWriter writer(device);
+
+  // Trim off the common prefix, rounded down to a whole line.
+  const qint64 minLength = qMin(length1, length2);
+  qint64 prefix = 0;
+  const qint64 block = 4096;
+  while (prefix + block <= minLength
+      && memcmp(text1 + prefix, text2 + prefix, block) == 0) {
+    prefix += block;
+  }
+  while (prefix < minLength && text1[prefix] == text2[prefix]) {
+    prefix++;
+  }
+  if (prefix == length1 && prefix == length2) {
+    // Identical files (speedup).
+    if (length1 != 0) {
+      writer.writeDeltaLength(EQUAL, mappedLength(text1, length1));
+    }
+    writer.flush();
+    return;
+  }
+  while (prefix > 0 && text1[prefix - 1] != '\n') {
+    prefix--;
+  }
+
+  // Trim off the common suffix, rounded up to start on a whole line.
+  qint64 suffix = 0;
+  while (suffix + block <= minLength - prefix
+      && memcmp(text1 + length1 - suffix - block,
+                text2 + length2 - suffix - block, block) == 0) {
+    suffix += block;
+  }
+  while (suffix < minLength - prefix
+      && text1[length1 - suffix - 1] == text2[length2 - suffix - 1]) {
+    suffix++;
+  }
+  if (suffix != 0
+      && ((length1 - suffix != prefix && text1[length1 - suffix - 1] != '\n')
+      || (length2 - suffix != prefix
+          && text2[length2 - suffix - 1] != '\n'))) {
+    const char *suffixStart = text1 + length1 - suffix;
+    const char *newline = static_cast<const char *>(
+        memchr(suffixStart, '\n', suffix));
+    suffix = newline == NULL ? 0 : suffix - (newline - suffixStart + 1);
+  }
+
+  // Diff the remaining lines, with one id per line.
+  const char *middle1 = text1 + prefix;
+  const char *middle2 = text2 + prefix;
+  QHash<QByteArray, int> lineHash;
+  int unhashed = 0;
+  QVector<int> ids1, ids2;
+  QVector<qint64> starts1, starts2;
+  mappedLinesToIds(middle1, length1 - prefix - suffix, lineHash, unhashed,
+      ids1, starts1);
+  mappedLinesToIds(middle2, length2 - prefix - suffix, lineHash, unhashed,
+      ids2, starts2);
+  QList<DiffRun> runs = diff_core<const int *>::diff_main(
+      ids1.constData(), ids1.size(), ids2.constData(), ids2.size(),
+      diff_halfMatchAllowed(), deadline);
+  // Eliminate freak matches (e.g. blank lines)
+  mappedCleanupLines(ids1.constData(), ids2.constData(), runs);
+  // Add a dummy entry at the end.
+  runs.append(DiffRun(EQUAL, 0));
+
+  // Walk the line diff, decoding only the replaced lines and rediffing
+  // them character-by-character.  Replacements too large to hold in
+  // memory, and lines which are only inserted, are copied straight from
+  // the mapping.
+  qint64 equal = mappedLength(text1, prefix);
+  int line1 = 0;  // Cursor in ids1
+  int line2 = 0;  // Cursor in ids2
+  int first1 = 0;  // Start of the current edit section in ids1
+  int first2 = 0;  // Start of the current edit section in ids2
+  foreach (const DiffRun &run, runs) {
+    if (run.operation == INSERT) {
+      line2 += run.length;
+      continue;
+    } else if (run.operation == DELETE) {
+      line1 += run.length;
+      continue;
+    }
+    const qint64 start1 = starts1[first1];
+    const qint64 start2 = starts2[first2];
+    const qint64 deleted = starts1[line1] - start1;
+    const qint64 inserted = starts2[line2] - start2;
+    if (deleted != 0 && inserted != 0 && deleted <= Diff_StreamWindow
+        && inserted <= Diff_StreamWindow) {
+      foreach (const Diff &charDiff, diff_main(
+          mappedText(middle1 + start1, deleted),
+          mappedText(middle2 + start2, inserted), false, deadline)) {
+        if (charDiff.operation == EQUAL) {
+          equal += charDiff.text.length();
+        } else if (charDiff.operation == DELETE) {
+          mappedFlushEqual(writer, equal);
+          writer.writeDeltaLength(DELETE, charDiff.text.length());
+        } else {
+          mappedFlushEqual(writer, equal);
+          writer.writeDeltaText(charDiff.text);
+        }
+      }
+    } else {
+      if (deleted != 0) {
+        mappedFlushEqual(writer, equal);
+        writer.writeDeltaLength(DELETE, mappedLength(middle1 + start1,
+                                                     deleted));
+      }
+      if (inserted != 0) {
+        mappedFlushEqual(writer, equal);
+        writer.writeDeltaText(middle2 + start2, inserted);
+      }
+    }
+    equal += mappedLength(middle1 + starts1[line1],
+                          starts1[line1 + run.length] - starts1[line1]);
+    line1 += run.length;
+    line2 += run.length;
+    first1 = line1;
+    first2 = line2;
+  }
+  equal += mappedLength(text1 + length1 - suffix, suffix);
+  mappedFlushEqual(writer, equal);
+  writer.flush();
+}
+
+
+void diff_match_patch::diff_stream(QIODevice *device1, QIODevice *device2,
+                                   DiffSink *sink) const {
+  const int limit = qMax(Diff_StreamWindow, 1);
+  QStringList lines1;
+  QStringList lines2;
+  int size1 = 0;
+  int size2 = 0;
+  Diff pending(EQUAL, "");
+  // Shared by every read; resize() leaves it unfilled.
+  QByteArray buffer;
+  buffer.resize(limit + 4);
+  while (true) {
+    const bool done1 = streamReadLines(device1, lines1, size1, limit,
+                                       buffer.data());
+    const bool done2 = streamReadLines(device2, lines2, size2, limit,
+                                       buffer.data());
+    if (lines1.isEmpty() && lines2.isEmpty()) {
+      break;
+    }
+
+    // Diff up to the next anchor, or everything if there is none or if both
+    // windows hold the rest of their streams.
+    int index1 = lines1.size();
+    int index2 = lines2.size();
+    const bool anchored = !(done1 && done2)
+        && streamAnchor(lines1, lines2, index1, index2);
+    foreach(Diff aDiff, diff_main(QStringList(lines1.mid(0, index1)).join(""),
+        QStringList(lines2.mid(0, index2)).join(""))) {
+      streamSend(sink, pending, aDiff, limit);
+    }
+    if (anchored) {
+      streamSend(sink, pending, Diff(EQUAL, lines1[index1]), limit);
+      index1++;
+      index2++;
+    }
+    for (int x = 0; x < index1; x++) {
+      size1 -= lines1[x].length();
+    }
+    for (int x = 0; x < index2; x++) {
+      size2 -= lines2[x].length();
+    }
+    lines1 = lines1.mid(index1);
+    lines2 = lines2.mid(index2);
+  }
+  if (!pending.text.isEmpty()) {
+    sink->receiveDiff(pending);
+  }
+}
+
+
+QList<Diff> diff_match_patch::diff_moves(const QString &text1,
+    const QString &text2, QList<DiffMove> &moves) const {
+  // Set a deadline by which time the diff must be complete.
+  qint64 budget;
+  const DiffDeadline deadline = diff_deadline(budget);
+  return diff_blockMoves(text1, text2, true, deadline, &moves);
+}
+
+
+QList<Diff> diff_match_patch::diff_blockMoves(const QString &text1,
+    const QString &text2, bool checklines, DiffDeadline deadline,
+    QList<DiffMove> *moves) const {
+  // Check for null inputs.
+  if (text1.isNull() || text2.isNull()) {
+    throw "Null inputs. (diff_moves)";
+  }
+  const QList<DiffMove> matches = blockMatches(text1, text2,
+                                               Diff_MoveBlockSize);
+  const QList<int> chain = blockChain(matches);
+
+  // Anchor on the blocks which kept their order and diff the gaps.
+  QList<Diff> diffs;
+  int pointer1 = 0;
+  int pointer2 = 0;
+  foreach (int m, chain) {
+    const DiffMove &anchor = matches[m];
+    diffs += diff_main(safeMid(text1, pointer1, anchor.index1 - pointer1),
+                       safeMid(text2, pointer2, anchor.index2 - pointer2),
+                       checklines, deadline);
+    diffs.append(Diff(EQUAL, safeMid(text1, anchor.index1, anchor.length)));
+    pointer1 = anchor.index1 + anchor.length;
+    pointer2 = anchor.index2 + anchor.length;
+  }
+  diffs += diff_main(safeMid(text1, pointer1), safeMid(text2, pointer2),
+                     checklines, deadline);
+  diff_cleanupMerge(diffs);
+
+  if (moves != NULL) {
+    // The other blocks moved, unless their text in text1 was kept by an
+    // anchor, in which case they are copies.
+    moves->clear();
+    QVector<int> anchorEnds;
+    foreach (int m, chain) {
+      anchorEnds.append(matches[m].index1 + matches[m].length);
+    }
+    int next = 0;
+    for (int m = 0; m < matches.size(); m++) {
+      if (next < chain.size() && chain[next] == m) {
+        next++;
+        continue;
+      }
+      const DiffMove &block = matches[m];
+      const int a = std::upper_bound(anchorEnds.begin(), anchorEnds.end(),
+                                     block.index1) - anchorEnds.begin();
+      if (a == chain.size()
+          || matches[chain[a]].index1 >= block.index1 + block.length) {
+        moves->append(block);
+      }
+    }
+  }
+  return diffs;
+}
+
+
   //  MATCH FUNCTIONS
 
 
 int diff_match_patch::match_main(const QString &text, const QString &pattern,
-                                 int loc) {
+                                 int loc) const {
   // Check for null inputs.
   if (text.isNull() || pattern.isNull()) {
     throw "Null inputs. (match_main)";
@@ -1451,7 +4556,7 @@ int diff_match_patch::match_main(const QString &text, const QString &pattern,
 
 
 int diff_match_patch::match_bitap(const QString &text, const QString &pattern,
-                                  int loc) {
+                                  int loc) const {
   if (!(Match_MaxBits == 0 || pattern.length() <= Match_MaxBits)) {
     throw "Pattern too long for this application.";
   }
@@ -1553,7 +4658,7 @@ int diff_match_patch::match_bitap(const QString &text, const QString &pattern,
 
 
 double diff_match_patch::match_bitapScore(int e, int x, int loc,
-                                          const QString &pattern) {
+                                          const QString &pattern) const {
   const float accuracy = static_cast<float> (e) / pattern.length();
   const int proximity = qAbs(loc - x);
   if (Match_Distance == 0) {
@@ -1564,7 +4669,7 @@ double diff_match_patch::match_bitapScore(int e, int x, int loc,
 }
 
 
-QMap<QChar, int> diff_match_patch::match_alphabet(const QString &pattern) {
+QMap<QChar, int> diff_match_patch::match_alphabet(const QString &pattern) const {
   QMap<QChar, int> s;
   int i;
   for (i = 0; i < pattern.length(); i++) {
@@ -1582,7 +4687,7 @@ QMap<QChar, int> diff_match_patch::match_alphabet(const QString &pattern) {
 //  PATCH FUNCTIONS
 
 
-void diff_match_patch::patch_addContext(Patch &patch, const QString &text) {
+void diff_match_patch::patch_addContext(Patch &patch, const QString &text) const {
   if (text.isEmpty()) {
     return;
   }
@@ -1625,7 +4730,7 @@ void diff_match_patch::patch_addContext(Patch &patch, const QString &text) {
 
 
 QList<Patch> diff_match_patch::patch_make(const QString &text1,
-                                          const QString &text2) {
+                                          const QString &text2) const {
   // Check for null inputs.
   if (text1.isNull() || text2.isNull()) {
     throw "Null inputs. (patch_make)";
@@ -1642,7 +4747,7 @@ QList<Patch> diff_match_patch::patch_make(const QString &text1,
 }
 
 
-QList<Patch> diff_match_patch::patch_make(const QList<Diff> &diffs) {
+QList<Patch> diff_match_patch::patch_make(const QList<Diff> &diffs) const {
   // No origin string provided, compute our own.
   const QString text1 = diff_text1(diffs);
   return patch_make(text1, diffs);
@@ -1651,7 +4756,7 @@ QList<Patch> diff_match_patch::patch_make(const QList<Diff> &diffs) {
 
 QList<Patch> diff_match_patch::patch_make(const QString &text1,
                                           const QString &text2,
-                                          const QList<Diff> &diffs) {
+                                          const QList<Diff> &diffs) const {
   // text2 is entirely unused.
   return patch_make(text1, diffs);
 
@@ -1660,7 +4765,7 @@ QList<Patch> diff_match_patch::patch_make(const QString &text1,
 
 
 QList<Patch> diff_match_patch::patch_make(const QString &text1,
-                                          const QList<Diff> &diffs) {
+                                          const QList<Diff> &diffs) const {
   // Check for null inputs.
   if (text1.isNull()) {
     throw "Null inputs. (patch_make)";
@@ -1742,7 +4847,29 @@ QList<Patch> diff_match_patch::patch_make(const QString &text1,
 }
 
 
-QList<Patch> diff_match_patch::patch_deepCopy(QList<Patch> &patches) {
+QList<Patch> diff_match_patch::patch_make(const DiffDocument &base,
+                                          const QString &text2) const {
+  QList<Diff> diffs = diff_main(base, text2);
+  if (diffs.size() > 2) {
+    diff_cleanupSemantic(diffs);
+    diff_cleanupEfficiency(diffs);
+  }
+
+  return patch_make(base.text(), diffs);
+}
+
+
+QList<QList<Patch> > diff_match_patch::patch_make_many(
+    const QList<QPair<QString, QString> > &pairs) const {
+  checkBatch(pairs, "Null inputs. (patch_make_many)");
+  QVector<QList<Patch> > results(pairs.size());
+  DiffBatch batch(this, pairs, true, NULL, results.data());
+  runBatch(batch, Diff_Threads);
+  return results.toList();
+}
+
+
+QList<Patch> diff_match_patch::patch_deepCopy(QList<Patch> &patches) const {
   QList<Patch> patchesCopy;
   foreach(Patch aPatch, patches) {
     Patch patchCopy = Patch();
@@ -1761,7 +4888,7 @@ QList<Patch> diff_match_patch::patch_deepCopy(QList<Patch> &patches) {
 
 
 QPair<QString, QVector<bool> > diff_match_patch::patch_apply(
-    QList<Patch> &patches, const QString &sourceText) {
+    QList<Patch> &patches, const QString &sourceText) const {
   QString text = sourceText;  // Copy to preserve original.
   if (patches.isEmpty()) {
     return QPair<QString,QVector<bool> >(text, QVector<bool>(0));
@@ -1782,6 +4909,11 @@ QPair<QString, QVector<bool> > diff_match_patch::patch_apply(
   int delta = 0;
   QVector<bool> results(patchesCopy.size());
   foreach(Patch aPatch, patchesCopy) {
+    if (diff_cancelled()) {
+      // Leave the remaining patches unapplied.
+      break;
+    }
+    diff_progress("patch_apply", x, patchesCopy.size());
     int expected_loc = aPatch.start2 + delta;
     QString text1 = diff_text1(aPatch.diffs);
     int start_loc;
@@ -1831,10 +4963,13 @@ QPair<QString, QVector<bool> > diff_match_patch::patch_apply(
           results[x] = false;
         } else {
           diff_cleanupSemanticLossless(diffs);
+          // Translate every edit through one index rather than rescanning
+          // the diff list with diff_xIndex each time.
+          const DiffIndex xIndex(diffs);
           int index1 = 0;
           foreach(Diff aDiff, aPatch.diffs) {
             if (aDiff.operation != EQUAL) {
-              int index2 = diff_xIndex(diffs, index1);
+              int index2 = xIndex.xIndex(index1);
               if (aDiff.operation == INSERT) {
                 // Insertion
                 text = text.left(start_loc + index2) + aDiff.text
@@ -1842,8 +4977,8 @@ QPair<QString, QVector<bool> > diff_match_patch::patch_apply(
               } else if (aDiff.operation == DELETE) {
                 // Deletion
                 text = text.left(start_loc + index2)
-                    + safeMid(text, start_loc + diff_xIndex(diffs,
-                    index1 + aDiff.text.length()));
+                    + safeMid(text, start_loc
+                    + xIndex.xIndex(index1 + aDiff.text.length()));
               }
             }
             if (aDiff.operation != DELETE) {
@@ -1862,7 +4997,7 @@ QPair<QString, QVector<bool> > diff_match_patch::patch_apply(
 }
 
 
-QString diff_match_patch::patch_addPadding(QList<Patch> &patches) {
+QString diff_match_patch::patch_addPadding(QList<Patch> &patches) const {
   short paddingLength = Patch_Margin;
   QString nullPadding = "";
   for (short x = 1; x <= paddingLength; x++) {
@@ -1920,7 +5055,7 @@ QString diff_match_patch::patch_addPadding(QList<Patch> &patches) {
 }
 
 
-void diff_match_patch::patch_splitMax(QList<Patch> &patches) {
+void diff_match_patch::patch_splitMax(QList<Patch> &patches) const {
   short patch_size = Match_MaxBits;
   QString precontext, postcontext;
   Patch patch;
@@ -2024,7 +5159,7 @@ void diff_match_patch::patch_splitMax(QList<Patch> &patches) {
 }
 
 
-QString diff_match_patch::patch_toText(const QList<Patch> &patches) {
+QString diff_match_patch::patch_toText(const QList<Patch> &patches) const {
   QString text;
   foreach(Patch aPatch, patches) {
     text.append(aPatch.toString());
@@ -2033,7 +5168,17 @@ QString diff_match_patch::patch_toText(const QList<Patch> &patches) {
 }
 
 
-QList<Patch> diff_match_patch::patch_fromText(const QString &textline) {
+void diff_match_patch::patch_toText(const QList<Patch> &patches,
+                                    QIODevice *device) const {
+  PatchWriter writer(device);
+  foreach(const Patch &aPatch, patches) {
+    writer.writePatch(aPatch);
+  }
+  writer.flush();
+}
+
+
+QList<Patch> diff_match_patch::patch_fromText(const QString &textline) const {
   QList<Patch> patches;
   if (textline.isEmpty()) {
     return patches;
@@ -2078,9 +5223,7 @@ QList<Patch> diff_match_patch::patch_fromText(const QString &textline) {
         continue;
       }
       sign = text.front()[0].toAscii();
-      line = safeMid(text.front(), 1);
-      line = line.replace("+", "%2B");  // decode would change all "+" to " "
-      line = QUrl::fromPercentEncoding(qPrintable(line));
+      line = decodeEscapes(safeMid(text.front(), 1));
       if (sign == '-') {
         // Deletion.
         patch.diffs.append(Diff(DELETE, line));
@@ -2106,3 +5249,72 @@ QList<Patch> diff_match_patch::patch_fromText(const QString &textline) {
   }
   return patches;
 }
+
+
+QList<Patch> diff_match_patch::patch_fromText(QIODevice *device) const {
+  QList<Patch> patches;
+  PatchReader reader(device);
+  Patch patch;
+  while (reader.readPatch(patch)) {
+    patches.append(patch);
+  }
+  return patches;
+}
+
+
+QByteArray diff_match_patch::patch_toBinary(const QList<Patch> &patches) const {
+  QByteArray data;
+  binaryAppendHeader(data, BINARY_PATCHES, false, 0);
+  binaryAppendPatches(data, patches);
+  return data;
+}
+
+
+QByteArray diff_match_patch::patch_toBinary(const QList<Patch> &patches,
+                                            const QString &text1) const {
+  QByteArray data;
+  binaryAppendHeader(data, BINARY_PATCHES, true,
+      binaryChecksum(2166136261u, text1));
+  binaryAppendPatches(data, patches);
+  return data;
+}
+
+
+QList<Patch> diff_match_patch::patch_fromBinary(const QByteArray &data) const {
+  const char *pos = data.constData();
+  const char *end = pos + data.size();
+  quint32 hash;
+  binaryReadHeader(pos, end, BINARY_PATCHES, hash);
+  QList<Patch> patches;
+  int start1 = 0;
+  while (pos != end) {
+    Patch patch;
+    patch.start1 = binaryReadOffset(start1, pos, end);
+    patch.start2 = binaryReadOffset(patch.start1, pos, end);
+    patch.length1 = binaryReadInt(pos, end);
+    patch.length2 = binaryReadInt(pos, end);
+    quint32 count = binaryReadVarint(pos, end);
+    if (count > static_cast<quint32>(end - pos)) {
+      // Every diff takes at least one byte.
+      throw QString("Truncated binary patch.");
+    }
+    while (count-- > 0) {
+      patch.diffs.append(binaryReadText(pos, end));
+    }
+    patches.append(patch);
+    start1 = patch.start1;
+  }
+  return patches;
+}
+
+
+QList<Patch> diff_match_patch::patch_fromBinary(const QByteArray &data,
+                                                const QString &text1) const {
+  const char *pos = data.constData();
+  quint32 hash;
+  if (binaryReadHeader(pos, pos + data.size(), BINARY_PATCHES, hash)
+      && binaryChecksum(2166136261u, text1) != hash) {
+    throw QString("Text does not match the checksum of the patches.");
+  }
+  return patch_fromBinary(data);
+}
@@ -71,6 +71,16 @@ enum Operation {
 };
 
 
+/**
+* The granularities at which diff_hierarchical() compares texts, from the
+* coarsest to the finest.  A paragraph ends with a blank line and a word is
+* a run of letters and digits (see diff_wordMode()).
+*/
+enum Granularity {
+  PARAGRAPHS, LINES, WORDS, CHARACTERS
+};
+
+
 /**
 * Class representing one diff operation.
 */
@@ -109,122 +119,1042 @@ class Patch {
   int length2;
 
   /**
-   * Constructor.  Initializes with an empty list of diffs.
+   * Constructor.  Initializes with an empty list of diffs.
+   */
+  Patch();
+  bool isNull() const;
+  QString toString();
+};
+
+
+/**
+* Class for translating many locations in text1 to text2 through one diff.
+* The cumulative text lengths are computed once, so that each translation
+* is a binary search instead of a walk over the whole diff list.
+*/
+class DiffIndex {
+ public:
+  /**
+   * Constructor.  Computes the cumulative offsets of the provided diffs.
+   * @param diffs LinkedList of Diff objects.
+   */
+  DiffIndex(const QList<Diff> &diffs);
+
+  /**
+   * loc is a location in text1, compute and return the equivalent location in
+   * text2.  Gives the same result as diff_match_patch::diff_xIndex().
+   * @param loc Location within text1.
+   * @return Location within text2.
+   */
+  int xIndex(int loc) const;
+
+ private:
+  // Length of text1 covered by the diffs up to and including diffs[i].
+  QVector<int> ends1;
+  // Length of text2 covered by the diffs up to and including diffs[i].
+  QVector<int> ends2;
+  // True if diffs[i] is a deletion.
+  QVector<bool> deleted;
+};
+
+
+/**
+* Class representing a block of text which was moved: deleted from one place
+* in text1 and inserted at another in text2.
+*/
+class DiffMove {
+ public:
+  int index1;
+  // Start of the block in text1.
+  int index2;
+  // Start of the block in text2.
+  int length;
+  // Length of the block.
+
+  /**
+   * Constructor.  Initializes the move with the provided values.
+   * @param index1 Start of the block in text1.
+   * @param index2 Start of the block in text2.
+   * @param length Length of the block.
+   */
+  DiffMove(int _index1, int _index2, int _length);
+  DiffMove();
+  QString toString() const;
+  bool operator==(const DiffMove &m) const;
+  bool operator!=(const DiffMove &m) const;
+};
+
+
+/**
+* Class holding a base text prepared for diffing against many revisions.
+* The base is split into lines and each line is numbered once, so that a
+* diff against a revision only has to hash the revision.  A DiffDocument is
+* never modified after construction and may be shared between threads.
+*/
+class DiffDocument {
+ public:
+  /**
+   * Constructor.  Splits and numbers the lines of the base text.
+   * @param text Base text.
+   */
+  explicit DiffDocument(const QString &text);
+
+  /**
+   * @return The base text.
+   */
+  const QString &text() const;
+
+ private:
+  friend class diff_match_patch;
+
+  // The base text.
+  QString base;
+  // Number of each distinct line.
+  QHash<QString, int> ids;
+  // Number of each line of the base.
+  QVector<int> lines;
+  // Start of each line of the base, followed by its length.
+  QVector<int> starts;
+};
+
+
+/**
+* Class representing the 128-bit content hash of a diff_main() call: both
+* texts and the settings which affect the result.
+*/
+class DiffCacheKey {
+ public:
+  quint64 high;
+  quint64 low;
+
+  DiffCacheKey() : high(0), low(0) {}
+  bool operator==(const DiffCacheKey &k) const {
+    return high == k.high && low == k.low;
+  }
+};
+
+inline uint qHash(const DiffCacheKey &key) {
+  return static_cast<uint>(key.low ^ (key.low >> 32));
+}
+
+
+/**
+* Class caching the results of diff_main() by content, so that repeated
+* calls with the same texts and settings are answered without diffing.
+* The least recently used results are evicted to keep the cache within its
+* memory cap.  A DiffCache may be shared by any number of diff_match_patch
+* instances on any number of threads.
+*/
+class DiffCache {
+ public:
+  /**
+   * Constructor.
+   * @param maxBytes Approximate memory cap for the cached diffs.
+   */
+  DiffCache(int maxBytes = 64 * 1024 * 1024);
+
+  /**
+   * Look up a cached result, counting a hit or a miss.
+   * @param key Content hash of the call.
+   * @param diffs Set to the cached diffs if found.
+   * @return True if found.
+   */
+  bool find(const DiffCacheKey &key, QList<Diff> &diffs);
+
+  /**
+   * Add a result, evicting the least recently used ones as needed.
+   * Results larger than the whole cache are not kept.
+   * @param key Content hash of the call.
+   * @param diffs Diffs to cache.
+   */
+  void insert(const DiffCacheKey &key, const QList<Diff> &diffs);
+
+  /**
+   * Remove all the cached results.  The counters are kept.
+   */
+  void clear();
+
+  int maxBytes() const;
+  void setMaxBytes(int maxBytes);
+  // Approximate memory used by the cached diffs.
+  int totalBytes() const;
+  // Number of cached results.
+  int size() const;
+  // Number of lookups answered from the cache.
+  qint64 hits() const;
+  // Number of lookups not answered from the cache.
+  qint64 misses() const;
+  // Number of results evicted to stay within the memory cap.
+  qint64 evictions() const;
+
+ private:
+  Q_DISABLE_COPY(DiffCache)
+
+  mutable QMutex mutex;
+  QCache<DiffCacheKey, QList<Diff> > cache;
+  qint64 hitCount;
+  qint64 missCount;
+  qint64 evictionCount;
+};
+
+
+/**
+* Class deciding which pairs of texts are too dissimilar to be worth a full
+* diff, by their similarity as estimated by diff_match_patch::diff_similarity(),
+* and counting its decisions.  A DiffPrefilter may be shared by any number of
+* diff_match_patch instances on any number of threads.
+*/
+class DiffPrefilter {
+ public:
+  /**
+   * Constructor.
+   * @param threshold Estimated similarity below which a pair is not diffed.
+   * @param minLength Shortest text, once any common prefix and suffix are
+   *     left out, for which the similarity is estimated.
+   */
+  DiffPrefilter(float threshold = 0.05f, int minLength = 1024);
+
+  /**
+   * Decide whether a pair of texts is worth diffing, counting the decision.
+   * @param similarity Estimated similarity of the texts.
+   * @return False if the pair should be deleted and inserted whole.
+   */
+  bool similar(float similarity);
+
+  /**
+   * Reset the counters to zero.
+   */
+  void resetCounters();
+
+  float threshold() const;
+  void setThreshold(float threshold);
+  int minLength() const;
+  void setMinLength(int minLength);
+  // Number of pairs whose similarity was estimated.
+  qint64 checked() const;
+  // Number of pairs which were deleted and inserted whole.
+  qint64 skipped() const;
+
+ private:
+  Q_DISABLE_COPY(DiffPrefilter)
+
+  mutable QMutex mutex;
+  float similarityThreshold;
+  int minimumLength;
+  qint64 checkCount;
+  qint64 skipCount;
+};
+
+
+/**
+* Class for parsing the textual representation of patches one at a time.
+* The UTF-8 input is scanned once, directly from the bytes, without
+* splitting it into lines or converting the whole of it to a QString.
+*/
+class PatchReader {
+ public:
+  /**
+   * Constructor.  Reads the patch text incrementally from a device.
+   * Sequential devices are waited on until they run out of data.
+   * @param device Open device positioned at the start of the patch text.
+   */
+  PatchReader(QIODevice *device);
+
+  /**
+   * Constructor.  Reads the patch text from memory.
+   * @param data UTF-8 encoded patch text.
+   */
+  PatchReader(const QByteArray &data);
+
+  /**
+   * Parse the next patch.
+   * @param patch Patch object to fill in.
+   * @return False if there are no more patches.
+   * @throws QString If invalid input, or if the device fails to read.
+   */
+  bool readPatch(Patch &patch);
+
+ private:
+  /**
+   * Advance to the next non-empty line of input.
+   * @return False at the end of the input.
+   */
+  bool nextLine();
+
+  /**
+   * Append the next chunk of the device to the buffer, discarding the part
+   * of the buffer which has already been parsed.
+   * @return False if the device has no more data.
+   * @throws QString If the device fails to read.
+   */
+  bool readMore();
+
+  /**
+   * Parse the current line as a patch header.
+   * @param patch Patch object to fill in.
+   * @throws QString If the line is not a valid header.
+   */
+  void parseHeader(Patch &patch);
+
+  /**
+   * Decode the %xx escapes in part of the current line.
+   * @param from Offset of the first character to decode.
+   * @return Decoded text.
+   * @throws QString If an escape is invalid.
+   */
+  QString decodeLine(int from);
+
+  // Source of the patch text, or NULL if it is all in buffer.
+  QIODevice *device;
+  // Unparsed patch text.
+  QByteArray buffer;
+  // Offset of the first unread byte in buffer.
+  int pos;
+  // Offset and length of the current line in buffer.
+  int lineStart;
+  int lineLength;
+  // True if the current line has been read but not yet used.
+  bool pending;
+  // Scratch space for decoding escaped lines.
+  QByteArray scratch;
+};
+
+
+/**
+* Class for writing the textual representation of patches and deltas to a
+* device.  The UTF-8 output is staged in a fixed size buffer which is
+* flushed whenever it fills, so the full text is never held in memory.
+* The bytes written are identical to the UTF-8 encoding of patch_toText()
+* and diff_toDelta().
+*/
+class PatchWriter {
+ public:
+  /**
+   * Constructor.
+   * @param device Open device to write to.
+   */
+  PatchWriter(QIODevice *device);
+
+  /**
+   * Destructor.  Flushes any buffered output.
+   */
+  ~PatchWriter();
+
+  /**
+   * Write one patch in GNU diff's format.
+   * @param patch Patch object to write.
+   * @throws QString If the device fails.
+   */
+  void writePatch(const Patch &patch);
+
+  /**
+   * Write a diff as a tab-separated delta.
+   * @param diffs Array of diff tuples.
+   * @throws QString If the device fails.
+   */
+  void writeDelta(const QList<Diff> &diffs);
+
+  /**
+   * Write one equality or deletion of a delta, after a tab unless it is the
+   * first operation written.
+   * @param op EQUAL or DELETE.
+   * @param length Number of characters it covers.
+   * @throws QString If the device fails.
+   */
+  void writeDeltaLength(Operation op, qint64 length);
+
+  /**
+   * Write one insertion of a delta, after a tab unless it is the first
+   * operation written.
+   * @param text Text to insert.
+   * @throws QString If the device fails.
+   */
+  void writeDeltaText(const QString &text);
+
+  /**
+   * Write one insertion of a delta from text which is already UTF-8, after
+   * a tab unless it is the first operation written.
+   * @param data UTF-8 text to insert.
+   * @param length Length of the text in bytes.
+   * @throws QString If the device fails.
+   */
+  void writeDeltaText(const char *data, qint64 length);
+
+  /**
+   * Write any buffered output to the device.
+   * @throws QString If the device fails.
+   */
+  void flush();
+
+ private:
+  /**
+   * Append one byte to the buffer.
+   * @param c Byte to append.
+   */
+  inline void put(char c) {
+    if (used == buffer.size()) {
+      flush();
+    }
+    data[used++] = c;
+  }
+
+  /**
+   * Append a decimal number.
+   * @param n Number to append.
+   */
+  void putNumber(qint64 n);
+
+  /**
+   * Append a byte of UTF-8, escaped with %xx notation unless it is one of
+   * the characters which patches and deltas leave unescaped.
+   * @param c Byte to append.
+   */
+  void putEncoded(uchar c);
+
+  /**
+   * Append text, encoded as UTF-8 and escaped with %xx notation.
+   * @param text Text to append.
+   */
+  void putText(const QString &text);
+
+  /**
+   * Append the tab between two operations of a delta.
+   */
+  inline void putDeltaSeparator() {
+    if (deltaStarted) {
+      put('\t');
+    }
+    deltaStarted = true;
+  }
+
+  // Destination of the output.
+  QIODevice *device;
+  // Staging buffer and its (never shared) storage.
+  QByteArray buffer;
+  char *data;
+  // Number of bytes of buffer in use.
+  int used;
+  // Whether an operation of the current delta has been written.
+  bool deltaStarted;
+};
+
+
+/**
+* Interface for receiving the diffs produced by diff_stream() as they are
+* found.
+*/
+class DiffSink {
+ public:
+  virtual ~DiffSink() {}
+
+  /**
+   * Called once for each diff, in order.  Adjacent diffs may share the same
+   * operation when a run is too long to buffer.
+   * @param aDiff Next diff.
+   */
+  virtual void receiveDiff(const Diff &aDiff) = 0;
+};
+
+
+/**
+* Class for stopping running diffs and patch_apply() from another thread.
+* A cancelled diff returns early with a valid but coarse result, as it would
+* on reaching Diff_Timeout, and patch_apply() leaves the remaining patches
+* unapplied.
+*/
+class DiffCancelToken {
+ public:
+  DiffCancelToken();
+
+  /**
+   * Ask every diff using this token to stop.  Safe from any thread.
+   */
+  void cancel();
+
+  /**
+   * Allow the token to be used again.
+   */
+  void reset();
+
+  /**
+   * Has cancel() been called?
+   * @return True if cancelled.
+   */
+  bool isCancelled() const;
+
+ private:
+  Q_DISABLE_COPY(DiffCancelToken)
+
+  QAtomicInt cancelled;
+};
+
+
+/**
+* Interface for receiving progress reports from long diffs and
+* patch_apply().
+*/
+class DiffProgress {
+ public:
+  virtual ~DiffProgress() {}
+
+  /**
+   * Called from time to time by diff_bisect(), by the rediff of the blocks
+   * changed in a line-mode diff and by patch_apply().  Reports of nested
+   * stages interleave, and come from pool threads when Diff_Threads > 1.
+   * @param stage Name of the reporting method.
+   * @param done Units of work done so far.
+   * @param total Units of work in the stage.  For diff_bisect() this is
+   *     the largest possible edit distance, so it usually finishes early.
+   */
+  virtual void reportProgress(const char *stage, int done, int total) = 0;
+};
+
+
+class DiffLineMode;
+
+/**
+* Class bounding the work of one diff, both by the time from Diff_Timeout and
+* by the count of work units from Diff_WorkBudget.  A plain clock_t converts
+* to a deadline with no work limit.  It also carries the settings which every
+* level of the diff engine (diff_core) needs to see.
+*/
+class DiffDeadline {
+ public:
+  /**
+   * Constructor.
+   * @param _time Time at which to bail if not yet complete.
+   * @param _budget Work units left, shared by everything using this
+   *     deadline, or NULL for no limit.
+   * @param _degraded True if the diff has already run out of time and is
+   *     being finished coarsely.
+   */
+  DiffDeadline(clock_t _time, qint64 *_budget = NULL, bool _degraded = false) :
+    time(_time), budget(_budget), degraded(_degraded), maxEdits(-1),
+    exceeded(NULL), cancel(NULL), progress(NULL), degrade(false),
+    grace(-1), lines(NULL), checklines(false) {
+  }
+
+  /**
+   * Has the time or the work run out?
+   * @return True if the diff should bail.
+   */
+  inline bool expired() const {
+    return spent() || clock() > time;
+  }
+
+  /**
+   * Has the work run out?
+   * @return True if the budget is used up.
+   */
+  inline bool spent() const {
+    return budget != NULL && *budget <= 0;
+  }
+
+  /**
+   * Charge some work to the budget.
+   * @param units Number of work units done.
+   */
+  inline void spend(qint64 units) const {
+    if (budget != NULL) {
+      *budget -= units;
+    }
+  }
+
+  /**
+   * Has the diff been cancelled?
+   * @return True if the cancel token has been cancelled.
+   */
+  inline bool cancelled() const {
+    return cancel != NULL && cancel->isCancelled();
+  }
+
+  // Time at which to bail if not yet complete.
+  clock_t time;
+  // Work units left, or NULL for no limit.
+  qint64 *budget;
+  // Is this the budget of a diff_degrade()?
+  bool degraded;
+  // Largest number of edits to look for, or -1 for no limit.
+  int maxEdits;
+  // Set if the texts turned out to need more than maxEdits, or NULL.
+  bool *exceeded;
+  // Token which stops the diff early, or NULL.
+  const DiffCancelToken *cancel;
+  // Receiver of progress reports, or NULL.
+  DiffProgress *progress;
+  // Finish a diff which runs out of time coarsely rather than giving up?
+  bool degrade;
+  // Time past the deadline which the coarse finish may take, or -1 for no
+  // limit.
+  clock_t grace;
+  // Line mode for long texts, or NULL if there is none.
+  const DiffLineMode *lines;
+  // Use the line mode where the texts are long enough?
+  bool checklines;
+};
+
+
+class DiffRun;
+
+/**
+* Interface through which the diff engine (diff_core) hands long texts back
+* to the line mode of diff_match_patch.
+*/
+class DiffLineMode {
+ public:
+  virtual ~DiffLineMode() {}
+
+  /**
+   * Diff two texts line by line, then rediff the changed lines.
+   * @param text1 Start of the old text.
+   * @param length1 Length of the old text.
+   * @param text2 Start of the new text.
+   * @param length2 Length of the new text.
+   * @param deadline Time and work limit of the diff.
+   * @return List of DiffRun objects.
+   */
+  virtual QList<DiffRun> diff_lineRuns(const QChar *text1, int length1,
+                                       const QChar *text2, int length2,
+                                       DiffDeadline deadline) const = 0;
+};
+
+
+/**
+* Class containing the behaviour settings of diff_match_patch.
+* Set these on an options object (or on a diff_match_patch instance) to
+* override the defaults.
+*/
+class DiffOptions {
+ public:
+  DiffOptions();
+
+  // Number of seconds to map a diff before giving up (0 for infinity).
+  float Diff_Timeout;
+  // Cost of an empty edit operation in terms of edit characters.
+  short Diff_EditCost;
+  // Number of characters of each input held in memory by diff_stream(), and
+  // bytes of each replaced block rediffed by diff_filesToDelta().
+  int Diff_StreamWindow;
+  // Maximum number of threads used to refine replacement blocks (1 for none).
+  int Diff_Threads;
+  // Shortest block of text which diff_main() looks for out of order, so that
+  // moved sections become anchors instead of timing out (0 to disable).
+  int Diff_MoveBlockSize;
+  // Fewest lines in each text before diff_main() splits it on the lines
+  // which occur once in both, in the same order (0 to disable).
+  int Diff_AnchorLines;
+  // Cache of diff_main() results, which may be shared with other
+  // instances, or NULL for none.  The cache is not owned.
+  DiffCache *Diff_Cache;
+  // Token which stops running diffs and patch_apply() when cancelled, or
+  // NULL for none.  The token is not owned.
+  DiffCancelToken *Diff_Cancel;
+  // Receiver of progress reports, or NULL for none.  Not owned.
+  DiffProgress *Diff_Progress;
+  // Number of work units (diagonals explored by diff_bisect() and
+  // characters compared by diff_halfMatch()) after which a diff gives up,
+  // as it would on reaching Diff_Timeout (0 for infinity).  Unlike the
+  // timeout, this gives the same diff on every machine.
+  qint64 Diff_WorkBudget;
+  // When a diff runs out of time or work, finish the unfinished parts with a
+  // coarser diff rather than deleting and inserting them whole.  This takes
+  // up to a small multiple of the input length in extra work, and up to a
+  // quarter of Diff_Timeout past the timeout.
+  bool Diff_Degrade;
+  // Filter which lets diff_main() delete and insert whole the texts which
+  // share too little to be worth diffing, or NULL for none.  Not owned.
+  DiffPrefilter *Diff_Prefilter;
+  // At what point is no match declared (0.0 = perfection, 1.0 = very loose).
+  float Match_Threshold;
+  // How far to search for a match (0 = exact location, 1000+ = broad match).
+  // A match this many characters away from the expected location will add
+  // 1.0 to the score (0.0 is a perfect match).
+  int Match_Distance;
+  // When deleting a large block of text (over ~64 characters), how close does
+  // the contents have to match the expected contents. (0.0 = perfection,
+  // 1.0 = very loose).  Note that Match_Threshold controls how closely the
+  // end points of a delete need to match.
+  float Patch_DeleteThreshold;
+  // Chunk size for context length.
+  short Patch_Margin;
+
+  // The number of bits in an int.
+  short Match_MaxBits;
+};
+
+
+/**
+ * Class containing the diff, match and patch methods.
+ * Also contains the behaviour settings.
+ * None of the methods modify the instance, so a const diff_match_patch
+ * (for example one constructed from a DiffOptions) may be shared by any
+ * number of threads without locking.
+ */
+class diff_match_patch : public DiffOptions, private DiffLineMode {
+
+  friend class diff_match_patch_test;
+  friend class DiffJob;
+
+ public:
+
+  diff_match_patch();
+
+  /**
+   * Constructor.
+   * @param options Behaviour settings.
+   */
+  explicit diff_match_patch(const DiffOptions &options);
+
+  /**
+   * The behaviour settings of this instance.
+   * @return Options object.
+   */
+  const DiffOptions &options() const;
+
+  //  DIFF FUNCTIONS
+
+
+  /**
+   * Find the differences between two texts.
+   * Run a faster slightly less optimal diff.
+   * This method allows the 'checklines' of diff_main() to be optional.
+   * Most of the time checklines is wanted, so default to true.
+   * @param text1 Old string to be diffed.
+   * @param text2 New string to be diffed.
+   * @return Linked List of Diff objects.
+   */
+  QList<Diff> diff_main(const QString &text1, const QString &text2) const;
+
+  /**
+   * Find the differences between two texts.
+   * @param text1 Old string to be diffed.
+   * @param text2 New string to be diffed.
+   * @param checklines Speedup flag.  If false, then don't run a
+   *     line-level diff first to identify the changed areas.
+   *     If true, then run a faster slightly less optimal diff.
+   * @return Linked List of Diff objects.
+   */
+  QList<Diff> diff_main(const QString &text1, const QString &text2, bool checklines) const;
+
+  /**
+   * Find the differences between two Latin-1 texts, without converting them
+   * to QStrings first.  Gives the same diff as diff_main() with checklines
+   * set to false.  Wrap a const char * with QByteArray::fromRawData() to
+   * avoid copying it.
+   * @param text1 Old Latin-1 string to be diffed.
+   * @param text2 New Latin-1 string to be diffed.
+   * @return Linked List of Diff objects.
+   */
+ public:
+  QList<Diff> diff_mainLatin1(const QByteArray &text1, const QByteArray &text2) const;
+
+  /**
+   * Find the differences between two UTF-8 texts, without converting them
+   * to QStrings first.  The diff is computed on the bytes and then moved to
+   * character boundaries, so no character is ever split.  Wrap a
+   * const char * with QByteArray::fromRawData() to avoid copying it.
+   * @param text1 Old UTF-8 string to be diffed.
+   * @param text2 New UTF-8 string to be diffed.
+   * @return Linked List of Diff objects.
+   */
+ public:
+  QList<Diff> diff_mainUtf8(const QByteArray &text1, const QByteArray &text2) const;
+
+  /**
+   * Find the differences between a prepared base text and a revision.
+   * The revision is diffed line by line against the base, then the
+   * replaced lines are rediffed character-by-character, as the line-mode
+   * speedup of diff_main() does.  Diff_Cache and Diff_Prefilter apply as
+   * they do to diff_main(), but Diff_MoveBlockSize and Diff_AnchorLines
+   * don't.  Texts of 100 characters or fewer are diffed as diff_main()
+   * would.
+   * This speedup can produce non-minimal diffs.
+   * @param base Old string, prepared for diffing.
+   * @param text2 New string to be diffed.
+   * @return Linked List of Diff objects.
+   */
+ public:
+  QList<Diff> diff_main(const DiffDocument &base, const QString &text2) const;
+
+  /**
+   * Find the differences between each of many pairs of texts.
+   * The pairs are shared out between up to Diff_Threads threads (the
+   * calling thread being one of them) and each pair gets its own
+   * Diff_Timeout, counted from when its diff starts.
+   * @param pairs List of (old string, new string) pairs to be diffed.
+   * @return List of Linked Lists of Diff objects, in the order of the pairs.
+   */
+ public:
+  QList<QList<Diff> > diff_many(const QList<QPair<QString, QString> > &pairs) const;
+
+  /**
+   * Find the differences between each of many pairs of texts.
+   * @param pairs List of (old string, new string) pairs to be diffed.
+   * @param checklines Speedup flag.  If false, then don't run a
+   *     line-level diff first to identify the changed areas.
+   *     If true, then run a faster slightly less optimal diff.
+   * @return List of Linked Lists of Diff objects, in the order of the pairs.
+   */
+ public:
+  QList<QList<Diff> > diff_many(const QList<QPair<QString, QString> > &pairs,
+                                bool checklines) const;
+
+  /**
+   * Find the minimal differences between two texts, provided that they
+   * differ by at most maxEdits inserted and deleted characters.  Takes time
+   * in proportion to the text length times maxEdits and memory in
+   * proportion to maxEdits, or to the longer text where what is left to
+   * diff of the shorter is at most 64 characters.  Ignores Diff_Timeout.
+   * Gives up as soon as the texts are known to differ by more.
+   * @param text1 Old string to be diffed.
+   * @param text2 New string to be diffed.
+   * @param maxEdits Largest number of inserted plus deleted characters to
+   *     look for.
+   * @param diffs Set to the Linked List of Diff objects, or cleared if the
+   *     texts differ by more than maxEdits.
+   * @return False if the texts differ by more than maxEdits.
+   */
+ public:
+  bool diff_bounded(const QString &text1, const QString &text2, int maxEdits,
+                    QList<Diff> &diffs) const;
+
+  /**
+   * Find the differences between two texts.  Simplifies the problem by
+   * stripping any common prefix or suffix off the texts before diffing.
+   * @param text1 Old string to be diffed.
+   * @param text2 New string to be diffed.
+   * @param checklines Speedup flag.  If false, then don't run a
+   *     line-level diff first to identify the changed areas.
+   *     If true, then run a faster slightly less optimal diff.
+   * @param deadline Time when the diff should be complete by.  Used
+   *     internally for recursive calls.  Users should set DiffTimeout instead.
+   * @return Linked List of Diff objects.
+   */
+ private:
+  QList<Diff> diff_main(const QString &text1, const QString &text2, bool checklines, DiffDeadline deadline) const;
+
+  /**
+   * Find the differences between two texts, through Diff_Cache and
+   * Diff_Prefilter.  Shared by the public diff_main() calls.
+   * @param text1 Old string to be diffed.
+   * @param text2 New string to be diffed.
+   * @param checklines Speedup flag.
+   * @param base text1 prepared for diffing, or NULL.
+   * @return Linked List of Diff objects.
+   */
+ private:
+  QList<Diff> diff_cached(const QString &text1, const QString &text2,
+                          bool checklines, const DiffDocument *base) const;
+
+  /**
+   * Find the differences between a prepared base text and a revision,
+   * line by line and then character by character.
+   * @param base Old string, prepared for diffing.
+   * @param text2 New string to be diffed.
+   * @param deadline Time and work limit of the diff.
+   * @return Linked List of Diff objects.
+   */
+ private:
+  QList<Diff> diff_document(const DiffDocument &base, const QString &text2,
+                            DiffDeadline deadline) const;
+
+  /**
+   * Compute the Diff_Cache key of a diff_main() call.
+   * @param text1 Old string to be diffed.
+   * @param text2 New string to be diffed.
+   * @param checklines Speedup flag.
+   * @param document True if text1 is a DiffDocument.
+   * @return 128-bit hash of the texts and the settings.
    */
-  Patch();
-  bool isNull() const;
-  QString toString();
-};
+ private:
+  DiffCacheKey diff_cacheKey(const QString &text1, const QString &text2,
+                             bool checklines, bool document) const;
 
+  /**
+   * Start the time and work limits of a diff from Diff_Timeout and
+   * Diff_WorkBudget, along with Diff_Cancel, Diff_Progress and Diff_Degrade.
+   * @param budget Set to the work budget, which the deadline counts down.
+   * @return Deadline for the diff.
+   */
+ private:
+  DiffDeadline diff_deadline(qint64 &budget) const;
 
-/**
- * Class containing the diff, match and patch methods.
- * Also contains the behaviour settings.
- */
-class diff_match_patch {
+  /**
+   * Hand a deadline the settings which diff_core needs to diff QStrings:
+   * Diff_Cancel, Diff_Progress, Diff_Degrade and the line mode.
+   * @param deadline Time and work limit of the diff.
+   * @param checklines Speedup flag.
+   * @return Deadline for diff_core.
+   */
+ private:
+  DiffDeadline diff_coreDeadline(DiffDeadline deadline,
+                                 bool checklines) const;
 
-  friend class diff_match_patch_test;
+  /**
+   * Is the half-match speedup allowed?  Only a diff bounded by time or work
+   * risks the non-minimal diff it can produce.
+   * @return True if Diff_Timeout or Diff_WorkBudget is set.
+   */
+ private:
+  bool diff_halfMatchAllowed() const;
 
- public:
-  // Defaults.
-  // Set these on your diff_match_patch instance to override the defaults.
+  /**
+   * Has the diff been cancelled through Diff_Cancel?
+   * @return True if cancelled.
+   */
+ private:
+  bool diff_cancelled() const;
 
-  // Number of seconds to map a diff before giving up (0 for infinity).
-  float Diff_Timeout;
-  // Cost of an empty edit operation in terms of edit characters.
-  short Diff_EditCost;
-  // At what point is no match declared (0.0 = perfection, 1.0 = very loose).
-  float Match_Threshold;
-  // How far to search for a match (0 = exact location, 1000+ = broad match).
-  // A match this many characters away from the expected location will add
-  // 1.0 to the score (0.0 is a perfect match).
-  int Match_Distance;
-  // When deleting a large block of text (over ~64 characters), how close does
-  // the contents have to match the expected contents. (0.0 = perfection,
-  // 1.0 = very loose).  Note that Match_Threshold controls how closely the
-  // end points of a delete need to match.
-  float Patch_DeleteThreshold;
-  // Chunk size for context length.
-  short Patch_Margin;
+  /**
+   * Report progress to Diff_Progress, if set.
+   * @param stage Name of the reporting method.
+   * @param done Units of work done so far.
+   * @param total Units of work in the stage.
+   */
+ private:
+  void diff_progress(const char *stage, int done, int total) const;
 
-  // The number of bits in an int.
-  short Match_MaxBits;
+  /**
+   * Diff two texts for diff_core, in line mode or anchor mode.
+   * @param text1 Start of the old text.
+   * @param length1 Length of the old text.
+   * @param text2 Start of the new text.
+   * @param length2 Length of the new text.
+   * @param deadline Time and work limit of the diff.
+   * @return List of DiffRun objects.
+   */
+ private:
+  QList<DiffRun> diff_lineRuns(const QChar *text1, int length1,
+                               const QChar *text2, int length2,
+                               DiffDeadline deadline) const;
 
+  /**
+   * Do a quick line-level diff on both strings, then rediff the parts for
+   * greater accuracy.  The parts are independent and are rediffed on up to
+   * Diff_Threads threads.
+   * This speedup can produce non-minimal diffs.
+   * @param text1 Old string to be diffed.
+   * @param text2 New string to be diffed.
+   * @param deadline Time when the diff should be complete by.
+   * @return Linked List of Diff objects.
+   */
  private:
-  // Define some regex patterns for matching boundaries.
-  static QRegExp BLANKLINEEND;
-  static QRegExp BLANKLINESTART;
+  QList<Diff> diff_lineMode(QString text1, QString text2, DiffDeadline deadline) const;
 
+  /**
+   * Split two texts on the lines which occur exactly once in each, in the
+   * same order (as patience diff does), then diff the gaps between those
+   * lines independently on up to Diff_Threads threads.  Falls back to
+   * diff_lineMode() for texts of fewer than Diff_AnchorLines lines.
+   * This speedup can produce non-minimal diffs.
+   * @param text1 Old string to be diffed.
+   * @param text2 New string to be diffed.
+   * @param deadline Time when the diff should be complete by.
+   * @return Linked List of Diff objects.
+   */
+ private:
+  QList<Diff> diff_anchorMode(const QString &text1, const QString &text2,
+                              DiffDeadline deadline) const;
 
+  /**
+   * Find the differences between two texts word by word.  Words are runs of
+   * letters and digits; each run of whitespace and each other character is
+   * a token of its own.  Replacement blocks are left as whole words.
+   * This speedup can produce non-minimal diffs.
+   * @param text1 Old string to be diffed.
+   * @param text2 New string to be diffed.
+   * @return Linked List of Diff objects.
+   */
  public:
-
-  diff_match_patch();
-
-  //  DIFF FUNCTIONS
-
+  QList<Diff> diff_wordMode(const QString &text1, const QString &text2) const;
 
   /**
-   * Find the differences between two texts.
-   * Run a faster slightly less optimal diff.
-   * This method allows the 'checklines' of diff_main() to be optional.
-   * Most of the time checklines is wanted, so default to true.
+   * Find the differences between two texts word by word.
    * @param text1 Old string to be diffed.
    * @param text2 New string to be diffed.
+   * @param refine If true, rediff replacement blocks character-by-character
+   *     as the line-mode speedup of diff_main() does.
    * @return Linked List of Diff objects.
    */
-  QList<Diff> diff_main(const QString &text1, const QString &text2);
+ public:
+  QList<Diff> diff_wordMode(const QString &text1, const QString &text2, bool refine) const;
 
   /**
-   * Find the differences between two texts.
+   * Do a quick word-level diff on both strings, then optionally rediff the
+   * parts for greater accuracy.
    * @param text1 Old string to be diffed.
    * @param text2 New string to be diffed.
-   * @param checklines Speedup flag.  If false, then don't run a
-   *     line-level diff first to identify the changed areas.
-   *     If true, then run a faster slightly less optimal diff.
+   * @param refine If true, rediff replacement blocks character-by-character.
+   * @param deadline Time when the diff should be complete by.
    * @return Linked List of Diff objects.
    */
-  QList<Diff> diff_main(const QString &text1, const QString &text2, bool checklines);
+ private:
+  QList<Diff> diff_wordMode(QString text1, QString text2, bool refine, DiffDeadline deadline) const;
 
   /**
-   * Find the differences between two texts.  Simplifies the problem by
-   * stripping any common prefix or suffix off the texts before diffing.
+   * Find the differences between two texts by refining a coarse diff level
+   * by level, e.g. paragraphs, then lines, then words, then characters.
+   * Each level only rediffs the replacement blocks left by the level above,
+   * and the blocks of a level are diffed on up to Diff_Threads threads.
+   * This speedup can produce non-minimal diffs.
    * @param text1 Old string to be diffed.
    * @param text2 New string to be diffed.
-   * @param checklines Speedup flag.  If false, then don't run a
-   *     line-level diff first to identify the changed areas.
-   *     If true, then run a faster slightly less optimal diff.
-   * @param deadline Time when the diff should be complete by.  Used
-   *     internally for recursive calls.  Users should set DiffTimeout instead.
+   * @param levels Granularities to diff at, from the coarsest to the finest.
    * @return Linked List of Diff objects.
    */
- private:
-  QList<Diff> diff_main(const QString &text1, const QString &text2, bool checklines, clock_t deadline);
+ public:
+  QList<Diff> diff_hierarchical(const QString &text1, const QString &text2,
+                                const QList<Granularity> &levels) const;
 
   /**
-   * Find the differences between two texts.  Assumes that the texts do not
-   * have any common prefix or suffix.
+   * Find the differences between two texts by refining a coarse diff level
+   * by level.
    * @param text1 Old string to be diffed.
    * @param text2 New string to be diffed.
-   * @param checklines Speedup flag.  If false, then don't run a
-   *     line-level diff first to identify the changed areas.
-   *     If true, then run a faster slightly less optimal diff.
+   * @param levels Granularities to diff at, from the coarsest to the finest.
    * @param deadline Time when the diff should be complete by.
    * @return Linked List of Diff objects.
    */
  private:
-  QList<Diff> diff_compute(QString text1, QString text2, bool checklines, clock_t deadline);
+  QList<Diff> diff_hierarchical(const QString &text1, const QString &text2,
+                                const QList<Granularity> &levels,
+                                DiffDeadline deadline) const;
 
   /**
-   * Do a quick line-level diff on both strings, then rediff the parts for
-   * greater accuracy.
-   * This speedup can produce non-minimal diffs.
+   * Find the differences between two texts treated as sequences of tokens
+   * of one granularity.  No cleanup is done, so this is safe to call from
+   * several threads at once.
    * @param text1 Old string to be diffed.
    * @param text2 New string to be diffed.
+   * @param granularity Size of the tokens.
    * @param deadline Time when the diff should be complete by.
    * @return Linked List of Diff objects.
    */
  private:
-  QList<Diff> diff_lineMode(QString text1, QString text2, clock_t deadline);
+  QList<Diff> diff_granular(const QString &text1, const QString &text2,
+                            Granularity granularity, DiffDeadline deadline) const;
+
+  /**
+   * Rediff all the replacement blocks (runs of deletions and insertions
+   * between equalities) at a finer granularity.  The blocks are collected
+   * first, diffed on up to Diff_Threads threads, then spliced back in with
+   * a single pass over the list.
+   * @param diffs LinkedList of Diff objects.
+   * @param granularity Size of the tokens to rediff with.
+   * @param deadline Time when the diff should be complete by.
+   */
+ private:
+  void diff_refine(QList<Diff> &diffs, Granularity granularity,
+                   DiffDeadline deadline) const;
+
+  /**
+   * Remove empty diffs and join any neighbours which then share an
+   * operation.  Unlike diff_cleanupMerge() this never shifts or factors
+   * text, so token boundaries are kept.
+   * @param diffs LinkedList of Diff objects.
+   */
+ private:
+  void diff_cleanupEmpty(QList<Diff> &diffs) const;
 
   /**
    * Find the 'middle snake' of a diff, split the problem in two
@@ -232,23 +1162,23 @@ class diff_match_patch {
    * See Myers 1986 paper: An O(ND) Difference Algorithm and Its Variations.
    * @param text1 Old string to be diffed.
    * @param text2 New string to be diffed.
+   * @param deadline Time and work limit of the diff.
    * @return Linked List of Diff objects.
    */
  protected:
-  QList<Diff> diff_bisect(const QString &text1, const QString &text2, clock_t deadline);
+  QList<Diff> diff_bisect(const QString &text1, const QString &text2, DiffDeadline deadline) const;
 
   /**
-   * Given the location of the 'middle snake', split the diff in two parts
-   * and recurse.
+   * Find the differences between two texts, one of which is at most 64
+   * characters long, with the bit-parallel LCS kernel of diff_core.
    * @param text1 Old string to be diffed.
    * @param text2 New string to be diffed.
-   * @param x Index of split point in text1.
-   * @param y Index of split point in text2.
-   * @param deadline Time at which to bail if not yet complete.
+   * @param deadline Deadline to charge the work to.
    * @return LinkedList of Diff objects.
    */
  private:
-  QList<Diff> diff_bisectSplit(const QString &text1, const QString &text2, int x, int y, clock_t deadline);
+  QList<Diff> diff_bitLcs(const QString &text1, const QString &text2,
+                          DiffDeadline deadline) const;
 
   /**
    * Split two texts into a list of strings.  Reduce the texts to a string of
@@ -260,7 +1190,7 @@ class diff_match_patch {
    *     of the List of unique strings is intentionally blank.
    */
  protected:
-  QList<QVariant> diff_linesToChars(const QString &text1, const QString &text2); // return elems 0 and 1 are QString, elem 2 is QStringList
+  QList<QVariant> diff_linesToChars(const QString &text1, const QString &text2) const; // return elems 0 and 1 are QString, elem 2 is QStringList
 
   /**
    * Split a text into a list of strings.  Reduce the texts to a string of
@@ -268,11 +1198,73 @@ class diff_match_patch {
    * @param text String to encode.
    * @param lineArray List of unique strings.
    * @param lineHash Map of strings to indices.
+   * @param maxLines Size of lineArray at which the rest of the text is
+   *     made into a single line, so that the hashes never run out.
    * @return Encoded string.
    */
  private:
   QString diff_linesToCharsMunge(const QString &text, QStringList &lineArray,
-                                 QMap<QString, int> &lineHash);
+                                 QMap<QString, int> &lineHash,
+                                 int maxLines) const;
+
+  /**
+   * Split two texts into a list of words, whitespace and punctuation.
+   * Reduce the texts to a string of hashes where each Unicode character
+   * represents one token.  The result is decoded with diff_charsToLines().
+   * @param text1 First string.
+   * @param text2 Second string.
+   * @return Three element Object array, containing the encoded text1, the
+   *     encoded text2 and the List of unique strings.  The zeroth element
+   *     of the List of unique strings is intentionally blank.
+   */
+ protected:
+  QList<QVariant> diff_wordsToChars(const QString &text1, const QString &text2) const; // return elems 0 and 1 are QString, elem 2 is QStringList
+
+  /**
+   * Split a text into a list of tokens.  Reduce the texts to a string of
+   * hashes where each Unicode character represents one token.
+   * @param text String to encode.
+   * @param lineArray List of unique strings.
+   * @param lineHash Map of strings to indices.
+   * @param maxTokens Size of lineArray at which the rest of the text is
+   *     made into a single token, so that the hashes never run out.
+   * @return Encoded string.
+   */
+ private:
+  QString diff_wordsToCharsMunge(const QString &text, QStringList &lineArray,
+                                 QMap<QString, int> &lineHash, int maxTokens) const;
+
+  /**
+   * Split two texts into a list of tokens of one granularity.  Reduce the
+   * texts to a string of hashes where each Unicode character represents
+   * one token.
+   * @param text1 First string.
+   * @param text2 Second string.
+   * @param granularity Size of the tokens; not CHARACTERS.
+   * @return Three element Object array, containing the encoded text1, the
+   *     encoded text2 and the List of unique strings.  The zeroth element
+   *     of the List of unique strings is intentionally blank.
+   */
+ protected:
+  QList<QVariant> diff_tokensToChars(const QString &text1, const QString &text2,
+                                     Granularity granularity) const; // return elems 0 and 1 are QString, elem 2 is QStringList
+
+  /**
+   * Split a text into a list of paragraphs, each ending with its run of
+   * blank lines.  Reduce the texts to a string of hashes where each Unicode
+   * character represents one paragraph.
+   * @param text String to encode.
+   * @param lineArray List of unique strings.
+   * @param lineHash Map of strings to indices.
+   * @param maxTokens Size of lineArray at which the rest of the text is
+   *     made into a single token.
+   * @return Encoded string.
+   */
+ private:
+  QString diff_paragraphsToCharsMunge(const QString &text,
+                                      QStringList &lineArray,
+                                      QMap<QString, int> &lineHash,
+                                      int maxTokens) const;
 
   /**
    * Rehydrate the text in a diff from a string of line hashes to real lines of
@@ -281,7 +1273,7 @@ class diff_match_patch {
    * @param lineArray List of unique strings.
    */
  private:
-  void diff_charsToLines(QList<Diff> &diffs, const QStringList &lineArray);
+  void diff_charsToLines(QList<Diff> &diffs, const QStringList &lineArray) const;
 
   /**
    * Determine the common prefix of two strings.
@@ -290,7 +1282,7 @@ class diff_match_patch {
    * @return The number of characters common to the start of each string.
    */
  public:
-  int diff_commonPrefix(const QString &text1, const QString &text2);
+  int diff_commonPrefix(const QString &text1, const QString &text2) const;
 
   /**
    * Determine the common suffix of two strings.
@@ -299,7 +1291,7 @@ class diff_match_patch {
    * @return The number of characters common to the end of each string.
    */
  public:
-  int diff_commonSuffix(const QString &text1, const QString &text2);
+  int diff_commonSuffix(const QString &text1, const QString &text2) const;
 
   /**
    * Determine if the suffix of one string is the prefix of another.
@@ -309,7 +1301,7 @@ class diff_match_patch {
    *     string and the start of the second string.
    */
  protected:
-  int diff_commonOverlap(const QString &text1, const QString &text2);
+  int diff_commonOverlap(const QString &text1, const QString &text2) const;
 
   /**
    * Do the two texts share a substring which is at least half the length of
@@ -322,27 +1314,27 @@ class diff_match_patch {
    *     common middle.  Or null if there was no match.
    */
  protected:
-  QStringList diff_halfMatch(const QString &text1, const QString &text2);
+  QStringList diff_halfMatch(const QString &text1, const QString &text2) const;
 
   /**
-   * Does a substring of shorttext exist within longtext such that the
-   * substring is at least half the length of longtext?
-   * @param longtext Longer string.
-   * @param shorttext Shorter string.
-   * @param i Start index of quarter length substring within longtext.
-   * @return Five element String array, containing the prefix of longtext, the
-   *     suffix of longtext, the prefix of shorttext, the suffix of shorttext
-   *     and the common middle.  Or null if there was no match.
+   * Do the two texts share a substring which is at least half the length of
+   * the longer text?
+   * @param text1 First string.
+   * @param text2 Second string.
+   * @param deadline Time and work limit, to which the comparisons are
+   *     charged.
+   * @return Five element String array, or null if there was no match.
    */
  private:
-  QStringList diff_halfMatchI(const QString &longtext, const QString &shorttext, int i);
+  QStringList diff_halfMatch(const QString &text1, const QString &text2,
+                             DiffDeadline deadline) const;
 
   /**
    * Reduce the number of edits by eliminating semantically trivial equalities.
    * @param diffs LinkedList of Diff objects.
    */
  public:
-  void diff_cleanupSemantic(QList<Diff> &diffs);
+  void diff_cleanupSemantic(QList<Diff> &diffs) const;
 
   /**
    * Look for single edits surrounded on both sides by equalities
@@ -351,7 +1343,7 @@ class diff_match_patch {
    * @param diffs LinkedList of Diff objects.
    */
  public:
-  void diff_cleanupSemanticLossless(QList<Diff> &diffs);
+  void diff_cleanupSemanticLossless(QList<Diff> &diffs) const;
 
   /**
    * Given two strings, compute a score representing whether the internal
@@ -362,14 +1354,14 @@ class diff_match_patch {
    * @return The score.
    */
  private:
-  int diff_cleanupSemanticScore(const QString &one, const QString &two);
+  int diff_cleanupSemanticScore(const QString &one, const QString &two) const;
 
   /**
    * Reduce the number of edits by eliminating operationally trivial equalities.
    * @param diffs LinkedList of Diff objects.
    */
  public:
-  void diff_cleanupEfficiency(QList<Diff> &diffs);
+  void diff_cleanupEfficiency(QList<Diff> &diffs) const;
 
   /**
    * Reorder and merge like edit sections.  Merge equalities.
@@ -377,7 +1369,7 @@ class diff_match_patch {
    * @param diffs LinkedList of Diff objects.
    */
  public:
-  void diff_cleanupMerge(QList<Diff> &diffs);
+  void diff_cleanupMerge(QList<Diff> &diffs) const;
 
   /**
    * loc is a location in text1, compute and return the equivalent location in
@@ -388,7 +1380,7 @@ class diff_match_patch {
    * @return Location within text2.
    */
  public:
-  int diff_xIndex(const QList<Diff> &diffs, int loc);
+  int diff_xIndex(const QList<Diff> &diffs, int loc) const;
 
   /**
    * Convert a Diff list into a pretty HTML report.
@@ -396,7 +1388,7 @@ class diff_match_patch {
    * @return HTML representation.
    */
  public:
-  QString diff_prettyHtml(const QList<Diff> &diffs);
+  QString diff_prettyHtml(const QList<Diff> &diffs) const;
 
   /**
    * Compute and return the source text (all equalities and deletions).
@@ -404,7 +1396,7 @@ class diff_match_patch {
    * @return Source text.
    */
  public:
-  QString diff_text1(const QList<Diff> &diffs);
+  QString diff_text1(const QList<Diff> &diffs) const;
 
   /**
    * Compute and return the destination text (all equalities and insertions).
@@ -412,7 +1404,7 @@ class diff_match_patch {
    * @return Destination text.
    */
  public:
-  QString diff_text2(const QList<Diff> &diffs);
+  QString diff_text2(const QList<Diff> &diffs) const;
 
   /**
    * Compute the Levenshtein distance; the number of inserted, deleted or
@@ -421,7 +1413,44 @@ class diff_match_patch {
    * @return Number of changes.
    */
  public:
-  int diff_levenshtein(const QList<Diff> &diffs);
+  int diff_levenshtein(const QList<Diff> &diffs) const;
+
+  /**
+   * Compute the Levenshtein distance between two texts; the least number of
+   * inserted, deleted or substituted characters which turn text1 into
+   * text2.  Unlike diff_levenshtein() this doesn't need a diff, and it is
+   * exact where a diff which replaces a block in one piece overcounts.
+   * @param text1 Old string.
+   * @param text2 New string.
+   * @return Number of changes.
+   */
+ public:
+  int diff_editDistance(const QString &text1, const QString &text2) const;
+
+  /**
+   * Compute the Levenshtein distance between two texts, giving up as soon
+   * as it is known to exceed maxDistance.
+   * @param text1 Old string.
+   * @param text2 New string.
+   * @param maxDistance Largest distance of interest, or -1 for no limit.
+   * @return Number of changes, or -1 if that exceeds maxDistance.
+   */
+ public:
+  int diff_editDistance(const QString &text1, const QString &text2,
+                        int maxDistance) const;
+
+  /**
+   * Estimate the similarity of two texts: the Jaccard index of their sets of
+   * eight-character substrings, from MinHash sketches of the 128 least
+   * hashes of each.  Any common prefix and suffix is left out.  Takes time
+   * in proportion to the text length, and is exact for texts of up to about
+   * 128 characters.
+   * @param text1 First string.
+   * @param text2 Second string.
+   * @return Similarity from 0.0 (nothing shared) to 1.0 (the same).
+   */
+ public:
+  float diff_similarity(const QString &text1, const QString &text2) const;
 
   /**
    * Crush the diff into an encoded string which describes the operations
@@ -432,7 +1461,16 @@ class diff_match_patch {
    * @return Delta text.
    */
  public:
-  QString diff_toDelta(const QList<Diff> &diffs);
+  QString diff_toDelta(const QList<Diff> &diffs) const;
+
+  /**
+   * Write the UTF-8 delta of a diff to a device.  See diff_toDelta().
+   * @param diffs Array of diff tuples.
+   * @param device Open device to write to.
+   * @throws QString If the device fails.
+   */
+ public:
+  void diff_toDelta(const QList<Diff> &diffs, QIODevice *device) const;
 
   /**
    * Given the original text1, and an encoded string which describes the
@@ -443,7 +1481,118 @@ class diff_match_patch {
    * @throws QString If invalid input.
    */
  public:
-  QList<Diff> diff_fromDelta(const QString &text1, const QString &delta);
+  QList<Diff> diff_fromDelta(const QString &text1, const QString &delta) const;
+
+  /**
+   * Crush the diff into the compact binary form of diff_toDelta().
+   * Lengths are stored as varints and inserted text as length-prefixed
+   * UTF-8, after a versioned header and a checksum of text1.
+   * @param diffs Array of diff tuples.
+   * @return Binary delta.
+   * @throws QString If a diff is 1 GB or more.
+   */
+ public:
+  QByteArray diff_toBinaryDelta(const QList<Diff> &diffs) const;
+
+  /**
+   * Crush the diff into the compact binary form of diff_toDelta().
+   * @param diffs Array of diff tuples.
+   * @param checksum If true, store a checksum of text1 so that
+   *     diff_fromBinaryDelta() can detect being given the wrong source text.
+   * @return Binary delta.
+   * @throws QString If a diff is 1 GB or more.
+   */
+ public:
+  QByteArray diff_toBinaryDelta(const QList<Diff> &diffs, bool checksum) const;
+
+  /**
+   * Given the original text1, and a binary delta from diff_toBinaryDelta(),
+   * compute the full diff.
+   * @param text1 Source string for the diff.
+   * @param delta Binary delta.
+   * @return Array of diff tuples.
+   * @throws QString If invalid input, or text1 fails the checksum.
+   */
+ public:
+  QList<Diff> diff_fromBinaryDelta(const QString &text1, const QByteArray &delta) const;
+
+  /**
+   * Find the differences between two UTF-8 files, without loading them.
+   * Both files are memory-mapped, the common prefix and suffix are trimmed
+   * on the raw bytes and the remaining lines are compared by reference.
+   * Only the changed lines are decoded for a character-level diff, so the
+   * result is returned as a delta rather than as Diff objects.
+   * @param path1 Name of the old file.
+   * @param path2 Name of the new file.
+   * @return Delta text, as from diff_toDelta().
+   * @throws QString If either file cannot be opened or mapped.
+   */
+ public:
+  QString diff_filesToDelta(const QString &path1, const QString &path2) const;
+
+  /**
+   * Find the differences between two UTF-8 files, without loading them,
+   * and write the delta to a device as it is found.  Replaced blocks of up
+   * to Diff_StreamWindow bytes on each side are rediffed character by
+   * character; larger ones are deleted and inserted whole.  Inserted text
+   * is copied from the mapping to the device, so neither file nor the
+   * delta is ever held in memory.
+   * @param path1 Name of the old file.
+   * @param path2 Name of the new file.
+   * @param device Open device to write the delta to, in UTF-8.
+   * @throws QString If either file cannot be opened or mapped, or if the
+   *     device fails.
+   */
+ public:
+  void diff_filesToDelta(const QString &path1, const QString &path2,
+                         QIODevice *device) const;
+
+  /**
+   * Find the differences between two UTF-8 streams too large to hold in
+   * memory.  Each input is read line by line into a window of up to
+   * Diff_StreamWindow characters.  Lines which occur exactly once in both
+   * windows are used as anchors to keep the streams in step, and the text
+   * between anchors is diffed with diff_main().  Diff_Timeout applies to
+   * each window rather than to the whole diff.
+   * @param device1 Open device holding the old text.
+   * @param device2 Open device holding the new text.
+   * @param sink Receiver of the diffs, which are sent as soon as they are
+   *     found.
+   */
+ public:
+  void diff_stream(QIODevice *device1, QIODevice *device2, DiffSink *sink) const;
+
+  /**
+   * Find the differences between two texts, first splitting them on long
+   * common blocks found in any order with a rolling hash.  Blocks which
+   * keep their order become equalities and the gaps between them are
+   * diffed separately; the others are moves.  A moved block still appears
+   * in the diffs as a deletion and an insertion.
+   * Blocks are at least Diff_MoveBlockSize characters long; if that is 0
+   * this is just diff_main().
+   * @param text1 Old string to be diffed.
+   * @param text2 New string to be diffed.
+   * @param moves List to fill with the blocks which moved.
+   * @return Linked List of Diff objects.
+   */
+ public:
+  QList<Diff> diff_moves(const QString &text1, const QString &text2,
+                         QList<DiffMove> &moves) const;
+
+  /**
+   * Split two texts on the long common blocks found by a rolling hash and
+   * diff the gaps between those which keep their order.
+   * @param text1 Old string to be diffed.
+   * @param text2 New string to be diffed.
+   * @param checklines Speedup flag for the gaps.
+   * @param deadline Time when the diff should be complete by.
+   * @param moves List to fill with the blocks which moved, or NULL.
+   * @return Linked List of Diff objects.
+   */
+ private:
+  QList<Diff> diff_blockMoves(const QString &text1, const QString &text2,
+                              bool checklines, DiffDeadline deadline,
+                              QList<DiffMove> *moves) const;
 
 
   //  MATCH FUNCTIONS
@@ -458,7 +1607,7 @@ class diff_match_patch {
    * @return Best match index or -1.
    */
  public:
-  int match_main(const QString &text, const QString &pattern, int loc);
+  int match_main(const QString &text, const QString &pattern, int loc) const;
 
   /**
    * Locate the best instance of 'pattern' in 'text' near 'loc' using the
@@ -469,7 +1618,7 @@ class diff_match_patch {
    * @return Best match index or -1.
    */
  protected:
-  int match_bitap(const QString &text, const QString &pattern, int loc);
+  int match_bitap(const QString &text, const QString &pattern, int loc) const;
 
   /**
    * Compute and return the score for a match with e errors and x location.
@@ -480,7 +1629,7 @@ class diff_match_patch {
    * @return Overall score for match (0.0 = good, 1.0 = bad).
    */
  private:
-  double match_bitapScore(int e, int x, int loc, const QString &pattern);
+  double match_bitapScore(int e, int x, int loc, const QString &pattern) const;
 
   /**
    * Initialise the alphabet for the Bitap algorithm.
@@ -488,7 +1637,7 @@ class diff_match_patch {
    * @return Hash of character locations.
    */
  protected:
-  QMap<QChar, int> match_alphabet(const QString &pattern);
+  QMap<QChar, int> match_alphabet(const QString &pattern) const;
 
 
  //  PATCH FUNCTIONS
@@ -501,7 +1650,7 @@ class diff_match_patch {
    * @param text Source text.
    */
  protected:
-  void patch_addContext(Patch &patch, const QString &text);
+  void patch_addContext(Patch &patch, const QString &text) const;
 
   /**
    * Compute a list of patches to turn text1 into text2.
@@ -511,7 +1660,7 @@ class diff_match_patch {
    * @return LinkedList of Patch objects.
    */
  public:
-  QList<Patch> patch_make(const QString &text1, const QString &text2);
+  QList<Patch> patch_make(const QString &text1, const QString &text2) const;
 
   /**
    * Compute a list of patches to turn text1 into text2.
@@ -520,7 +1669,7 @@ class diff_match_patch {
    * @return LinkedList of Patch objects.
    */
  public:
-  QList<Patch> patch_make(const QList<Diff> &diffs);
+  QList<Patch> patch_make(const QList<Diff> &diffs) const;
 
   /**
    * Compute a list of patches to turn text1 into text2.
@@ -532,7 +1681,7 @@ class diff_match_patch {
    * @deprecated Prefer patch_make(const QString &text1, const QList<Diff> &diffs).
    */
  public:
-  QList<Patch> patch_make(const QString &text1, const QString &text2, const QList<Diff> &diffs);
+  QList<Patch> patch_make(const QString &text1, const QString &text2, const QList<Diff> &diffs) const;
 
   /**
    * Compute a list of patches to turn text1 into text2.
@@ -542,7 +1691,25 @@ class diff_match_patch {
    * @return LinkedList of Patch objects.
    */
  public:
-  QList<Patch> patch_make(const QString &text1, const QList<Diff> &diffs);
+  QList<Patch> patch_make(const QString &text1, const QList<Diff> &diffs) const;
+
+  /**
+   * Compute a list of patches to turn a prepared base text into text2.
+   * @param base Old text, prepared for diffing.
+   * @param text2 New text.
+   * @return LinkedList of Patch objects.
+   */
+ public:
+  QList<Patch> patch_make(const DiffDocument &base, const QString &text2) const;
+
+  /**
+   * Compute a list of patches for each of many pairs of texts, sharing the
+   * pairs out between threads as diff_many() does.
+   * @param pairs List of (old text, new text) pairs.
+   * @return List of LinkedLists of Patch objects, in the order of the pairs.
+   */
+ public:
+  QList<QList<Patch> > patch_make_many(const QList<QPair<QString, QString> > &pairs) const;
 
   /**
    * Given an array of patches, return another array that is identical.
@@ -550,7 +1717,7 @@ class diff_match_patch {
    * @return Array of patch objects.
    */
  public:
-  QList<Patch> patch_deepCopy(QList<Patch> &patches);
+  QList<Patch> patch_deepCopy(QList<Patch> &patches) const;
 
   /**
    * Merge a set of patches onto the text.  Return a patched text, as well
@@ -561,7 +1728,7 @@ class diff_match_patch {
    *      boolean values.
    */
  public:
-  QPair<QString,QVector<bool> > patch_apply(QList<Patch> &patches, const QString &text);
+  QPair<QString,QVector<bool> > patch_apply(QList<Patch> &patches, const QString &text) const;
 
   /**
    * Add some padding on text start and end so that edges can match something.
@@ -570,7 +1737,7 @@ class diff_match_patch {
    * @return The padding string added to each side.
    */
  public:
-  QString patch_addPadding(QList<Patch> &patches);
+  QString patch_addPadding(QList<Patch> &patches) const;
 
   /**
    * Look through the patches and break up any which are longer than the
@@ -579,7 +1746,7 @@ class diff_match_patch {
    * @param patches LinkedList of Patch objects.
    */
  public:
-  void patch_splitMax(QList<Patch> &patches);
+  void patch_splitMax(QList<Patch> &patches) const;
 
   /**
    * Take a list of patches and return a textual representation.
@@ -587,7 +1754,16 @@ class diff_match_patch {
    * @return Text representation of patches.
    */
  public:
-  QString patch_toText(const QList<Patch> &patches);
+  QString patch_toText(const QList<Patch> &patches) const;
+
+  /**
+   * Write the UTF-8 textual representation of a list of patches to a device.
+   * @param patches List of Patch objects.
+   * @param device Open device to write to.
+   * @throws QString If the device fails.
+   */
+ public:
+  void patch_toText(const QList<Patch> &patches, QIODevice *device) const;
 
   /**
    * Parse a textual representation of patches and return a List of Patch
@@ -597,7 +1773,61 @@ class diff_match_patch {
    * @throws QString If invalid input.
    */
  public:
-  QList<Patch> patch_fromText(const QString &textline);
+  QList<Patch> patch_fromText(const QString &textline) const;
+
+  /**
+   * Parse a textual representation of patches from a device and return a
+   * List of Patch objects.  Much faster than patch_fromText(QString) on
+   * large inputs.  Use PatchReader directly to process patches as they
+   * arrive.
+   * @param device Device to read the UTF-8 encoded patches from.
+   * @return List of Patch objects.
+   * @throws QString If invalid input, or if the device fails to read.
+   */
+ public:
+  QList<Patch> patch_fromText(QIODevice *device) const;
+
+  /**
+   * Take a list of patches and return a compact binary representation.
+   * Offsets and lengths are stored as varints and text as length-prefixed
+   * UTF-8, after a versioned header.
+   * @param patches List of Patch objects.
+   * @return Binary representation of patches.
+   * @throws QString If a diff is 1 GB or more.
+   */
+ public:
+  QByteArray patch_toBinary(const QList<Patch> &patches) const;
+
+  /**
+   * Take a list of patches and return a compact binary representation
+   * which includes a checksum of the text the patches were made from.
+   * @param patches List of Patch objects.
+   * @param text1 Text the patches apply to.
+   * @return Binary representation of patches.
+   * @throws QString If a diff is 1 GB or more.
+   */
+ public:
+  QByteArray patch_toBinary(const QList<Patch> &patches, const QString &text1) const;
+
+  /**
+   * Parse a binary representation of patches.  Any checksum is ignored.
+   * @param data Binary representation of patches.
+   * @return List of Patch objects.
+   * @throws QString If invalid input.
+   */
+ public:
+  QList<Patch> patch_fromBinary(const QByteArray &data) const;
+
+  /**
+   * Parse a binary representation of patches, checking that they were made
+   * from text1 if a checksum was stored.
+   * @param data Binary representation of patches.
+   * @param text1 Text the patches will be applied to.
+   * @return List of Patch objects.
+   * @throws QString If invalid input, or text1 fails the checksum.
+   */
+ public:
+  QList<Patch> patch_fromBinary(const QByteArray &data, const QString &text1) const;
 
   /**
    * A safer version of QString.mid(pos).  This one returns "" instead of
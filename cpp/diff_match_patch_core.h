@@ -0,0 +1,1243 @@
+/*
+ * Copyright 2008 Google Inc. All Rights Reserved.
+ * Author: fraser@google.com (Neil Fraser)
+ * Author: mikeslemmer@gmail.com (Mike Slemmer)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Diff Match and Patch -- Core Diff Engine
+ * http://code.google.com/p/google-diff-match-patch/
+ */
+
+#ifndef DIFF_MATCH_PATCH_CORE_H
+#define DIFF_MATCH_PATCH_CORE_H
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <stdlib.h>
+#include <time.h>
+#include "diff_match_patch.h"
+
+/*
+ * The character diff of diff_match_patch, templated on the type of its
+ * input so that it can run directly on narrow strings such as the bytes of
+ * a QByteArray, on QChars, or on any other sequence of tokens.
+ *
+ * The result is a list of runs giving the operation and length of each
+ * piece of the diff rather than its text, so nothing is copied or
+ * converted while diffing.  diff_match_patch::diff_mainLatin1() and
+ * diff_match_patch::diff_mainUtf8() turn the runs back into Diff objects.
+ *
+ * Sample use on a sequence of token ids:
+
+ #include <QtCore>
+ #include "diff_match_patch_core.h"
+ int main(int argc, char **argv) {
+   QVector<quint32> tokens1, tokens2;
+   tokens1 << 1 << 2 << 3 << 4;
+   tokens2 << 1 << 3 << 4 << 5;
+
+   diff_sequence<QVector<quint32> > dmp;
+   QList<DiffRun> runs = dmp.diff_main(tokens1, tokens2);
+
+   // here, runs holds EQUAL 1, DELETE 1, EQUAL 2, INSERT 1.
+   return 0;
+ }
+
+ */
+
+
+/**
+* Class representing one diff operation by its length alone.
+*/
+class DiffRun {
+ public:
+  Operation operation;
+  // One of: INSERT, DELETE or EQUAL.
+  int length;
+  // The number of units the operation applies to.
+
+  /**
+   * Constructor.  Initializes the run with the provided values.
+   * @param operation One of INSERT, DELETE or EQUAL.
+   * @param length The number of units being applied.
+   */
+  DiffRun(Operation _operation, int _length)
+      : operation(_operation), length(_length) {}
+  DiffRun() : operation(EQUAL), length(0) {}
+
+  bool operator==(const DiffRun &d) const {
+    return d.operation == operation && d.length == length;
+  }
+  bool operator!=(const DiffRun &d) const {
+    return !(operator==(d));
+  }
+};
+
+
+/**
+ * Hand two ranges of QChars to the line mode of a diff, if it has one.
+ * @param text1 Start of the old range.
+ * @param length1 Length of the old range.
+ * @param text2 Start of the new range.
+ * @param length2 Length of the new range.
+ * @param deadline Limits of the diff, holding its line mode.
+ * @param runs Set to the diff, if there was a line mode.
+ * @return False if the ranges must be diffed character by character.
+ */
+inline bool diff_coreLines(const QChar *text1, int length1,
+                           const QChar *text2, int length2,
+                           const DiffDeadline &deadline,
+                           QList<DiffRun> &runs) {
+  if (deadline.lines == NULL) {
+    return false;
+  }
+  runs = deadline.lines->diff_lineRuns(text1, length1, text2, length2,
+                                       deadline);
+  return true;
+}
+
+/**
+ * Ranges of anything but QChars have no line mode.
+ * @return False.
+ */
+template <typename Iterator>
+inline bool diff_coreLines(Iterator, int, Iterator, int,
+                           const DiffDeadline &, QList<DiffRun> &) {
+  return false;
+}
+
+
+/**
+* Class holding the diagonal arrays of diff_core::diff_bisect().
+* Short diffs borrow a buffer kept per thread rather than allocating their
+* own, which adds up when many small diffs are made in a row (as by
+* diff_many() on the pool threads).  A diff started while the buffer is
+* lent out (e.g. from a DiffProgress callback) allocates its own.
+* The buffers are defined in diff_match_patch.cpp, which must be linked in
+* by any user of this header.
+*/
+class BisectArrays {
+ public:
+  BisectArrays(int length) {
+    scratch = NULL;
+    if (2 * length <= BISECT_SCRATCH) {
+      if (!buffers.hasLocalData()) {
+        buffers.setLocalData(new BisectScratch());
+      }
+      if (!buffers.localData()->inUse) {
+        scratch = buffers.localData();
+        scratch->inUse = true;
+      }
+    }
+    if (scratch != NULL) {
+      v1 = scratch->data.data();
+    } else {
+      v1 = new int[2 * length];
+    }
+    v2 = v1 + length;
+  }
+
+  ~BisectArrays() {
+    if (scratch != NULL) {
+      scratch->inUse = false;
+    } else {
+      delete [] v1;
+    }
+  }
+
+  int *v1;
+  int *v2;
+
+ private:
+  Q_DISABLE_COPY(BisectArrays)
+
+  // Number of ints in each thread's scratch buffer.
+  static const int BISECT_SCRATCH = 1 << 16;
+
+  struct BisectScratch {
+    BisectScratch() : data(BISECT_SCRATCH), inUse(false) {}
+    QVector<int> data;
+    bool inUse;
+  };
+
+  static QThreadStorage<BisectScratch *> buffers;
+  // This thread's buffer if borrowed, else NULL.
+  BisectScratch *scratch;
+};
+
+
+/**
+* Diff of two random access ranges, e.g. const char * or const QChar *.
+* This is the engine of every diff_match_patch diff: diff_main() runs it on
+* the QChars of its texts, handing long ranges back to the line mode of
+* diff_match_patch through the deadline.
+*/
+template <typename Iterator>
+class diff_core {
+ public:
+  /**
+   * Find the differences between two ranges.  Simplifies the problem by
+   * stripping any common prefix or suffix off the ranges before diffing.
+   * @param text1 Start of the old range.
+   * @param length1 Length of the old range.
+   * @param text2 Start of the new range.
+   * @param length2 Length of the new range.
+   * @param halfMatch Allow the faster but less optimal half-match speedup,
+   *     as diff_match_patch does when Diff_Timeout or Diff_WorkBudget is
+   *     set.
+   * @param deadline Time and work limit of the diff.
+   * @return List of DiffRun objects, without empty or adjacent equal runs.
+   */
+  static QList<DiffRun> diff_main(Iterator text1, int length1,
+                                  Iterator text2, int length2,
+                                  bool halfMatch, DiffDeadline deadline) {
+    QList<DiffRun> runs;
+    // Check for equality (speedup).
+    if (length1 == length2 && std::equal(text1, text1 + length1, text2)) {
+      if (length1 != 0) {
+        runs.append(DiffRun(EQUAL, length1));
+      }
+      return runs;
+    }
+
+    // Trim off common prefix and suffix (speedup).
+    const int prefix = diff_commonPrefix(text1, length1, text2, length2);
+    const int suffix = diff_commonSuffix(text1 + prefix, length1 - prefix,
+                                         text2 + prefix, length2 - prefix);
+
+    // Compute the diff on the middle block.
+    if (prefix != 0) {
+      runs.append(DiffRun(EQUAL, prefix));
+    }
+    append(runs, diff_compute(text1 + prefix, length1 - prefix - suffix,
+                              text2 + prefix, length2 - prefix - suffix,
+                              halfMatch, deadline));
+    if (suffix != 0) {
+      append(runs, DiffRun(EQUAL, suffix));
+    }
+
+    diff_cleanupMerge(text1, text2, runs);
+    return runs;
+  }
+
+  /**
+   * Determine the common prefix of two ranges.
+   * @param text1 Start of the first range.
+   * @param length1 Length of the first range.
+   * @param text2 Start of the second range.
+   * @param length2 Length of the second range.
+   * @return The number of units common to the start of each range.
+   */
+  static int diff_commonPrefix(Iterator text1, int length1,
+                               Iterator text2, int length2) {
+    const int n = std::min(length1, length2);
+    for (int i = 0; i < n; i++) {
+      if (text1[i] != text2[i]) {
+        return i;
+      }
+    }
+    return n;
+  }
+
+  /**
+   * Determine the common suffix of two ranges.
+   * @param text1 Start of the first range.
+   * @param length1 Length of the first range.
+   * @param text2 Start of the second range.
+   * @param length2 Length of the second range.
+   * @return The number of units common to the end of each range.
+   */
+  static int diff_commonSuffix(Iterator text1, int length1,
+                               Iterator text2, int length2) {
+    const int n = std::min(length1, length2);
+    for (int i = 1; i <= n; i++) {
+      if (text1[length1 - i] != text2[length2 - i]) {
+        return i - 1;
+      }
+    }
+    return n;
+  }
+
+  /**
+   * Find the 'middle snake' of a diff, split the problem in two
+   * and return the recursively constructed diff.
+   * See Myers 1986 paper: An O(ND) Difference Algorithm and Its Variations.
+   * @param text1 Start of the old range.
+   * @param length1 Length of the old range.
+   * @param text2 Start of the new range.
+   * @param length2 Length of the new range.
+   * @param halfMatch Allow the half-match speedup in recursive calls.
+   * @param deadline Time and work limit of the diff.
+   * @return List of DiffRun objects.
+   */
+  static QList<DiffRun> diff_bisect(Iterator text1, int length1,
+                                    Iterator text2, int length2,
+                                    bool halfMatch, DiffDeadline deadline) {
+    const int max_d = (length1 + length2 + 1) / 2;
+    // Search a band of diagonals around the main one before the whole grid.
+    // Most texts differ by far fewer edits than they have units, and a
+    // narrow band needs only as much memory as its width.  The widest band
+    // is maxEdits, if that is set.
+    int limit = max_d;
+    if (deadline.maxEdits >= 0) {
+      limit = std::min(limit, (deadline.maxEdits + 1) / 2 + 1);
+    }
+    int band = std::min(limit, BISECT_BAND);
+    int x;
+    int y;
+    BisectResult result;
+    while ((result = diff_bisectMiddle(text1, length1, text2, length2,
+                                       deadline, band, x, y))
+           == BISECT_EXCEEDED && band < limit) {
+      band = band > limit / 4 ? limit : band * 4;
+    }
+
+    if (result == BISECT_FOUND) {
+      return diff_bisectSplit(text1, length1, text2, length2, x, y,
+                              halfMatch, deadline);
+    }
+    if (result == BISECT_EXCEEDED && deadline.exceeded != NULL
+        && limit < max_d) {
+      // The ranges differ by more than maxEdits.
+      *deadline.exceeded = true;
+    }
+    if (result == BISECT_EXPIRED && deadline.degrade
+        && !deadline.cancelled()) {
+      // Keep the progress made so far by splitting at the furthest point
+      // reached.  With no progress at all, the whole diff is tried again
+      // under the budget of diff_degrade(), but only once.
+      if (x + y < length1 + length2 && (x + y > 0 || !deadline.degraded)) {
+        return diff_degrade(text1, length1, text2, length2, x, y, halfMatch,
+                            deadline);
+      }
+    }
+    // Diff took too long and hit the deadline or
+    // number of diffs equals number of characters, no commonality at all.
+    QList<DiffRun> runs;
+    append(runs, DiffRun(DELETE, length1));
+    append(runs, DiffRun(INSERT, length2));
+    return runs;
+  }
+
+  // Shortest length up to which diff_compute() uses diff_bitLcs() rather
+  // than diff_bisect(): one bit per unit of a quint64.
+  static const int BITLCS_MAX = 64;
+
+  /**
+   * Find the differences between two ranges, one of which is at most
+   * BITLCS_MAX units long, with a bit-parallel LCS table held one quint64
+   * per unit of the longer range.  Matches equal units as early as it can
+   * and prefers deletions to insertions, as diff_bisect() mostly does.
+   * See Hyyro 2004: Bit-Parallel LCS-length Computation Revisited.
+   * @param text1 Start of the old range.
+   * @param length1 Length of the old range.
+   * @param text2 Start of the new range.
+   * @param length2 Length of the new range.
+   * @return List of DiffRun objects.
+   */
+  static QList<DiffRun> diff_bitLcs(Iterator text1, int length1,
+                                    Iterator text2, int length2) {
+    typedef typename std::iterator_traits<Iterator>::value_type Unit;
+    // Set bits along the shorter range, which becomes the rows of the grid.
+    const bool swapped = length1 > length2;
+    const Iterator a = swapped ? text2 : text1;
+    const Iterator b = swapped ? text1 : text2;
+    const int m = swapped ? length2 : length1;
+    const int n = swapped ? length1 : length2;
+
+    // The table is built from the ends of the ranges backwards, so that it
+    // can be walked forwards.  Bit i of a mask is set where row m - 1 - i
+    // holds the unit.  A short range has few distinct units, so they are
+    // simply searched in turn.
+    QVector<Unit> units;
+    QVector<quint64> masks;
+    for (int i = 0; i < m; i++) {
+      const int k = units.indexOf(a[m - 1 - i]);
+      if (k == -1) {
+        units.append(a[m - 1 - i]);
+        masks.append(quint64(1) << i);
+      } else {
+        masks[k] |= quint64(1) << i;
+      }
+    }
+
+    // Column j of the LCS table of the last i rows and last j columns, one
+    // bit per row: bit i - 1 of ~v[j] is set where row m - i adds one to
+    // the LCS.
+    QVector<quint64> v(n + 1);
+    v[0] = ~quint64(0);
+    for (int j = 0; j < n; j++) {
+      const int k = units.indexOf(b[n - 1 - j]);
+      const quint64 u = k == -1 ? 0 : v[j] & masks[k];
+      v[j + 1] = (v[j] + u) | (v[j] - u);
+    }
+
+    // Walk forwards, matching equal units and otherwise dropping a row or a
+    // column which doesn't shorten the LCS, deletions first.
+    const Operation rowOp = swapped ? INSERT : DELETE;
+    const Operation colOp = swapped ? DELETE : INSERT;
+    QList<DiffRun> runs;
+    int i = m;
+    int j = n;
+    while (i > 0 || j > 0) {
+      Operation op;
+      if (i > 0 && j > 0 && a[m - i] == b[n - j]) {
+        op = EQUAL;
+      } else {
+        const bool row = i > 0 && (~v[j] & (quint64(1) << (i - 1))) == 0;
+        bool col = false;
+        if (j > 0) {
+          const quint64 below = i == 64 ? ~quint64(0)
+                                        : (quint64(1) << i) - 1;
+          col = bitCount(~v[j - 1] & below) == bitCount(~v[j] & below);
+        }
+        op = (row && (!col || rowOp == DELETE)) ? rowOp : colOp;
+      }
+      append(runs, DiffRun(op, 1));
+      if (op != colOp) {
+        i--;
+      }
+      if (op != rowOp) {
+        j--;
+      }
+    }
+    return runs;
+  }
+
+  /**
+   * Do the two ranges share a common middle at least half the length of the
+   * longer one?  This speedup can produce non-minimal diffs.
+   * @param text1 Start of the first range.
+   * @param length1 Length of the first range.
+   * @param text2 Start of the second range.
+   * @param length2 Length of the second range.
+   * @param deadline Time and work limit, to which the comparisons are
+   *     charged.
+   * @param common1 Set to the offset of the common middle in text1.
+   * @param common2 Set to the offset of the common middle in text2.
+   * @param commonLength Set to the length of the common middle.
+   * @return True if there is a half-match.
+   */
+  static bool diff_halfMatch(Iterator text1, int length1,
+                             Iterator text2, int length2,
+                             DiffDeadline deadline, int &common1,
+                             int &common2, int &commonLength) {
+    if (deadline.maxEdits >= 0 || deadline.expired()) {
+      // Don't risk a non-minimal diff if it has to stay within maxEdits, and
+      // don't look with no work left.
+      return false;
+    }
+    const bool longer1 = length1 > length2;
+    const Iterator longtext = longer1 ? text1 : text2;
+    const Iterator shorttext = longer1 ? text2 : text1;
+    const int longlength = longer1 ? length1 : length2;
+    const int shortlength = longer1 ? length2 : length1;
+    if (longlength < 4 || shortlength * 2 < longlength) {
+      return false;  // Pointless.
+    }
+
+    // First check if the second quarter is the seed for a half-match.
+    int long1, short1, length1a;
+    const bool hm1 = diff_halfMatchI(longtext, longlength, shorttext,
+        shortlength, (longlength + 3) / 4, deadline, long1, short1, length1a);
+    // Check again based on the third quarter.
+    int long2, short2, length2a;
+    const bool hm2 = diff_halfMatchI(longtext, longlength, shorttext,
+        shortlength, (longlength + 1) / 2, deadline, long2, short2, length2a);
+    int longStart, shortStart;
+    if (!hm1 && !hm2) {
+      return false;
+    } else if (!hm2 || (hm1 && length1a > length2a)) {
+      longStart = long1;
+      shortStart = short1;
+      commonLength = length1a;
+    } else {
+      longStart = long2;
+      shortStart = short2;
+      commonLength = length2a;
+    }
+    common1 = longer1 ? longStart : shortStart;
+    common2 = longer1 ? shortStart : longStart;
+    return true;
+  }
+
+  /**
+   * Reorder and merge like edit sections.  Merge equalities.
+   * Any edit section can move as long as it doesn't cross an equality.
+   * @param text1 Start of the old range.
+   * @param text2 Start of the new range.
+   * @param runs List of DiffRun objects.
+   */
+  static void diff_cleanupMerge(Iterator text1, Iterator text2,
+                                QList<DiffRun> &runs) {
+    QList<DiffRun> merged;
+    int pointer1 = 0;  // Cursor in text1
+    int pointer2 = 0;  // Cursor in text2
+    int start1 = 0;  // Start of the current edit section in text1
+    int start2 = 0;  // Start of the current edit section in text2
+    runs.append(DiffRun(EQUAL, 0));  // Add a dummy entry at the end.
+    foreach(const DiffRun &run, runs) {
+      if (run.operation == DELETE) {
+        pointer1 += run.length;
+        continue;
+      } else if (run.operation == INSERT) {
+        pointer2 += run.length;
+        continue;
+      }
+      int length_delete = pointer1 - start1;
+      int length_insert = pointer2 - start2;
+      int suffix = 0;
+      if (length_delete != 0 && length_insert != 0) {
+        // Factor out any common prefixies.
+        const int prefix = diff_commonPrefix(text2 + start2, length_insert,
+                                             text1 + start1, length_delete);
+        append(merged, DiffRun(EQUAL, prefix));
+        length_insert -= prefix;
+        length_delete -= prefix;
+        // Factor out any common suffixies.
+        suffix = diff_commonSuffix(text2 + start2 + prefix, length_insert,
+                                   text1 + start1 + prefix, length_delete);
+        length_insert -= suffix;
+        length_delete -= suffix;
+      }
+      append(merged, DiffRun(DELETE, length_delete));
+      append(merged, DiffRun(INSERT, length_insert));
+      append(merged, DiffRun(EQUAL, suffix + run.length));
+      pointer1 += run.length;
+      pointer2 += run.length;
+      start1 = pointer1;
+      start2 = pointer2;
+    }
+    runs = merged;
+
+    /*
+    * Second pass: look for single edits surrounded on both sides by
+    * equalities which can be shifted sideways to eliminate an equality.
+    * e.g: A<ins>BA</ins>C -> <ins>AB</ins>AC
+    */
+    bool changes = false;
+    pointer1 = 0;  // Start of runs[x - 1] in text1
+    pointer2 = 0;  // Start of runs[x - 1] in text2
+    // Intentionally ignore the first and last element (don't need checking).
+    for (int x = 1; x < runs.size() - 1; x++) {
+      const DiffRun prevRun = runs[x - 1];
+      const DiffRun thisRun = runs[x];
+      const DiffRun nextRun = runs[x + 1];
+      if (prevRun.operation == EQUAL && nextRun.operation == EQUAL) {
+        // This is a single edit surrounded by equalities.
+        const Iterator text = thisRun.operation == DELETE ? text1 : text2;
+        const int start = (thisRun.operation == DELETE ? pointer1 : pointer2)
+            + prevRun.length;
+        if (thisRun.length >= prevRun.length
+            && std::equal(text + start - prevRun.length, text + start,
+                          text + start + thisRun.length - prevRun.length)) {
+          // Shift the edit over the previous equality.
+          runs[x - 1] = thisRun;
+          runs[x] = DiffRun(EQUAL, prevRun.length + nextRun.length);
+          runs.removeAt(x + 1);
+          changes = true;
+        } else if (thisRun.length >= nextRun.length
+            && std::equal(text + start, text + start + nextRun.length,
+                          text + start + thisRun.length)) {
+          // Shift the edit over the next equality.
+          runs[x - 1] = DiffRun(EQUAL, prevRun.length + nextRun.length);
+          runs.removeAt(x + 1);
+          changes = true;
+        }
+      }
+      if (runs[x - 1].operation != INSERT) {
+        pointer1 += runs[x - 1].length;
+      }
+      if (runs[x - 1].operation != DELETE) {
+        pointer2 += runs[x - 1].length;
+      }
+    }
+    // If shifts were made, the diff needs reordering and another shift sweep.
+    if (changes) {
+      diff_cleanupMerge(text1, text2, runs);
+    }
+  }
+
+  /**
+   * Compute the Levenshtein distance; the number of inserted, deleted or
+   * substituted units.
+   * @param runs List of DiffRun objects.
+   * @return Number of changes.
+   */
+  static int diff_levenshtein(const QList<DiffRun> &runs) {
+    int levenshtein = 0;
+    int insertions = 0;
+    int deletions = 0;
+    foreach(const DiffRun &run, runs) {
+      switch (run.operation) {
+        case INSERT:
+          insertions += run.length;
+          break;
+        case DELETE:
+          deletions += run.length;
+          break;
+        case EQUAL:
+          // A deletion and an insertion is one substitution.
+          levenshtein += std::max(insertions, deletions);
+          insertions = 0;
+          deletions = 0;
+          break;
+      }
+    }
+    levenshtein += std::max(insertions, deletions);
+    return levenshtein;
+  }
+
+ private:
+  // Number of steps of the first band searched by diff_bisect(), which is
+  // then twice as many diagonals wide.
+  static const int BISECT_BAND = 512;
+
+  // Work units per unit of input which diff_degrade() may spend.
+  static const int DEGRADE_WORK = 32;
+
+  // Number of units diff_find() scans between checks of the deadline.
+  static const int FIND_STEP = 4096;
+
+  // Outcomes of diff_bisectMiddle().
+  enum BisectResult {
+    BISECT_FOUND, BISECT_EXPIRED, BISECT_EXCEEDED
+  };
+
+  /**
+   * Find the differences between two ranges.  Assumes that the ranges do
+   * not have any common prefix or suffix.
+   * @param text1 Start of the old range.
+   * @param length1 Length of the old range.
+   * @param text2 Start of the new range.
+   * @param length2 Length of the new range.
+   * @param halfMatch Allow the half-match speedup.
+   * @param deadline Time and work limit of the diff.
+   * @return List of DiffRun objects.
+   */
+  static QList<DiffRun> diff_compute(Iterator text1, int length1,
+                                     Iterator text2, int length2,
+                                     bool halfMatch, DiffDeadline deadline) {
+    QList<DiffRun> runs;
+
+    if (length1 == 0) {
+      // Just add some text (speedup).
+      append(runs, DiffRun(INSERT, length2));
+      return runs;
+    }
+
+    if (length2 == 0) {
+      // Just delete some text (speedup).
+      runs.append(DiffRun(DELETE, length1));
+      return runs;
+    }
+
+    const bool longer1 = length1 > length2;
+    const Iterator longtext = longer1 ? text1 : text2;
+    const Iterator shorttext = longer1 ? text2 : text1;
+    const int longlength = longer1 ? length1 : length2;
+    const int shortlength = longer1 ? length2 : length1;
+    QVector<int> failure;
+    diff_failure(shorttext, shortlength, failure);
+    int position = 0;
+    int matched = 0;
+    const int i = diff_find(longtext, longlength, shorttext, failure,
+                            deadline, position, matched);
+    if (i != -1) {
+      // Shorter text is inside the longer text (speedup).
+      const Operation op = longer1 ? DELETE : INSERT;
+      append(runs, DiffRun(op, i));
+      append(runs, DiffRun(EQUAL, shortlength));
+      append(runs, DiffRun(op, longlength - i - shortlength));
+      return runs;
+    }
+
+    if (shortlength == 1) {
+      // Single character string.
+      // After the previous speedup, the character can't be an equality.
+      runs.append(DiffRun(DELETE, length1));
+      runs.append(DiffRun(INSERT, length2));
+      return runs;
+    }
+
+    // Check to see if the problem can be split in two.
+    int common1, common2, commonLength;
+    if (halfMatch && diff_halfMatch(text1, length1, text2, length2, deadline,
+                                    common1, common2, commonLength)) {
+      // Send both pairs off for separate processing.
+      runs = diff_main(text1, common1, text2, common2, halfMatch, deadline);
+      append(runs, DiffRun(EQUAL, commonLength));
+      append(runs, diff_main(text1 + common1 + commonLength,
+                             length1 - common1 - commonLength,
+                             text2 + common2 + commonLength,
+                             length2 - common2 - commonLength,
+                             halfMatch, deadline));
+      return runs;
+    }
+
+    // Perform a real diff.  Line mode is no help once the deadline has
+    // passed.
+    if (deadline.checklines && length1 > 100 && length2 > 100
+        && !deadline.expired()
+        && diff_coreLines(text1, length1, text2, length2, deadline, runs)) {
+      return runs;
+    }
+
+    // Short ranges take a bit-parallel LCS, unless the deadline has passed
+    // or the work budget can't cover it, in which case diff_bisect() decides
+    // what to return.
+    if (shortlength <= BITLCS_MAX && !deadline.expired()
+        && !deadline.cancelled()
+        && (deadline.budget == NULL || *deadline.budget >= longlength)) {
+      deadline.spend(longlength);
+      return diff_bitLcs(text1, length1, text2, length2);
+    }
+    return diff_bisect(text1, length1, text2, length2, halfMatch, deadline);
+  }
+
+  /**
+   * Build the Knuth-Morris-Pratt failure table of a pattern: for each
+   * prefix, the length of its longest proper prefix which is also a suffix.
+   * @param pattern Start of the pattern.
+   * @param length Length of the pattern, at least 1.
+   * @param failure Set to the table, one entry per unit of the pattern.
+   */
+  static void diff_failure(Iterator pattern, int length,
+                           QVector<int> &failure) {
+    failure.resize(length);
+    failure[0] = 0;
+    int matched = 0;
+    for (int x = 1; x < length; x++) {
+      while (matched > 0 && pattern[x] != pattern[matched]) {
+        matched = failure[matched - 1];
+      }
+      if (pattern[x] == pattern[matched]) {
+        matched++;
+      }
+      failure[x] = matched;
+    }
+  }
+
+  /**
+   * Find the next occurrence of a pattern in a range, in linear time.  The
+   * scan is charged to the deadline, and given up once the deadline has
+   * expired or the diff is cancelled.
+   * @param text Start of the range to search.
+   * @param length Length of the range.
+   * @param pattern Start of the pattern.
+   * @param failure Failure table of the pattern, from diff_failure().
+   * @param deadline Time and work limit of the search.
+   * @param position Index in text at which to resume, updated.
+   * @param matched Number of units of the pattern matched just before
+   *     position, updated; 0 for a new search.
+   * @return Index of the occurrence, or -1 if there is none or the deadline
+   *     has expired.
+   */
+  static int diff_find(Iterator text, int length, Iterator pattern,
+                       const QVector<int> &failure, DiffDeadline deadline,
+                       int &position, int &matched) {
+    const int patternLength = failure.size();
+    int start = position;
+    for (int x = position; x < length; x++) {
+      if (x - start == FIND_STEP) {
+        deadline.spend(x - start);
+        start = x;
+        if (deadline.expired() || deadline.cancelled()) {
+          position = length;
+          return -1;
+        }
+      }
+      while (matched > 0 && text[x] != pattern[matched]) {
+        matched = failure[matched - 1];
+      }
+      if (text[x] == pattern[matched]) {
+        matched++;
+      }
+      if (matched == patternLength) {
+        deadline.spend(x + 1 - start);
+        position = x + 1;
+        matched = failure[patternLength - 1];
+        return x + 1 - patternLength;
+      }
+    }
+    deadline.spend(length - start);
+    position = length;
+    return -1;
+  }
+
+  /**
+   * Does a substring of shorttext exist within longtext such that the
+   * substring is at least half the length of longtext?
+   * @param longtext Start of the longer range.
+   * @param longlength Length of the longer range.
+   * @param shorttext Start of the shorter range.
+   * @param shortlength Length of the shorter range.
+   * @param i Start index of quarter length substring within longtext.
+   * @param deadline Time and work limit, to which the comparisons are
+   *     charged.
+   * @param longStart Set to the offset of the common middle in longtext.
+   * @param shortStart Set to the offset of the common middle in shorttext.
+   * @param commonLength Set to the length of the common middle.
+   * @return True if there is a half-match.
+   */
+  static bool diff_halfMatchI(Iterator longtext, int longlength,
+                              Iterator shorttext, int shortlength, int i,
+                              DiffDeadline deadline, int &longStart,
+                              int &shortStart, int &commonLength) {
+    // Start with a 1/4 length substring at position i as a seed.
+    const Iterator seed = longtext + i;
+    const int seedLength = std::min(longlength / 4, longlength - i);
+    longStart = 0;
+    shortStart = 0;
+    commonLength = 0;
+    QVector<int> failure;
+    diff_failure(seed, seedLength, failure);
+    int position = 0;
+    int matched = 0;
+    int j;
+    while ((j = diff_find(shorttext, shortlength, seed, failure, deadline,
+                          position, matched)) != -1) {
+      const int prefixLength = diff_commonPrefix(longtext + i, longlength - i,
+          shorttext + j, shortlength - j);
+      const int suffixLength = diff_commonSuffix(longtext, i, shorttext, j);
+      deadline.spend(prefixLength + suffixLength);
+      if (deadline.expired() || deadline.cancelled()) {
+        break;
+      }
+      if (commonLength < suffixLength + prefixLength) {
+        commonLength = suffixLength + prefixLength;
+        longStart = i - suffixLength;
+        shortStart = j - suffixLength;
+      }
+    }
+    return commonLength * 2 >= longlength;
+  }
+
+  /**
+   * Find the 'middle snake' of a diff within a band of diagonals around the
+   * main one, using memory in proportion to the width of the band.
+   * @param text1 Start of the old range.
+   * @param length1 Length of the old range.
+   * @param text2 Start of the new range.
+   * @param length2 Length of the new range.
+   * @param deadline Time and work limit of the diff.
+   * @param max_d Number of steps to take along each path, so that the band
+   *     is 2 * max_d diagonals wide and holds diffs of up to about that
+   *     many edits.
+   * @param x Set to the split point in text1, or to the furthest point
+   *     reached if the middle snake wasn't found.
+   * @param y Set to the split point in text2, likewise.
+   * @return BISECT_FOUND, or BISECT_EXPIRED if the deadline was reached, or
+   *     BISECT_EXCEEDED if the ranges differ by more than the band holds.
+   */
+  static BisectResult diff_bisectMiddle(Iterator text1, int length1,
+                                        Iterator text2, int length2,
+                                        DiffDeadline deadline, int max_d,
+                                        int &x, int &y) {
+    const int delta = length1 - length2;
+    x = 0;
+    y = 0;
+    if (std::abs(delta) > 2 * max_d) {
+      // The length difference alone is outside the band.
+      return BISECT_EXCEEDED;
+    }
+    const int v_offset = max_d;
+    const int v_length = 2 * max_d;
+    BisectArrays arrays(v_length);
+    int *v1 = arrays.v1;
+    int *v2 = arrays.v2;
+    for (int i = 0; i < v_length; i++) {
+      v1[i] = -1;
+      v2[i] = -1;
+    }
+    v1[v_offset + 1] = 0;
+    v2[v_offset + 1] = 0;
+    // If the total number of characters is odd, then the front path will
+    // collide with the reverse path.
+    const bool front = (delta % 2 != 0);
+    // Offsets for start and end of k loop.
+    // Prevents mapping of space beyond the grid.
+    int k1start = 0;
+    int k1end = 0;
+    int k2start = 0;
+    int k2end = 0;
+    BisectResult result = BISECT_EXCEEDED;
+    for (int d = 0; d < max_d; d++) {
+      // Bail out if deadline is reached or the diff is cancelled.
+      if (deadline.expired() || deadline.cancelled()) {
+        result = BISECT_EXPIRED;
+        break;
+      }
+      // Charge the diagonals about to be explored in both directions.
+      deadline.spend(2 * d + 2 - (k1start + k1end + k2start + k2end) / 2);
+      if ((d & 0xFF) == 0 && deadline.progress != NULL) {
+        deadline.progress->reportProgress("diff_bisect", d, max_d);
+      }
+
+      // Walk the front path one step.
+      for (int k1 = -d + k1start; k1 <= d - k1end; k1 += 2) {
+        const int k1_offset = v_offset + k1;
+        int x1;
+        if (k1 == -d || (k1 != d && v1[k1_offset - 1] < v1[k1_offset + 1])) {
+          x1 = v1[k1_offset + 1];
+        } else {
+          x1 = v1[k1_offset - 1] + 1;
+        }
+        int y1 = x1 - k1;
+        while (x1 < length1 && y1 < length2 && text1[x1] == text2[y1]) {
+          x1++;
+          y1++;
+        }
+        v1[k1_offset] = x1;
+        if (x1 > length1) {
+          // Ran off the right of the graph.
+          k1end += 2;
+        } else if (y1 > length2) {
+          // Ran off the bottom of the graph.
+          k1start += 2;
+        } else if (front) {
+          int k2_offset = v_offset + delta - k1;
+          if (k2_offset >= 0 && k2_offset < v_length && v2[k2_offset] != -1) {
+            // Mirror x2 onto top-left coordinate system.
+            int x2 = length1 - v2[k2_offset];
+            if (x1 >= x2) {
+              // Overlap detected.
+              x = x1;
+              y = y1;
+              return BISECT_FOUND;
+            }
+          }
+        }
+      }
+
+      // Walk the reverse path one step.
+      for (int k2 = -d + k2start; k2 <= d - k2end; k2 += 2) {
+        const int k2_offset = v_offset + k2;
+        int x2;
+        if (k2 == -d || (k2 != d && v2[k2_offset - 1] < v2[k2_offset + 1])) {
+          x2 = v2[k2_offset + 1];
+        } else {
+          x2 = v2[k2_offset - 1] + 1;
+        }
+        int y2 = x2 - k2;
+        while (x2 < length1 && y2 < length2
+            && text1[length1 - x2 - 1] == text2[length2 - y2 - 1]) {
+          x2++;
+          y2++;
+        }
+        v2[k2_offset] = x2;
+        if (x2 > length1) {
+          // Ran off the left of the graph.
+          k2end += 2;
+        } else if (y2 > length2) {
+          // Ran off the top of the graph.
+          k2start += 2;
+        } else if (!front) {
+          int k1_offset = v_offset + delta - k2;
+          if (k1_offset >= 0 && k1_offset < v_length && v1[k1_offset] != -1) {
+            int x1 = v1[k1_offset];
+            int y1 = v_offset + x1 - k1_offset;
+            // Mirror x2 onto top-left coordinate system.
+            x2 = length1 - x2;
+            if (x1 >= x2) {
+              // Overlap detected.
+              x = x1;
+              y = y1;
+              return BISECT_FOUND;
+            }
+          }
+        }
+      }
+    }
+    // Report the furthest point reached by either path.
+    int best = 0;
+    for (int k_offset = 0; k_offset < v_length; k_offset++) {
+      const int k = k_offset - v_offset;
+      const int x1 = v1[k_offset];
+      const int y1 = x1 - k;
+      if (x1 >= 0 && y1 >= 0 && x1 <= length1 && y1 <= length2
+          && x1 + y1 > best) {
+        best = x1 + y1;
+        x = x1;
+        y = y1;
+      }
+      const int x2 = v2[k_offset];
+      const int y2 = x2 - k;
+      if (x2 >= 0 && y2 >= 0 && x2 <= length1 && y2 <= length2
+          && x2 + y2 > best) {
+        // Mirror onto top-left coordinate system.
+        best = x2 + y2;
+        x = length1 - x2;
+        y = length2 - y2;
+      }
+    }
+    return result;
+  }
+
+  /**
+   * Given the location of the 'middle snake', split the diff in two parts
+   * and recurse.
+   * @param text1 Start of the old range.
+   * @param length1 Length of the old range.
+   * @param text2 Start of the new range.
+   * @param length2 Length of the new range.
+   * @param x Index of split point in text1.
+   * @param y Index of split point in text2.
+   * @param halfMatch Allow the half-match speedup.
+   * @param deadline Time and work limit of the diff.
+   * @return List of DiffRun objects.
+   */
+  static QList<DiffRun> diff_bisectSplit(Iterator text1, int length1,
+                                         Iterator text2, int length2,
+                                         int x, int y, bool halfMatch,
+                                         DiffDeadline deadline) {
+    // Compute both diffs serially, character by character.
+    deadline.checklines = false;
+    QList<DiffRun> runs = diff_main(text1, x, text2, y, halfMatch, deadline);
+    append(runs, diff_main(text1 + x, length1 - x, text2 + y, length2 - y,
+                           halfMatch, deadline));
+    return runs;
+  }
+
+  /**
+   * Finish a diff which ran out of time or work, given the furthest point
+   * that diff_bisect() reached.  Both sides of the point are diffed again
+   * (line by line where they are long and there is a line mode) under a
+   * fresh work budget in proportion to their length; what that budget
+   * doesn't cover is deleted and inserted whole.
+   * @param text1 Start of the old range.
+   * @param length1 Length of the old range.
+   * @param text2 Start of the new range.
+   * @param length2 Length of the new range.
+   * @param x Index of split point in text1.
+   * @param y Index of split point in text2.
+   * @param halfMatch Allow the half-match speedup.
+   * @param deadline Deadline which ran out.
+   * @return List of DiffRun objects.
+   */
+  static QList<DiffRun> diff_degrade(Iterator text1, int length1,
+                                     Iterator text2, int length2,
+                                     int x, int y, bool halfMatch,
+                                     DiffDeadline deadline) {
+    qint64 budget = DEGRADE_WORK * static_cast<qint64>(length1 + length2);
+    if (!deadline.degraded) {
+      // The time has already run out, so bound the rest of the diff by work
+      // and a short grace period instead.  Parts which run out again are
+      // split no further.
+      const clock_t start = std::max(deadline.time, clock());
+      if (deadline.grace == (clock_t)-1
+          || start > std::numeric_limits<clock_t>::max() - deadline.grace) {
+        deadline.time = std::numeric_limits<clock_t>::max();
+      } else {
+        deadline.time = start + deadline.grace;
+      }
+      deadline.budget = &budget;
+      deadline.degraded = true;
+      deadline.maxEdits = -1;
+      deadline.exceeded = NULL;
+    }
+
+    // Diff the long parts line by line, so that what the budget doesn't
+    // cover is still replaced a line at a time.
+    deadline.checklines = true;
+    QList<DiffRun> runs = diff_main(text1, x, text2, y, halfMatch, deadline);
+    append(runs, diff_main(text1 + x, length1 - x, text2 + y, length2 - y,
+                           halfMatch, deadline));
+    return runs;
+  }
+
+  /**
+   * Count the set bits of a word.
+   * @param bits Word to count.
+   * @return Number of bits set.
+   */
+  static int bitCount(quint64 bits) {
+    int count = 0;
+    for (; bits != 0; bits &= bits - 1) {
+      count++;
+    }
+    return count;
+  }
+
+  /**
+   * Append a run, merging it into the last one if they share an operation.
+   * Empty runs are dropped.
+   * @param runs List of DiffRun objects to append to.
+   * @param run Run to append.
+   */
+  static void append(QList<DiffRun> &runs, const DiffRun &run) {
+    if (run.length == 0) {
+      return;
+    } else if (!runs.isEmpty() && runs.last().operation == run.operation) {
+      runs.last().length += run.length;
+    } else {
+      runs.append(run);
+    }
+  }
+
+  /**
+   * Append a list of runs, merging adjacent runs which share an operation.
+   * @param runs List of DiffRun objects to append to.
+   * @param more Runs to append.
+   */
+  static void append(QList<DiffRun> &runs, const QList<DiffRun> &more) {
+    foreach(const DiffRun &run, more) {
+      append(runs, run);
+    }
+  }
+};
+
+// Definitions of the constants, for when they are bound to a reference
+// (e.g. by std::min) in a build without optimisation.
+template <typename Iterator>
+const int diff_core<Iterator>::BITLCS_MAX;
+template <typename Iterator>
+const int diff_core<Iterator>::BISECT_BAND;
+template <typename Iterator>
+const int diff_core<Iterator>::DEGRADE_WORK;
+template <typename Iterator>
+const int diff_core<Iterator>::FIND_STEP;
+
+
+/**
+* Diff of two sequences of tokens, e.g. QVector<quint32> of line or word
+* ids, or std::vector<quint64> of record hashes.  Seq may be any container
+* with random access const_iterators, begin() and size(), whose elements
+* can be compared with ==.  Also contains the behaviour settings.
+*/
+template <typename Seq>
+class diff_sequence {
+ public:
+  typedef typename Seq::const_iterator Iterator;
+
+  // Defaults.
+  // Set these on your diff_sequence instance to override the defaults.
+
+  // Number of seconds to map a diff before giving up (0 for infinity).
+  float Diff_Timeout;
+  // Number of work units after which a diff gives up, as it would on
+  // reaching Diff_Timeout (0 for infinity).
+  qint64 Diff_WorkBudget;
+  // When a diff runs out of time or work, finish the unfinished parts with a
+  // coarser diff rather than deleting and inserting them whole.
+  bool Diff_Degrade;
+  // Token which stops running diffs when cancelled, or NULL for none.
+  // The token is not owned.
+  DiffCancelToken *Diff_Cancel;
+
+  diff_sequence() : Diff_Timeout(1.0f), Diff_WorkBudget(0),
+                    Diff_Degrade(false), Diff_Cancel(NULL) {}
+
+  /**
+   * Find the differences between two sequences.
+   * @param seq1 Old sequence to be diffed.
+   * @param seq2 New sequence to be diffed.
+   * @return List of DiffRun objects.
+   */
+  QList<DiffRun> diff_main(const Seq &seq1, const Seq &seq2) const {
+    qint64 budget;
+    return diff_core<Iterator>::diff_main(
+        seq1.begin(), static_cast<int>(seq1.size()),
+        seq2.begin(), static_cast<int>(seq2.size()),
+        Diff_Timeout > 0 || Diff_WorkBudget > 0, deadline(budget));
+  }
+
+  /**
+   * Find the 'middle snake' of a diff, split the problem in two
+   * and return the recursively constructed diff.
+   * See Myers 1986 paper: An O(ND) Difference Algorithm and Its Variations.
+   * @param seq1 Old sequence to be diffed.
+   * @param seq2 New sequence to be diffed.
+   * @return List of DiffRun objects.
+   */
+  QList<DiffRun> diff_bisect(const Seq &seq1, const Seq &seq2) const {
+    qint64 budget;
+    return diff_core<Iterator>::diff_bisect(
+        seq1.begin(), static_cast<int>(seq1.size()),
+        seq2.begin(), static_cast<int>(seq2.size()),
+        Diff_Timeout > 0 || Diff_WorkBudget > 0, deadline(budget));
+  }
+
+  /**
+   * Determine the common prefix of two sequences.
+   * @param seq1 First sequence.
+   * @param seq2 Second sequence.
+   * @return The number of tokens common to the start of each sequence.
+   */
+  int diff_commonPrefix(const Seq &seq1, const Seq &seq2) const {
+    return diff_core<Iterator>::diff_commonPrefix(
+        seq1.begin(), static_cast<int>(seq1.size()),
+        seq2.begin(), static_cast<int>(seq2.size()));
+  }
+
+  /**
+   * Determine the common suffix of two sequences.
+   * @param seq1 First sequence.
+   * @param seq2 Second sequence.
+   * @return The number of tokens common to the end of each sequence.
+   */
+  int diff_commonSuffix(const Seq &seq1, const Seq &seq2) const {
+    return diff_core<Iterator>::diff_commonSuffix(
+        seq1.begin(), static_cast<int>(seq1.size()),
+        seq2.begin(), static_cast<int>(seq2.size()));
+  }
+
+  /**
+   * Reorder and merge like edit sections.  Merge equalities.
+   * Any edit section can move as long as it doesn't cross an equality.
+   * @param seq1 Old sequence.
+   * @param seq2 New sequence.
+   * @param runs List of DiffRun objects.
+   */
+  void diff_cleanupMerge(const Seq &seq1, const Seq &seq2,
+                         QList<DiffRun> &runs) const {
+    diff_core<Iterator>::diff_cleanupMerge(seq1.begin(), seq2.begin(), runs);
+  }
+
+  /**
+   * Compute the Levenshtein distance; the number of inserted, deleted or
+   * substituted tokens.
+   * @param runs List of DiffRun objects.
+   * @return Number of changes.
+   */
+  int diff_levenshtein(const QList<DiffRun> &runs) const {
+    return diff_core<Iterator>::diff_levenshtein(runs);
+  }
+
+ private:
+  /**
+   * Deadline for a diff started now.
+   * @param budget Storage for the work units left, set here.
+   * @return Deadline for diff_core.
+   */
+  DiffDeadline deadline(qint64 &budget) const {
+    clock_t time;
+    if (Diff_Timeout <= 0) {
+      time = std::numeric_limits<clock_t>::max();
+    } else {
+      time = clock() + (clock_t)(Diff_Timeout * CLOCKS_PER_SEC);
+    }
+    budget = Diff_WorkBudget;
+    DiffDeadline deadline(time, Diff_WorkBudget > 0 ? &budget : NULL);
+    deadline.cancel = Diff_Cancel;
+    deadline.degrade = Diff_Degrade;
+    if (Diff_Timeout > 0) {
+      deadline.grace = (clock_t)(Diff_Timeout * CLOCKS_PER_SEC / 4);
+    }
+    return deadline;
+  }
+};
+
+#endif // DIFF_MATCH_PATCH_CORE_H
@@ -19,9 +19,11 @@
  * http://code.google.com/p/google-diff-match-patch/
  */
 
+#include <vector>
 // Code known to compile and run with Qt 4.3 through Qt 4.7.
 #include <QtCore>
 #include "diff_match_patch.h"
+#include "diff_match_patch_core.h"
 #include "diff_match_patch_test.h"
 
 int main(int argc, char **argv) {
@@ -48,6 +50,7 @@ void diff_match_patch_test::run_all_tests() {
     testDiffHalfmatch();
     testDiffLinesToChars();
     testDiffCharsToLines();
+    testDiffWordsToChars();
     testDiffCleanupMerge();
     testDiffCleanupSemanticLossless();
     testDiffCleanupSemantic();
@@ -55,10 +58,31 @@ void diff_match_patch_test::run_all_tests() {
     testDiffPrettyHtml();
     testDiffText();
     testDiffDelta();
+    testDiffBinaryDelta();
+    testDiffFilesToDelta();
+    testDiffStream();
     testDiffXIndex();
+    testDiffIndex();
     testDiffLevenshtein();
+    testDiffEditDistance();
     testDiffBisect();
     testDiffMain();
+    testDiffMainNarrow();
+    testDiffWordMode();
+    testDiffHierarchical();
+    testDiffMoves();
+    testDiffAnchorMode();
+    testDiffDocument();
+    testDiffCache();
+    testDiffOptions();
+    testDiffMany();
+    testDiffCancel();
+    testDiffWorkBudget();
+    testDiffDegrade();
+    testDiffBounded();
+    testDiffBitLcs();
+    testDiffPrefilter();
+    testDiffSequence();
 
     testMatchAlphabet();
     testMatchBitap();
@@ -66,7 +90,10 @@ void diff_match_patch_test::run_all_tests() {
 
     testPatchObj();
     testPatchFromText();
+    testPatchReader();
     testPatchToText();
+    testPatchWriter();
+    testPatchBinary();
     testPatchAddContext();
     testPatchMake();
     testPatchSplitMax();
@@ -231,6 +258,66 @@ void diff_match_patch_test::testDiffCharsToLines() {
   assertEquals("diff_charsToLines: More than 256.", diffList(Diff(DELETE, lines)), diffs);
 }
 
+void diff_match_patch_test::testDiffWordsToChars() {
+  // Convert words, whitespace and punctuation down to characters.
+  QStringList tmpVector;
+  QList<QVariant> tmpVarList;
+  tmpVector.append("");
+  tmpVector.append("alpha");
+  tmpVector.append(" ");
+  tmpVector.append("beta");
+  tmpVector.append(".");
+  tmpVarList << QVariant::fromValue(QString() + QChar((ushort)1) + QChar((ushort)2) + QChar((ushort)3) + QChar((ushort)4));  // (("\u0001\u0002\u0003\u0004"));
+  tmpVarList << QVariant::fromValue(QString() + QChar((ushort)3) + QChar((ushort)2) + QChar((ushort)1) + QChar((ushort)4));  // (("\u0003\u0002\u0001\u0004"));
+  tmpVarList << QVariant::fromValue(tmpVector);
+  assertEquals("diff_wordsToChars:", tmpVarList, dmp.diff_wordsToChars("alpha beta.", "beta alpha."));
+
+  tmpVector.clear();
+  tmpVarList.clear();
+  tmpVector.append("");
+  tmpVector.append("a1");
+  tmpVector.append(" \t\n");
+  tmpVector.append(",");
+  tmpVarList << QVariant::fromValue(QString(""));
+  tmpVarList << QVariant::fromValue(QString() + QChar((ushort)1) + QChar((ushort)2) + QChar((ushort)3) + QChar((ushort)3) + QChar((ushort)1));  // (("\u0001\u0002\u0003\u0003\u0001"));
+  tmpVarList << QVariant::fromValue(tmpVector);
+  assertEquals("diff_wordsToChars: Runs of whitespace, single punctuation.", tmpVarList, dmp.diff_wordsToChars("", "a1 \t\n,,a1"));
+
+  // Surrogate pairs are never split.
+  const ushort pair[] = {0xD83D, 0xDE00};
+  tmpVector.clear();
+  tmpVarList.clear();
+  tmpVector.append("");
+  tmpVector.append(QString::fromUtf16(pair, 2));
+  tmpVarList << QVariant::fromValue(QString() + QChar((ushort)1) + QChar((ushort)1));  // (("\u0001\u0001"));
+  tmpVarList << QVariant::fromValue(QString(""));
+  tmpVarList << QVariant::fromValue(tmpVector);
+  assertEquals("diff_wordsToChars: Surrogate pairs.", tmpVarList, dmp.diff_wordsToChars(QString::fromUtf16(pair, 2) + QString::fromUtf16(pair, 2), ""));
+
+  // More than 256 to reveal any 8-bit limitations.
+  int n = 300;
+  tmpVector.clear();
+  tmpVarList.clear();
+  QString words;
+  QString chars;
+  for (int x = 1; x < n + 1; x++) {
+    tmpVector.append("w" + QString::number(x));
+    if (x == 1) {
+      tmpVector.append(",");
+    }
+    words += "w" + QString::number(x) + ",";
+    chars += QChar(static_cast<ushort>(x == 1 ? 1 : x + 1));
+    chars += QChar(static_cast<ushort>(2));
+  }
+  assertEquals("diff_wordsToChars: More than 256 (setup).", n + 1, tmpVector.size());
+  assertEquals("diff_wordsToChars: More than 256 (setup).", 2 * n, chars.length());
+  tmpVector.prepend("");
+  tmpVarList << QVariant::fromValue(chars);
+  tmpVarList << QVariant::fromValue(QString(""));
+  tmpVarList << QVariant::fromValue(tmpVector);
+  assertEquals("diff_wordsToChars: More than 256.", tmpVarList, dmp.diff_wordsToChars(words, ""));
+}
+
 void diff_match_patch_test::testDiffCleanupMerge() {
   // Cleanup a messy diff.
   QList<Diff> diffs;
@@ -436,14 +523,20 @@ void diff_match_patch_test::testDiffDelta() {
   }
 
   // Generates error (%c3%xy invalid Unicode).
-  /* This test does not work because QUrl::fromPercentEncoding("%xy") -> "?"
   try {
     dmp.diff_fromDelta("", "+%c3%xy");
     assertFalse("diff_fromDelta: Invalid character.", true);
   } catch (QString ex) {
     // Exception expected.
   }
-  */
+
+  // Generates error (truncated escape).
+  try {
+    dmp.diff_fromDelta("", "+%c");
+    assertFalse("diff_fromDelta: Truncated escape.", true);
+  } catch (QString ex) {
+    // Exception expected.
+  }
 
   // Test deltas with special characters.
   diffs = diffList(Diff(EQUAL, QString::fromWCharArray((const wchar_t*) L"\u0680 \000 \t %", 7)), Diff(DELETE, QString::fromWCharArray((const wchar_t*) L"\u0681 \001 \n ^", 7)), Diff(INSERT, QString::fromWCharArray((const wchar_t*) L"\u0682 \002 \\ |", 7)));
@@ -465,6 +558,177 @@ void diff_match_patch_test::testDiffDelta() {
 
   // Convert delta string into a diff.
   assertEquals("diff_fromDelta: Unchanged characters.", diffs, dmp.diff_fromDelta("", delta));
+  // Test deltas with characters outside the Basic Multilingual Plane.
+  const ushort pair[] = {'a', 0xD83D, 0xDE00, 'b'};
+  diffs = diffList(Diff(INSERT, QString::fromUtf16(pair, 4)));
+  delta = dmp.diff_toDelta(diffs);
+  assertEquals("diff_toDelta: Surrogate pair.", "+a%F0%9F%98%80b", delta);
+
+  assertEquals("diff_fromDelta: Surrogate pair.", diffs, dmp.diff_fromDelta("", delta));
+
+  // Unescaped non-ASCII characters are accepted as they are.
+  assertEquals("diff_fromDelta: Unescaped Unicode.", diffList(Diff(INSERT, QString::fromUtf16(pair, 4) + QString(QChar(0x0682)))), dmp.diff_fromDelta("", QString("+a%F0%9F%98%80b") + QString(QChar(0x0682))));
+}
+
+void diff_match_patch_test::testDiffBinaryDelta() {
+  // Convert a diff into a binary delta and back.
+  QList<Diff> diffs = diffList(Diff(EQUAL, "jump"), Diff(DELETE, "s"), Diff(INSERT, "ed"), Diff(EQUAL, " over "), Diff(DELETE, "the"), Diff(INSERT, "a"), Diff(EQUAL, " lazy"), Diff(INSERT, "old dog"));
+  QString text1 = dmp.diff_text1(diffs);
+  QByteArray delta = dmp.diff_toBinaryDelta(diffs);
+  assertEquals("diff_fromBinaryDelta: Normal.", diffs, dmp.diff_fromBinaryDelta(text1, delta));
+
+  delta = dmp.diff_toBinaryDelta(diffs, false);
+  assertEquals("diff_toBinaryDelta: Without checksum.", dmp.diff_toBinaryDelta(diffs).size() - 4, delta.size());
+  assertEquals("diff_fromBinaryDelta: Without checksum.", diffs, dmp.diff_fromBinaryDelta(text1, delta));
+
+  // Generates error (19 < 20).
+  try {
+    dmp.diff_fromBinaryDelta(text1 + "x", dmp.diff_toBinaryDelta(diffs, false));
+    assertFalse("diff_fromBinaryDelta: Too long.", true);
+  } catch (QString ex) {
+    // Exception expected.
+  }
+
+  // Generates error (19 > 18).
+  try {
+    dmp.diff_fromBinaryDelta(text1.mid(1), dmp.diff_toBinaryDelta(diffs, false));
+    assertFalse("diff_fromBinaryDelta: Too short.", true);
+  } catch (QString ex) {
+    // Exception expected.
+  }
+
+  // Generates error (same length, different text).
+  try {
+    dmp.diff_fromBinaryDelta("jumps over the lazz", dmp.diff_toBinaryDelta(diffs));
+    assertFalse("diff_fromBinaryDelta: Checksum.", true);
+  } catch (QString ex) {
+    // Exception expected.
+  }
+
+  // Generates error (truncated).
+  delta = dmp.diff_toBinaryDelta(diffs);
+  try {
+    dmp.diff_fromBinaryDelta(text1, delta.left(delta.size() - 2));
+    assertFalse("diff_fromBinaryDelta: Truncated.", true);
+  } catch (QString ex) {
+    // Exception expected.
+  }
+
+  // Test deltas with special characters.
+  diffs = diffList(Diff(EQUAL, QString::fromWCharArray((const wchar_t*) L"\u0680 \000 \t %", 7)), Diff(DELETE, QString::fromWCharArray((const wchar_t*) L"\u0681 \001 \n ^", 7)), Diff(INSERT, QString::fromWCharArray((const wchar_t*) L"\u0682 \002 \\ |", 7)));
+  text1 = dmp.diff_text1(diffs);
+  assertEquals("diff_fromBinaryDelta: Unicode.", diffs, dmp.diff_fromBinaryDelta(text1, dmp.diff_toBinaryDelta(diffs)));
+
+  // Long texts need multi-byte lengths.
+  QString longText = QString("x").repeated(100000);
+  diffs = diffList(Diff(EQUAL, longText), Diff(INSERT, longText), Diff(DELETE, "y"));
+  text1 = dmp.diff_text1(diffs);
+  assertEquals("diff_fromBinaryDelta: Long.", diffs, dmp.diff_fromBinaryDelta(text1, dmp.diff_toBinaryDelta(diffs)));
+}
+
+void diff_match_patch_test::testDiffFilesToDelta() {
+  // Changed line between a common prefix and suffix.
+  QString text1 = "alpha\nbeta\ngamma\ndelta\n";
+  QString text2 = "alpha\nbeta\nGAMMA\ndelta\n";
+  QString delta = diff_filesToDelta(text1, text2);
+  assertEquals("diff_filesToDelta: Changed line.", "=11\t-5\t+GAMMA\t=7", delta);
+
+  assertEquals("diff_filesToDelta: Changed line text2.", text2, dmp.diff_text2(dmp.diff_fromDelta(text1, delta)));
+
+  // Inserted and deleted lines, with no common prefix or suffix.
+  text1 = "one\ntwo\nthree\nfour\nfive";
+  text2 = "zero\none\nthree\nfour\nsix\nfive!";
+  delta = diff_filesToDelta(text1, text2);
+  assertEquals("diff_filesToDelta: Inserted and deleted lines.", text2, dmp.diff_text2(dmp.diff_fromDelta(text1, delta)));
+
+  // Lengths are counted in UTF-16 units, without decoding unchanged lines.
+  const ushort pair[] = {0xD83D, 0xDE00};
+  text1 = QString(QChar(0x00E9)) + "\n" + QString::fromUtf16(pair, 2) + "\nx\n" + QString(QChar(0x0682)) + "\n";
+  text2 = QString(QChar(0x00E9)) + "\n" + QString::fromUtf16(pair, 2) + "\ny\n" + QString(QChar(0x0682)) + "\n";
+  delta = diff_filesToDelta(text1, text2);
+  assertEquals("diff_filesToDelta: Unicode.", "=5\t-1\t+y\t=3", delta);
+
+  assertEquals("diff_filesToDelta: Unicode text2.", text2, dmp.diff_text2(dmp.diff_fromDelta(text1, delta)));
+
+  // Identical and empty files.
+  assertEquals("diff_filesToDelta: Identical.", "=4", diff_filesToDelta("abc\n", "abc\n"));
+
+  assertEquals("diff_filesToDelta: Both empty.", "", diff_filesToDelta("", ""));
+
+  assertEquals("diff_filesToDelta: Insertion.", "+abc%0A", diff_filesToDelta("", "abc\n"));
+
+  assertEquals("diff_filesToDelta: Deletion.", "-4", diff_filesToDelta("abc\n", ""));
+
+  // More distinct lines than fit in a QChar.
+  text1 = "";
+  for (int x = 0; x < 70000; x++) {
+    text1 += QString::number(x) + "\n";
+  }
+  text2 = "start\n" + text1;
+  text2.replace("\n69000\n", "\nchanged\n");
+  text2 += "end\n";
+  delta = diff_filesToDelta(text1, text2);
+  assertEquals("diff_filesToDelta: Many lines text2.", text2, dmp.diff_text2(dmp.diff_fromDelta(text1, delta)));
+
+  assertTrue("diff_filesToDelta: Many lines.", delta.length() < 100);
+
+  // Replacements larger than Diff_StreamWindow are not rediffed.
+  dmp.Diff_StreamWindow = 4;
+  assertEquals("diff_filesToDelta: Large replacement.", "=6\t-6\t+Gamma!%0A\t=6", diff_filesToDelta("alpha\ngamma\ndelta\n", "alpha\nGamma!\ndelta\n"));
+  dmp.Diff_StreamWindow = 1 << 20;
+
+  // Generates error (missing file).
+  try {
+    dmp.diff_filesToDelta("no such file", "no such file");
+    assertFalse("diff_filesToDelta: Missing file.", true);
+  } catch (QString ex) {
+    // Exception expected.
+  }
+}
+
+void diff_match_patch_test::testDiffStream() {
+  // Small enough to fit in one window.
+  QList<Diff> diffs = diffList(Diff(EQUAL, "one\n"), Diff(DELETE, "two"), Diff(INSERT, "2"), Diff(EQUAL, "\nthree\n"));
+  assertEquals("diff_stream: Single window.", diffs, diff_stream("one\ntwo\nthree\n", "one\n2\nthree\n"));
+
+  assertEquals("diff_stream: Null case.", diffList(), diff_stream("", ""));
+
+  assertEquals("diff_stream: Insertion.", diffList(Diff(INSERT, "a\nb")), diff_stream("", "a\nb"));
+
+  // Many windows, kept in step by unique lines.
+  QString text1;
+  QString text2;
+  for (int x = 0; x < 200; x++) {
+    const QString line = QString("line %1\n").arg(x);
+    if (x % 17 != 0) {
+      text1 += line;
+    }
+    text2 += x % 23 == 0 ? QString("new ") + line : line;
+  }
+  dmp.Diff_StreamWindow = 100;
+  diffs = diff_stream(text1, text2);
+  QStringList texts = diff_rebuildtexts(diffs);
+  assertEquals("diff_stream: Many windows text1.", text1, texts[0]);
+
+  assertEquals("diff_stream: Many windows text2.", text2, texts[1]);
+
+  assertEquals("diff_stream: Many windows distance.", dmp.diff_levenshtein(dmp.diff_main(text1, text2)), dmp.diff_levenshtein(diffs));
+
+  // Repeated lines give no anchors.
+  text1 = QString("x\n").repeated(100);
+  text2 = QString("x\n").repeated(50) + "y\n" + QString("x\n").repeated(60);
+  texts = diff_rebuildtexts(diff_stream(text1, text2));
+  assertEquals("diff_stream: No anchors.", text2, texts[1]);
+
+  // Lines longer than the window are split, without splitting characters.
+  text1 = QString("a") + QString(QChar(0x00E9)).repeated(300) + "\nb\n";
+  text2 = QString("a") + QString(QChar(0x00E9)).repeated(150) + "x" + QString(QChar(0x00E9)).repeated(150) + "\nb\n";
+  texts = diff_rebuildtexts(diff_stream(text1, text2));
+  assertEquals("diff_stream: Long line text1.", text1, texts[0]);
+
+  assertEquals("diff_stream: Long line text2.", text2, texts[1]);
+
+  dmp.Diff_StreamWindow = 1 << 20;
 }
 
 void diff_match_patch_test::testDiffXIndex() {
@@ -476,6 +740,28 @@ void diff_match_patch_test::testDiffXIndex() {
   assertEquals("diff_xIndex: Translation on deletion.", 1, dmp.diff_xIndex(diffs, 3));
 }
 
+void diff_match_patch_test::testDiffIndex() {
+  // Translate locations in text1 to text2 through a precomputed index.
+  QList<Diff> diffs = diffList(Diff(DELETE, "a"), Diff(INSERT, "1234"), Diff(EQUAL, "xyz"));
+  assertEquals("DiffIndex: Translation on equality.", 5, DiffIndex(diffs).xIndex(2));
+
+  diffs = diffList(Diff(EQUAL, "a"), Diff(DELETE, "1234"), Diff(EQUAL, "xyz"));
+  assertEquals("DiffIndex: Translation on deletion.", 1, DiffIndex(diffs).xIndex(3));
+
+  assertEquals("DiffIndex: Empty diff.", 3, DiffIndex(diffList()).xIndex(3));
+
+  // Every location must agree with diff_xIndex, including past the end.
+  diffs = diffList(Diff(INSERT, "12"), Diff(EQUAL, "ab"), Diff(DELETE, "cd"), Diff(INSERT, "345"), Diff(EQUAL, "e"), Diff(DELETE, "fgh"), Diff(EQUAL, "ij"), Diff(INSERT, "6"));
+  DiffIndex index(diffs);
+  QStringList expected;
+  QStringList actual;
+  for (int loc = 0; loc <= dmp.diff_text1(diffs).length() + 2; loc++) {
+    expected << QString::number(dmp.diff_xIndex(diffs, loc));
+    actual << QString::number(index.xIndex(loc));
+  }
+  assertEquals("DiffIndex: Matches diff_xIndex.", expected, actual);
+}
+
 void diff_match_patch_test::testDiffLevenshtein() {
   QList<Diff> diffs = diffList(Diff(DELETE, "abc"), Diff(INSERT, "1234"), Diff(EQUAL, "xyz"));
   assertEquals("diff_levenshtein: Trailing equality.", 4, dmp.diff_levenshtein(diffs));
@@ -487,6 +773,71 @@ void diff_match_patch_test::testDiffLevenshtein() {
   assertEquals("diff_levenshtein: Middle equality.", 7, dmp.diff_levenshtein(diffs));
 }
 
+void diff_match_patch_test::testDiffEditDistance() {
+  assertEquals("diff_editDistance: Null case.", 0, dmp.diff_editDistance("", ""));
+
+  assertEquals("diff_editDistance: Equality.", 0, dmp.diff_editDistance("abc", "abc"));
+
+  assertEquals("diff_editDistance: Insertion.", 3, dmp.diff_editDistance("", "abc"));
+
+  assertEquals("diff_editDistance: Substitutions.", 3, dmp.diff_editDistance("kitten", "sitting"));
+
+  assertEquals("diff_editDistance: Swapped.", 3, dmp.diff_editDistance("sitting", "kitten"));
+
+  assertEquals("diff_editDistance: Overlap.", 1, dmp.diff_editDistance("aa", "aaa"));
+
+  assertEquals("diff_editDistance: Unicode.", 2, dmp.diff_editDistance(QString::fromUtf8("\xc3\xa9t\xc3\xa9"), QString::fromUtf8("\xe2\x82\xact\xc3\xa9s")));
+
+  // Exact where a diff of a replaced block overcounts.
+  assertEquals("diff_editDistance: Exact.", 2, dmp.diff_editDistance("abcd", "bcda"));
+
+  // Compare long texts, several words of rows, with the textbook table.
+  uint seed = 1;
+  for (int x = 0; x < 20; x++) {
+    QString a = "";
+    QString b = "";
+    for (int i = 0; i < 50 + x * 13; i++) {
+      seed = seed * 1103515245 + 12345;
+      a += QChar(((seed >> 16) % 5 == 0 ? 0x3b1 : 'a') + (seed >> 8) % 4);
+      seed = seed * 1103515245 + 12345;
+      if ((seed >> 16) % 4 != 0) {
+        b += a[i];
+      }
+      if ((seed >> 8) % 6 == 0) {
+        b += QChar('a' + (seed >> 4) % 4);
+      }
+    }
+    QVector<int> row(b.length() + 1);
+    for (int j = 0; j <= b.length(); j++) {
+      row[j] = j;
+    }
+    for (int i = 1; i <= a.length(); i++) {
+      int diagonal = row[0];
+      row[0] = i;
+      for (int j = 1; j <= b.length(); j++) {
+        const int above = row[j];
+        row[j] = std::min(std::min(row[j], row[j - 1]) + 1,
+                          diagonal + (a[i - 1] == b[j - 1] ? 0 : 1));
+        diagonal = above;
+      }
+    }
+    assertEquals("diff_editDistance: Long texts.", row[b.length()], dmp.diff_editDistance(a, b));
+    assertEquals("diff_editDistance: Within bound.", row[b.length()], dmp.diff_editDistance(a, b, row[b.length()]));
+    assertEquals("diff_editDistance: Over bound.", -1, dmp.diff_editDistance(a, b, row[b.length()] - 1));
+  }
+
+  // Fail fast on a length difference.
+  assertEquals("diff_editDistance: Length bound.", -1, dmp.diff_editDistance("abc", "abcdefgh", 4));
+
+  // Test null inputs.
+  try {
+    dmp.diff_editDistance(NULL, NULL);
+    assertFalse("diff_editDistance: Null inputs.", true);
+  } catch (const char *ex) {
+    // Exception expected.
+  }
+}
+
 void diff_match_patch_test::testDiffBisect() {
   // Normal.
   QString a = "cat";
@@ -566,6 +917,21 @@ void diff_match_patch_test::testDiffMain() {
   // Java seems to overrun by ~80% (compared with 10% for other languages).
   // Therefore use an upper limit of 0.5s instead of 0.2s.
   assertTrue("diff_main: Timeout max.", dmp.Diff_Timeout * CLOCKS_PER_SEC * 2 > endTime - startTime);
+
+  // Repetitive texts, where every search finds many candidates, time out
+  // too.
+  startTime = clock();
+  dmp.diff_main("d" + QString(160000, 'a') + "b", QString(80000, 'a') + "c");
+  endTime = clock();
+  assertTrue("diff_main: Repetitive timeout max.", dmp.Diff_Timeout * CLOCKS_PER_SEC * 2 > endTime - startTime);
+
+  // Finishing coarsely takes at most a quarter of the timeout more.
+  dmp.Diff_Degrade = true;
+  startTime = clock();
+  dmp.diff_main(a, b);
+  endTime = clock();
+  assertTrue("diff_main: Degrade timeout max.", dmp.Diff_Timeout * CLOCKS_PER_SEC * 2 > endTime - startTime);
+  dmp.Diff_Degrade = false;
   dmp.Diff_Timeout = 0;
 
   // Test the linemode speedup.
@@ -584,6 +950,18 @@ void diff_match_patch_test::testDiffMain() {
   QStringList texts_textmode = diff_rebuildtexts(dmp.diff_main(a, b, false));
   assertEquals("diff_main: Overlap line-mode.", texts_textmode, texts_linemode);
 
+  // Rediffing the replacement blocks on several threads changes nothing.
+  a = "1234567890\nabcdefghij\n";
+  b = "abcdefghij\n1234567890\n";
+  for (int x = 0; x < 6; x++) {
+    a = a + "0987654321\n" + b + a;
+    b = b + "abcdefghij\n" + b + a;
+  }
+  QList<Diff> serial = dmp.diff_main(a, b, true);
+  dmp.Diff_Threads = 4;
+  assertEquals("diff_main: Threaded line-mode.", serial, dmp.diff_main(a, b, true));
+  dmp.Diff_Threads = 1;
+
   // Test null inputs.
   try {
     dmp.diff_main(NULL, NULL);
@@ -593,6 +971,945 @@ void diff_match_patch_test::testDiffMain() {
   }
 }
 
+void diff_match_patch_test::testDiffMainNarrow() {
+  // Latin-1 gives the same diffs as diff_main.
+  assertEquals("diff_mainLatin1: Null case.", diffList(), dmp.diff_mainLatin1("", ""));
+
+  assertEquals("diff_mainLatin1: Equality.", diffList(Diff(EQUAL, "abc")), dmp.diff_mainLatin1("abc", "abc"));
+
+  QList<Diff> diffs = diffList(Diff(EQUAL, "a"), Diff(INSERT, "123"), Diff(EQUAL, "b"), Diff(INSERT, "456"), Diff(EQUAL, "c"));
+  assertEquals("diff_mainLatin1: Two insertions.", diffs, dmp.diff_mainLatin1("abc", "a123b456c"));
+
+  dmp.Diff_Timeout = 0;
+  diffs = diffList(Diff(DELETE, "Apple"), Diff(INSERT, "Banana"), Diff(EQUAL, "s are a"), Diff(INSERT, "lso"), Diff(EQUAL, " fruit."));
+  assertEquals("diff_mainLatin1: Simple case.", diffs, dmp.diff_mainLatin1("Apples are a fruit.", "Bananas are also fruit."));
+
+  diffs = diffList(Diff(DELETE, "ABCD"), Diff(EQUAL, "a"), Diff(DELETE, "="), Diff(INSERT, "-"), Diff(EQUAL, "bcd"), Diff(DELETE, "="), Diff(INSERT, "-"), Diff(EQUAL, "efghijklmnopqrs"), Diff(DELETE, "EFGHIJKLMNOefg"));
+  assertEquals("diff_mainLatin1: Overlap.", diffs, dmp.diff_mainLatin1("ABCDa=bcd=efghijklmnopqrsEFGHIJKLMNOefg", "a-bcd-efghijklmnopqrs"));
+
+  diffs = diffList(Diff(EQUAL, "caf"), Diff(DELETE, "e"), Diff(INSERT, QString(QChar(0x00E9))));
+  assertEquals("diff_mainLatin1: Latin-1.", diffs, dmp.diff_mainLatin1("cafe", "caf\xe9"));
+
+  // With the timeout on, the half-match speedup is used as in diff_main.
+  dmp.Diff_Timeout = 1;
+  QString a;
+  QString b;
+  poemTexts(a, b, 0, false);
+  assertEquals("diff_mainLatin1: Same as diff_main.", dmp.diff_main(a, b, false), dmp.diff_mainLatin1(a.toLatin1(), b.toLatin1()));
+
+  assertEquals("diff_mainLatin1: Half-match.", dmp.diff_main("qHilloHelloHew", "xHelloHeHulloy", false), dmp.diff_mainLatin1("qHilloHelloHew", "xHelloHeHulloy"));
+
+  // UTF-8 never splits a character.
+  const QString e_acute = QString(QChar(0x00E9));
+  const QString e_grave = QString(QChar(0x00E8));
+  diffs = diffList(Diff(EQUAL, "caf"), Diff(DELETE, e_acute), Diff(INSERT, e_grave), Diff(EQUAL, "!"));
+  assertEquals("diff_mainUtf8: Two byte characters.", diffs, dmp.diff_mainUtf8(QString("caf" + e_acute + "!").toUtf8(), QString("caf" + e_grave + "!").toUtf8()));
+
+  const ushort pairs[] = {0xD83D, 0xDE00, 0xD83D, 0xDE01};
+  const QString smile = QString::fromUtf16(pairs, 2);
+  const QString grin = QString::fromUtf16(pairs + 2, 2);
+  // Surrogate pairs are whole in the UTF-8 diff, but diff_cleanupMerge
+  // then splits them exactly as diff_main does.
+  assertEquals("diff_mainUtf8: Four byte characters.", dmp.diff_main(smile + e_acute, grin + e_acute + e_acute, false), dmp.diff_mainUtf8(QString(smile + e_acute).toUtf8(), QString(grin + e_acute + e_acute).toUtf8()));
+
+  a = QString("Apples are a fruit, ") + e_acute + smile + "\n";
+  b = QString("Bananas are also fruit, ") + e_grave + grin + "\n";
+  QStringList texts = diff_rebuildtexts(dmp.diff_mainUtf8(a.toUtf8(), b.toUtf8()));
+  assertEquals("diff_mainUtf8: Round trip text1.", a, texts[0]);
+
+  assertEquals("diff_mainUtf8: Round trip text2.", b, texts[1]);
+
+  assertEquals("diff_mainUtf8: ASCII.", dmp.diff_main(a.left(19), b.left(23), false), dmp.diff_mainUtf8(a.left(19).toUtf8(), b.left(23).toUtf8()));
+}
+
+void diff_match_patch_test::testDiffWordMode() {
+  // Whole words are replaced.
+  dmp.Diff_Timeout = 0;
+  assertEquals("diff_wordMode: Null case.", diffList(), dmp.diff_wordMode("", ""));
+
+  assertEquals("diff_wordMode: Equality.", diffList(Diff(EQUAL, "abc def")), dmp.diff_wordMode("abc def", "abc def"));
+
+  QList<Diff> diffs = diffList(Diff(DELETE, "Apples"), Diff(INSERT, "Bananas"), Diff(EQUAL, " are a"), Diff(INSERT, "lso"), Diff(EQUAL, " fruit."));
+  assertEquals("diff_wordMode: Simple case.", diffs, dmp.diff_wordMode("Apples are a fruit.", "Bananas are also fruit."));
+
+  diffs = diffList(Diff(EQUAL, "The "), Diff(INSERT, "quick "), Diff(EQUAL, "fox, the dog"), Diff(DELETE, "."), Diff(INSERT, "!"));
+  assertEquals("diff_wordMode: Insertion and punctuation.", diffs, dmp.diff_wordMode("The fox, the dog.", "The quick fox, the dog!"));
+
+  // Refinement rediffs the replaced words character-by-character.
+  diffs = diffList(Diff(DELETE, "Apple"), Diff(INSERT, "Banana"), Diff(EQUAL, "s are a"), Diff(INSERT, "lso"), Diff(EQUAL, " fruit."));
+  assertEquals("diff_wordMode: Refined.", diffs, dmp.diff_wordMode("Apples are a fruit.", "Bananas are also fruit.", true));
+
+  // Round trip on a larger text.
+  QString a;
+  QString b;
+  poemTexts(a, b, 3, false);
+  QStringList texts = diff_rebuildtexts(dmp.diff_wordMode(a, b));
+  assertEquals("diff_wordMode: Round trip.", (QStringList() << a << b), texts);
+
+  texts = diff_rebuildtexts(dmp.diff_wordMode(a, b, true));
+  assertEquals("diff_wordMode: Refined round trip.", (QStringList() << a << b), texts);
+  dmp.Diff_Timeout = 1;
+}
+
+void diff_match_patch_test::testDiffHierarchical() {
+  // Paragraphs end with their run of blank lines.
+  QStringList tmpVector;
+  QList<QVariant> tmpVarList;
+  tmpVector.append("");
+  tmpVector.append("a\nb\n\n");
+  tmpVector.append("c\n\n\n");
+  tmpVector.append("d");
+  tmpVarList << QVariant::fromValue(QString() + QChar((ushort)1) + QChar((ushort)2) + QChar((ushort)3));  // (("\u0001\u0002\u0003"));
+  tmpVarList << QVariant::fromValue(QString() + QChar((ushort)2) + QChar((ushort)1));  // (("\u0002\u0001"));
+  tmpVarList << QVariant::fromValue(tmpVector);
+  assertEquals("diff_tokensToChars: Paragraphs.", tmpVarList, dmp.diff_tokensToChars("a\nb\n\nc\n\n\nd", "c\n\n\na\nb\n\n", PARAGRAPHS));
+
+  dmp.Diff_Timeout = 0;
+  QList<Granularity> levels;
+  assertEquals("diff_hierarchical: Null case.", diffList(), dmp.diff_hierarchical("", "", levels << PARAGRAPHS << LINES << WORDS << CHARACTERS));
+
+  levels.clear();
+  assertEquals("diff_hierarchical: Characters.", dmp.diff_main("Apples are a fruit.", "Bananas are also fruit.", false), dmp.diff_hierarchical("Apples are a fruit.", "Bananas are also fruit.", levels << CHARACTERS));
+
+  levels.clear();
+  assertEquals("diff_hierarchical: Words.", dmp.diff_wordMode("Apples are a fruit.", "Bananas are also fruit."), dmp.diff_hierarchical("Apples are a fruit.", "Bananas are also fruit.", levels << WORDS));
+
+  levels << CHARACTERS;
+  assertEquals("diff_hierarchical: Words and characters.", dmp.diff_wordMode("Apples are a fruit.", "Bananas are also fruit.", true), dmp.diff_hierarchical("Apples are a fruit.", "Bananas are also fruit.", levels));
+
+  // Only the changed paragraph and line are refined.
+  QString a = "First paragraph.\n\nThe cat sat\non the mat.\n\nLast paragraph.\n";
+  QString b = "First paragraph.\n\nThe cat sat\non the hat.\n\nLast paragraph.\n";
+  QList<Diff> diffs = diffList(Diff(EQUAL, "First paragraph.\n\nThe cat sat\non the "), Diff(DELETE, "m"), Diff(INSERT, "h"), Diff(EQUAL, "at.\n\nLast paragraph.\n"));
+  levels.clear();
+  assertEquals("diff_hierarchical: Localised edit.", diffs, dmp.diff_hierarchical(a, b, levels << PARAGRAPHS << LINES << WORDS << CHARACTERS));
+
+  // Threads give the same result.
+  poemTexts(a, b, 3, true);
+  QList<Diff> serial = dmp.diff_hierarchical(a, b, levels);
+  assertEquals("diff_hierarchical: Round trip.", (QStringList() << a << b), diff_rebuildtexts(serial));
+
+  dmp.Diff_Threads = 4;
+  assertEquals("diff_hierarchical: Threads.", serial, dmp.diff_hierarchical(a, b, levels));
+  dmp.Diff_Threads = 1;
+
+  // Lines past the last hash become one token rather than wrapping around.
+  a = "";
+  for (int x = 0; x < 70000; x++) {
+    a += QString::number(x) + "\n";
+  }
+  b = "start\n" + a;
+  levels.clear();
+  diffs = dmp.diff_hierarchical(a, b, levels << LINES);
+  assertEquals("diff_hierarchical: More than 65535 lines.", (QStringList() << a << b), diff_rebuildtexts(diffs));
+  dmp.Diff_Timeout = 1;
+
+  // Test null inputs.
+  try {
+    dmp.diff_hierarchical(NULL, NULL, levels);
+    assertFalse("diff_hierarchical: Null inputs.", true);
+  } catch (const char* ex) {
+    // Exception expected.
+  }
+}
+
+void diff_match_patch_test::testDiffMoves() {
+  // Find blocks which moved.
+  assertEquals("DiffMove:", QString("DiffMove(1,2,3)"), DiffMove(1, 2, 3).toString());
+
+  QList<DiffMove> moves;
+  QString a = "The quick brown fox\n";
+  QString b = "jumps over the lazy dog\n";
+  QString c = "Lorem ipsum dolor sit\n";
+  dmp.Diff_Timeout = 0;
+  assertEquals("diff_moves: Disabled.", dmp.diff_main(a + b + c, c + a + b), dmp.diff_moves(a + b + c, c + a + b, moves));
+
+  assertTrue("diff_moves: Disabled moves.", moves.isEmpty());
+
+  dmp.Diff_MoveBlockSize = 8;
+  QList<Diff> diffs = diffList(Diff(INSERT, c), Diff(EQUAL, a + b), Diff(DELETE, c));
+  assertEquals("diff_moves: Moved block.", diffs, dmp.diff_moves(a + b + c, c + a + b, moves));
+
+  assertEquals("diff_moves: Moved block moves.", QString("DiffMove(44,0,22)"), moves.size() == 1 ? moves[0].toString() : QString());
+
+  // A block copied from text kept in place is not a move.
+  diffs = diffList(Diff(EQUAL, a + b), Diff(INSERT, a));
+  assertEquals("diff_moves: Copied block.", diffs, dmp.diff_moves(a + b, a + b + a, moves));
+
+  assertTrue("diff_moves: Copied block moves.", moves.isEmpty());
+
+  // Short blocks are diffed as usual.
+  assertEquals("diff_moves: Short text.", dmp.diff_main("abc", "cab"), dmp.diff_moves("abc", "cab", moves));
+
+  // diff_main uses the same pre-pass.
+  assertEquals("diff_main: Moved block.", dmp.diff_moves(a + b + c, c + a + b, moves), dmp.diff_main(a + b + c, c + a + b));
+
+  // Round trip with sections swapped around.
+  QString text1;
+  QString text2;
+  for (int x = 0; x < 40; x++) {
+    text1 += QString::number(x) + ": " + a + b;
+  }
+  for (int x = 39; x >= 0; x -= 2) {
+    text2 += QString::number(x) + ": " + a + c;
+  }
+  for (int x = 0; x < 40; x += 2) {
+    text2 += QString::number(x) + ": " + b;
+  }
+  QStringList texts = diff_rebuildtexts(dmp.diff_moves(text1, text2, moves));
+  assertEquals("diff_moves: Round trip.", (QStringList() << text1 << text2), texts);
+
+  dmp.Diff_MoveBlockSize = 0;
+  dmp.Diff_Timeout = 1;
+
+  // Test null inputs.
+  try {
+    dmp.diff_moves(NULL, NULL, moves);
+    assertFalse("diff_moves: Null inputs.", true);
+  } catch (const char* ex) {
+    // Exception expected.
+  }
+}
+
+void diff_match_patch_test::testDiffAnchorMode() {
+  // Split line-mode diffs on the lines unique to both texts.
+  dmp.Diff_Timeout = 0;
+  dmp.Diff_AnchorLines = 2;
+  const QString u1 = "int main(int argc, char **argv) {\n";
+  const QString u2 = "  QCoreApplication app(argc, argv);\n";
+  const QString u3 = "  return app.exec();\n";
+  const QString u4 = "}\n";
+  QList<Diff> diffs = diffList(Diff(EQUAL, u1 + u2));
+  diffs << dmp.diff_main(u3, "  return 0;\n", false);
+  diffs << Diff(EQUAL, u4);
+  dmp.diff_cleanupMerge(diffs);
+  assertEquals("diff_main: Anchored line-mode.", diffs, dmp.diff_main(u1 + u2 + u3 + u4, u1 + u2 + "  return 0;\n" + u4, true));
+
+  // Anchors are unique in both texts and in the same order.
+  const QString blank = "\n";
+  QString a = u1 + blank + u2 + blank + u3 + blank + u4;
+  QString b = u4 + blank + u2 + blank + blank + u1 + u3;
+  QStringList texts = diff_rebuildtexts(dmp.diff_main(a, b, true));
+  assertEquals("diff_main: Anchored line-mode round trip.", (QStringList() << a << b), texts);
+
+  // Gaps diffed on several threads give the same result.
+  a = "";
+  b = "";
+  for (int x = 0; x < 200; x++) {
+    a += QString::number(x) + ": " + u2 + (x % 7 == 0 ? u3 : blank);
+    b += QString::number(x) + ": " + (x % 5 == 0 ? u3 : u2) + blank;
+  }
+  QList<Diff> serial = dmp.diff_main(a, b, true);
+  texts = diff_rebuildtexts(serial);
+  assertEquals("diff_main: Anchored line-mode gaps.", (QStringList() << a << b), texts);
+
+  dmp.Diff_Threads = 4;
+  assertEquals("diff_main: Threaded anchored line-mode.", serial, dmp.diff_main(a, b, true));
+
+  // Too few lines to anchor on.
+  dmp.Diff_Threads = 1;
+  dmp.Diff_AnchorLines = 0;
+  diffs = dmp.diff_main(a, b, true);
+  dmp.Diff_AnchorLines = 1000;
+  assertEquals("diff_main: Unanchored line-mode.", diffs, dmp.diff_main(a, b, true));
+  dmp.Diff_AnchorLines = 0;
+  dmp.Diff_Timeout = 1;
+}
+
+void diff_match_patch_test::testDiffDocument() {
+  // Diff many revisions against one prepared base.
+  const QString text1 = "alpha\nbeta\ngamma\ndelta\n";
+  const DiffDocument base(text1);
+  assertEquals("DiffDocument:", text1, base.text());
+
+  assertEquals("diff_main: Document equality.", diffList(Diff(EQUAL, text1)), dmp.diff_main(base, text1));
+
+  QList<Diff> diffs = diffList(Diff(EQUAL, "alpha\n"), Diff(DELETE, "b"), Diff(INSERT, "z"), Diff(EQUAL, "eta\ngamma\ndelta\n"));
+  assertEquals("diff_main: Document changed line.", diffs, dmp.diff_main(base, "alpha\nzeta\ngamma\ndelta\n"));
+
+  diffs = diffList(Diff(INSERT, "omega\n"), Diff(EQUAL, "alpha\nbeta\n"), Diff(DELETE, "gamma\n"), Diff(EQUAL, "delta\n"), Diff(INSERT, "epsilon"));
+  assertEquals("diff_main: Document new lines.", diffs, dmp.diff_main(base, "omega\nalpha\nbeta\ndelta\nepsilon"));
+
+  assertEquals("diff_main: Document empty revision.", diffList(Diff(DELETE, text1)), dmp.diff_main(base, ""));
+
+  assertEquals("diff_main: Empty document.", diffList(Diff(INSERT, text1)), dmp.diff_main(DiffDocument(""), text1));
+
+  // Round trip on a larger text.
+  QString a;
+  QString b;
+  poemTexts(a, b, 3, false);
+  const DiffDocument bigBase(a);
+  QStringList texts = diff_rebuildtexts(dmp.diff_main(bigBase, b));
+  assertEquals("diff_main: Document round trip.", (QStringList() << a << b), texts);
+
+  QList<Patch> patches = dmp.patch_make(bigBase, b);
+  assertEquals("patch_make: Document.", dmp.patch_toText(dmp.patch_make(a, dmp.diff_main(bigBase, b))), dmp.patch_toText(patches));
+
+  QPair<QString, QVector<bool> > results = dmp.patch_apply(patches, a);
+  assertEquals("patch_make: Document applies.", b, results.first);
+
+  // The cache applies as it does to diff_main, under its own key.
+  DiffCache cache;
+  dmp.Diff_Cache = &cache;
+  diffs = dmp.diff_main(bigBase, b);
+  assertEquals("diff_main: Document cache hit.", diffs, dmp.diff_main(bigBase, b));
+  assertEquals("diff_main: Document cache hits.", 1, (int)cache.hits());
+  dmp.diff_main(a, b);
+  assertEquals("diff_main: Document cache key.", 2, cache.size());
+  dmp.Diff_Cache = NULL;
+
+  // The work budget limits the line diff too.
+  b = QString(a).replace("brillig", "brilliant").replace("general", "admiral");
+  const int unlimited = dmp.diff_main(bigBase, b).size();
+  dmp.Diff_WorkBudget = 10;
+  diffs = dmp.diff_main(bigBase, b);
+  assertEquals("diff_main: Document budget round trip.", (QStringList() << a << b), diff_rebuildtexts(diffs));
+  assertTrue("diff_main: Document budget.", diffs.size() < unlimited);
+  dmp.Diff_WorkBudget = 0;
+
+  // Test null inputs.
+  try {
+    dmp.diff_main(base, NULL);
+    assertFalse("diff_main: Document null inputs.", true);
+  } catch (const char* ex) {
+    // Exception expected.
+  }
+}
+
+void diff_match_patch_test::testDiffCache() {
+  // Cache diff results by content.
+  DiffCache cache;
+  dmp.Diff_Cache = &cache;
+  const QString text1 = "The quick brown fox.";
+  const QString text2 = "The slow brown dog.";
+  QList<Diff> diffs = dmp.diff_main(text1, text2);
+  assertEquals("diff_main: Cache miss.", 1, (int)cache.misses());
+  assertEquals("diff_main: Cache miss hits.", 0, (int)cache.hits());
+  assertEquals("diff_main: Cache size.", 1, cache.size());
+  assertTrue("diff_main: Cache bytes.", cache.totalBytes() > 0);
+
+  assertEquals("diff_main: Cache hit.", diffs, dmp.diff_main(text1, text2));
+  assertEquals("diff_main: Cache hit hits.", 1, (int)cache.hits());
+
+  // Equal contents in a different string are still a hit.
+  assertEquals("diff_main: Cache hit by content.", diffs, dmp.diff_main(QString(text1).append(""), QString("The slow brown ") + "dog."));
+  assertEquals("diff_main: Cache hit by content hits.", 2, (int)cache.hits());
+
+  // The inputs are not interchangeable.
+  dmp.diff_main(text2, text1);
+  assertEquals("diff_main: Cache swapped.", 2, (int)cache.misses());
+
+  // Settings which change the result are part of the key.
+  dmp.diff_main(text1, text2, false);
+  assertEquals("diff_main: Cache checklines.", 3, (int)cache.misses());
+  dmp.Diff_Timeout = 2.0f;
+  dmp.diff_main(text1, text2);
+  assertEquals("diff_main: Cache timeout.", 4, (int)cache.misses());
+  dmp.Diff_Timeout = 1.0f;
+  dmp.Diff_EditCost = 5;
+  dmp.diff_main(text1, text2);
+  assertEquals("diff_main: Cache edit cost.", 5, (int)cache.misses());
+  dmp.Diff_EditCost = 4;
+  dmp.diff_main(text1, text2);
+  assertEquals("diff_main: Cache settings restored.", 3, (int)cache.hits());
+
+  // A cache shared between instances.
+  diff_match_patch dmp2;
+  dmp2.Diff_Cache = &cache;
+  assertEquals("diff_main: Cache shared.", diffs, dmp2.diff_main(text1, text2));
+  assertEquals("diff_main: Cache shared hits.", 4, (int)cache.hits());
+
+  // Patches are made from cached diffs.
+  diff_match_patch dmp3;
+  assertEquals("patch_make: Cache.", dmp3.patch_toText(dmp3.patch_make(text1, text2)), dmp.patch_toText(dmp.patch_make(text1, text2)));
+  assertEquals("patch_make: Cache hits.", 5, (int)cache.hits());
+
+  // Least recently used results are evicted over the memory cap.
+  assertEquals("DiffCache: Evictions.", 0, (int)cache.evictions());
+  cache.setMaxBytes(cache.totalBytes() - 1);
+  assertEquals("DiffCache: Shrink evicts.", 1, (int)cache.evictions());
+  const int maxBytes = cache.totalBytes();
+  cache.setMaxBytes(maxBytes);
+  dmp.diff_main("abc", "abd");
+  assertTrue("DiffCache: Insert evicts.", cache.evictions() > 1);
+  assertTrue("DiffCache: Under cap.", cache.totalBytes() <= maxBytes);
+
+  // Clearing keeps the counters.
+  const int hits = cache.hits();
+  cache.clear();
+  assertEquals("DiffCache: Clear size.", 0, cache.size());
+  assertEquals("DiffCache: Clear bytes.", 0, cache.totalBytes());
+  assertEquals("DiffCache: Clear hits.", hits, (int)cache.hits());
+  dmp.diff_main(text1, text2);
+  assertEquals("DiffCache: Miss after clear.", hits, (int)cache.hits());
+
+  // A diff which runs out of work isn't kept.
+  dmp.Diff_WorkBudget = 1;
+  cache.clear();
+  dmp.diff_main("Apples are a fruit.", "Bananas are also fruit.");
+  assertEquals("DiffCache: Expired not cached.", 0, cache.size());
+  dmp.Diff_WorkBudget = 0;
+
+  // Test null inputs.
+  try {
+    dmp.diff_main(NULL, NULL);
+    assertFalse("diff_main: Cache null inputs.", true);
+  } catch (const char* ex) {
+    // Exception expected.
+  }
+  dmp.Diff_Cache = NULL;
+}
+
+/**
+* Diff two texts on a pool thread with an engine shared between jobs.
+*/
+class SharedEngineJob : public QRunnable {
+ public:
+  SharedEngineJob(const diff_match_patch &_engine, const QString &_text1,
+                  const QString &_text2) :
+    engine(_engine), text1(_text1), text2(_text2) {
+    setAutoDelete(false);
+  }
+
+  void run() {
+    diffs = engine.diff_main(text1, text2);
+    engine.diff_cleanupSemantic(diffs);
+  }
+
+  const diff_match_patch &engine;
+  QString text1;
+  QString text2;
+  QList<Diff> diffs;
+};
+
+void diff_match_patch_test::testDiffOptions() {
+  // Configure an engine once and share it.
+  DiffOptions options;
+  assertEquals("DiffOptions: Default timeout.", 1, (int)options.Diff_Timeout);
+  assertEquals("DiffOptions: Default edit cost.", 4, options.Diff_EditCost);
+  options.Diff_Timeout = 0;
+  options.Diff_EditCost = 5;
+  const diff_match_patch engine(options);
+  assertEquals("diff_match_patch: Options timeout.", 0, (int)engine.Diff_Timeout);
+  assertEquals("diff_match_patch: Options edit cost.", 5, engine.options().Diff_EditCost);
+  assertEquals("diff_match_patch: Options match distance.", 1000, engine.Match_Distance);
+
+  // Copying the options of an instance.
+  const DiffOptions copied = engine.options();
+  assertEquals("diff_match_patch: Copied options.", 5, diff_match_patch(copied).Diff_EditCost);
+
+  // Every method can be called on a const engine.
+  QList<Diff> diffs = diffList(Diff(EQUAL, "AAA\r\n\r\nBBB"), Diff(INSERT, "\r\nDDD\r\n\r\nBBB"), Diff(EQUAL, "\r\nEEE"));
+  engine.diff_cleanupSemanticLossless(diffs);
+  assertEquals("diff_cleanupSemanticLossless: Const blank lines.", diffList(Diff(EQUAL, "AAA\r\n\r\n"), Diff(INSERT, "BBB\r\nDDD\r\n\r\n"), Diff(EQUAL, "BBB\r\nEEE")), diffs);
+  diffs = diffList(Diff(EQUAL, "AAA\n\n"), Diff(INSERT, "BBB\nDDD\n\n"), Diff(EQUAL, "BBB\nEEE"));
+  engine.diff_cleanupSemanticLossless(diffs);
+  assertEquals("diff_cleanupSemanticLossless: Const blank lines LF.", diffList(Diff(EQUAL, "AAA\n\n"), Diff(INSERT, "BBB\nDDD\n\n"), Diff(EQUAL, "BBB\nEEE")), diffs);
+  QList<Patch> patches = engine.patch_make("The quick brown fox.", "The slow brown dog.");
+  assertEquals("patch_apply: Const engine.", "The slow brown dog.", engine.patch_apply(patches, "The quick brown fox.").first);
+
+  // Concurrent calls on one engine match serial calls.
+  QString a;
+  QString b;
+  poemTexts(a, b, 3, true);
+  QList<SharedEngineJob *> jobs;
+  QThreadPool pool;
+  pool.setMaxThreadCount(4);
+  for (int x = 0; x < 8; x++) {
+    jobs.append(new SharedEngineJob(engine, a.mid(x * 100), b.mid(x * 50)));
+    pool.start(jobs.last());
+  }
+  pool.waitForDone();
+  for (int x = 0; x < jobs.size(); x++) {
+    QList<Diff> serial = engine.diff_main(jobs[x]->text1, jobs[x]->text2);
+    engine.diff_cleanupSemantic(serial);
+    assertEquals("diff_main: Shared engine.", serial, jobs[x]->diffs);
+    delete jobs[x];
+  }
+}
+
+void diff_match_patch_test::testDiffMany() {
+  // Diff a batch of text pairs.
+  typedef QPair<QString, QString> TextPair;
+  QList<TextPair> pairs;
+  assertEquals("diff_many: Empty batch.", 0, dmp.diff_many(pairs).size());
+  assertEquals("patch_make_many: Empty batch.", 0, dmp.patch_make_many(pairs).size());
+
+  pairs.append(TextPair("The quick brown fox.", "The slow brown dog."));
+  pairs.append(TextPair("", ""));
+  pairs.append(TextPair("abc", ""));
+  pairs.append(TextPair("1ayb2", "abxab"));
+  QString a;
+  QString b;
+  poemTexts(a, b, 3, false);
+  pairs.append(TextPair(a, b));
+  for (int x = 0; x < 20; x++) {
+    pairs.append(TextPair(a.mid(x * 37, 500), b.mid(x * 53, 400)));
+  }
+
+  for (int threads = 1; threads <= 4; threads += 3) {
+    dmp.Diff_Threads = threads;
+    QList<QList<Diff> > diffs = dmp.diff_many(pairs);
+    QList<QList<Patch> > patches = dmp.patch_make_many(pairs);
+    assertEquals("diff_many: Size.", pairs.size(), diffs.size());
+    assertEquals("patch_make_many: Size.", pairs.size(), patches.size());
+    for (int x = 0; x < pairs.size(); x++) {
+      assertEquals("diff_many: Result " + QString::number(x) + ".", dmp.diff_main(pairs[x].first, pairs[x].second), diffs[x]);
+      assertEquals("patch_make_many: Result " + QString::number(x) + ".", dmp.patch_toText(dmp.patch_make(pairs[x].first, pairs[x].second)), dmp.patch_toText(patches[x]));
+    }
+    diffs = dmp.diff_many(pairs, false);
+    for (int x = 0; x < pairs.size(); x++) {
+      assertEquals("diff_many: No checklines " + QString::number(x) + ".", dmp.diff_main(pairs[x].first, pairs[x].second, false), diffs[x]);
+    }
+  }
+  dmp.Diff_Threads = 1;
+
+  // Test null inputs.
+  pairs.append(TextPair(NULL, "abc"));
+  try {
+    dmp.diff_many(pairs);
+    assertFalse("diff_many: Null inputs.", true);
+  } catch (const char* ex) {
+    // Exception expected.
+  }
+  try {
+    dmp.patch_make_many(pairs);
+    assertFalse("patch_make_many: Null inputs.", true);
+  } catch (const char* ex) {
+    // Exception expected.
+  }
+}
+
+/**
+* Record the progress reports of a diff, cancelling it after a given
+* number of reports if asked to.
+*/
+class RecordingProgress : public DiffProgress {
+ public:
+  RecordingProgress(DiffCancelToken *_token, int _limit) :
+    token(_token), limit(_limit) {
+  }
+
+  void reportProgress(const char *stage, int done, int total) {
+    stages.append(stage);
+    if (done > total) {
+      stages.append("Out of range");
+    }
+    if (token != NULL && stages.size() >= limit) {
+      token->cancel();
+    }
+  }
+
+  DiffCancelToken *token;
+  int limit;
+  QStringList stages;
+};
+
+/**
+* Diff a pair of texts of its own from every progress report.
+*/
+class DiffingProgress : public DiffProgress {
+ public:
+  DiffingProgress(const QString &_text1, const QString &_text2) :
+    text1(_text1), text2(_text2) {
+  }
+
+  void reportProgress(const char *, int, int) {
+    dmp.diff_main(text1, text2);
+  }
+
+  diff_match_patch dmp;
+  QString text1;
+  QString text2;
+};
+
+void diff_match_patch_test::testDiffCancel() {
+  // Stop diffs and patches part way through.
+  DiffCancelToken token;
+  assertFalse("DiffCancelToken: Initial.", token.isCancelled());
+  token.cancel();
+  assertTrue("DiffCancelToken: Cancelled.", token.isCancelled());
+  token.reset();
+  assertFalse("DiffCancelToken: Reset.", token.isCancelled());
+
+  QString a;
+  QString b;
+  poemTexts(a, b, 3, false);
+  b = QString(a).replace("brillig", "brilliant").replace("general", "admiral");
+
+  // Progress is reported by each stage.
+  RecordingProgress progress(NULL, 0);
+  dmp.Diff_Progress = &progress;
+  const QList<Diff> diffs = dmp.diff_main(a, b);
+  assertTrue("diff_main: Progress bisect.", progress.stages.contains("diff_bisect"));
+  assertTrue("diff_main: Progress refine.", progress.stages.contains("diff_refine"));
+  assertFalse("diff_main: Progress range.", progress.stages.contains("Out of range"));
+  const int reports = progress.stages.size();
+  progress.stages.clear();
+  QList<Patch> patches = dmp.patch_make(a, diffs);
+  assertEquals("patch_apply: Progress.", b, dmp.patch_apply(patches, a).first);
+  assertEquals("patch_apply: Progress count.", patches.size(), progress.stages.count("patch_apply"));
+  dmp.Diff_Progress = NULL;
+
+  // A diff made from a progress report leaves the outer diff intact.
+  const QString text1 = "cbdddcdacbdaabdbdbcccdddcdbcaabccddcbbaaabddcbdccbaadcccdbbdddccda";
+  const QString text2 = "bccccaccabbcdcbaaddbababbadbcdabcdcbcdcbccdabcbcacabaccbbcddcbbccaa";
+  DiffingProgress differ("aadabdbbcdabdbdddbbabbbbddbccdccaaccbddbaaddcaabddbadcdbabbdbcbadccbdadab",
+                         "ccdcaacddacbcaadaddbacdcaabcdbddaaaddaccdadbbcccdabdbccbadbbdccbcdaabcbdb");
+  const QList<Diff> unreported = dmp.diff_main(text1, text2);
+  dmp.Diff_Progress = &differ;
+  assertEquals("diff_main: Progress nested.", unreported, dmp.diff_main(text1, text2));
+  dmp.Diff_Progress = NULL;
+
+  // A cancelled diff stops at once with a valid result.
+  dmp.Diff_Cancel = &token;
+  token.cancel();
+  assertEquals("diff_main: Cancelled.", diffList(Diff(DELETE, "cat"), Diff(INSERT, "map")), dmp.diff_main("cat", "map"));
+  QStringList texts = diff_rebuildtexts(dmp.diff_main(a, b));
+  assertEquals("diff_main: Cancelled line-mode.", (QStringList() << a << b), texts);
+  QPair<QString, QVector<bool> > results = dmp.patch_apply(patches, a);
+  assertEquals("patch_apply: Cancelled.", a, results.first);
+  assertFalse("patch_apply: Cancelled results.", results.second.contains(true));
+
+  // Cancelled results are not cached.
+  DiffCache cache;
+  dmp.Diff_Cache = &cache;
+  dmp.diff_main("cat", "map");
+  assertEquals("diff_main: Cancelled not cached.", 0, cache.size());
+  token.reset();
+  assertEquals("diff_main: Reset.", diffList(Diff(DELETE, "c"), Diff(INSERT, "m"), Diff(EQUAL, "a"), Diff(DELETE, "t"), Diff(INSERT, "p")), dmp.diff_main("cat", "map"));
+  assertEquals("diff_main: Reset cached.", 1, cache.size());
+  dmp.Diff_Cache = NULL;
+
+  // Cancel from a progress report part way through the diff.
+  RecordingProgress canceller(&token, 3);
+  dmp.Diff_Progress = &canceller;
+  texts = diff_rebuildtexts(dmp.diff_main(a, b));
+  assertEquals("diff_main: Cancelled by progress.", (QStringList() << a << b), texts);
+  assertEquals("diff_main: Cancelled by progress stops.", 3, canceller.stages.size());
+  assertTrue("diff_main: Cancelled by progress early.", canceller.stages.size() < reports);
+  dmp.Diff_Progress = NULL;
+  dmp.Diff_Cancel = NULL;
+}
+
+void diff_match_patch_test::testDiffWorkBudget() {
+  // Bound diffs by work rather than time.
+  dmp.Diff_Timeout = 0;
+  dmp.Diff_WorkBudget = 1;
+  assertEquals("diff_main: Work budget exhausted.", diffList(Diff(DELETE, "cat"), Diff(INSERT, "map")), dmp.diff_main("cat", "map"));
+  dmp.Diff_WorkBudget = 1000;
+  assertEquals("diff_main: Work budget.", diffList(Diff(DELETE, "c"), Diff(INSERT, "m"), Diff(EQUAL, "a"), Diff(DELETE, "t"), Diff(INSERT, "p")), dmp.diff_main("cat", "map"));
+
+  // The half-match speedup is allowed under a budget.
+  assertEquals("diff_halfMatch: Work budget.", QString("12,90,a,z,345678").split(","), dmp.diff_halfMatch("1234567890", "a345678z"));
+  qint64 budget = 0;
+  assertEmpty("diff_halfMatch: Work budget exhausted.", dmp.diff_halfMatch("1234567890", "a345678z", DiffDeadline(std::numeric_limits<clock_t>::max(), &budget)));
+  budget = 100;
+  dmp.diff_halfMatch("1234567890", "a345678z", DiffDeadline(std::numeric_limits<clock_t>::max(), &budget));
+  assertTrue("diff_halfMatch: Work charged.", budget < 100);
+
+  // Work is charged by diff_bisect.
+  budget = 1000;
+  dmp.diff_bisect("cat", "map", DiffDeadline(std::numeric_limits<clock_t>::max(), &budget));
+  assertTrue("diff_bisect: Work charged.", budget < 1000);
+
+  // The same budget gives the same diff, threaded or not.
+  QString a;
+  QString b;
+  poemTexts(a, b, 3, false);
+  b = QString(b).replace("the", "a").replace("mineral", "vegetable");
+  dmp.Diff_WorkBudget = 5000;
+  const QList<Diff> diffs = dmp.diff_main(a, b);
+  QStringList texts = diff_rebuildtexts(diffs);
+  assertEquals("diff_main: Work budget round trip.", (QStringList() << a << b), texts);
+  assertEquals("diff_main: Work budget repeatable.", diffs, dmp.diff_main(a, b));
+  dmp.Diff_Threads = 4;
+  assertEquals("diff_main: Work budget threaded.", diffs, dmp.diff_main(a, b));
+  dmp.Diff_Threads = 1;
+  dmp.Diff_WorkBudget = 0;
+  const QList<Diff> unbounded = dmp.diff_main(a, b);
+  assertTrue("diff_main: Work budget coarser.", dmp.diff_levenshtein(diffs) > dmp.diff_levenshtein(unbounded));
+
+  // The budget is part of the cache key.
+  DiffCache cache;
+  dmp.Diff_Cache = &cache;
+  dmp.diff_main("cat", "map");
+  dmp.Diff_WorkBudget = 1;
+  assertEquals("diff_main: Work budget cached.", diffList(Diff(DELETE, "cat"), Diff(INSERT, "map")), dmp.diff_main("cat", "map"));
+  assertEquals("diff_main: Work budget cache misses.", 2, (int)cache.misses());
+  dmp.Diff_Cache = NULL;
+  dmp.Diff_WorkBudget = 0;
+  dmp.Diff_Timeout = 1.0f;
+}
+
+void diff_match_patch_test::testDiffDegrade() {
+  // Keep the progress of a diff which runs out of work.
+  const QString a = "The quick brown fox jumps over the lazy dog.  Pack my box with five dozen liquor jugs.";
+  const QString b = "The quick red fox jumps over the lazy cat.  Pack my bag with six dozen liquor jugs!";
+  qint64 budget = 40;
+  QList<Diff> coarse = dmp.diff_bisect(a, b, DiffDeadline(std::numeric_limits<clock_t>::max(), &budget));
+  assertEquals("diff_bisect: Out of work.", diffList(Diff(DELETE, a), Diff(INSERT, b)), coarse);
+
+  dmp.Diff_Degrade = true;
+  budget = 40;
+  QList<Diff> diffs = dmp.diff_bisect(a, b, DiffDeadline(std::numeric_limits<clock_t>::max(), &budget));
+  assertEquals("diff_bisect: Degrade round trip.", (QStringList() << a << b), diff_rebuildtexts(diffs));
+  assertTrue("diff_bisect: Degrade keeps progress.", dmp.diff_levenshtein(diffs) < dmp.diff_levenshtein(coarse));
+  assertEquals("diff_bisect: Degrade prefix.", Diff(EQUAL, "The quick "), diffs[0]);
+
+  // With no progress to keep, the diff is tried again under a budget.
+  assertEquals("diff_bisect: Degrade timeout.", diffList(Diff(DELETE, "c"), Diff(INSERT, "m"), Diff(EQUAL, "a"), Diff(DELETE, "t"), Diff(INSERT, "p")), dmp.diff_bisect("cat", "map", 0));
+
+  // A cancelled diff is not degraded.
+  DiffCancelToken token;
+  token.cancel();
+  dmp.Diff_Cancel = &token;
+  budget = 40;
+  assertEquals("diff_bisect: Degrade cancelled.", coarse, dmp.diff_bisect(a, b, DiffDeadline(std::numeric_limits<clock_t>::max(), &budget)));
+  dmp.Diff_Cancel = NULL;
+
+  // Long texts fall back to lines.
+  QString c = "";
+  QString d = "";
+  for (int x = 0; x < 200; x++) {
+    c += QString("Line %1 of the old text\n").arg(x);
+    d += (x % 7 == 3 ? QString("Changed line %1\n") : QString("Line %1 of the old text\n")).arg(x);
+  }
+  dmp.Diff_Timeout = 0;
+  dmp.Diff_WorkBudget = 100;
+  diffs = dmp.diff_main(c, d, false);
+  assertEquals("diff_main: Degrade round trip.", (QStringList() << c << d), diff_rebuildtexts(diffs));
+  dmp.Diff_Degrade = false;
+  coarse = dmp.diff_main(c, d, false);
+  assertTrue("diff_main: Degrade smaller.", dmp.diff_levenshtein(diffs) * 4 < dmp.diff_levenshtein(coarse));
+  dmp.Diff_WorkBudget = 0;
+  dmp.Diff_Timeout = 1.0f;
+}
+
+void diff_match_patch_test::testDiffBounded() {
+  // Diff texts which differ by only a few edits.
+  QString a = "";
+  for (int x = 0; x < 2000; x++) {
+    a += QString("Line %1.").arg(x);
+  }
+  QString b = QString(a).replace("Line 700.", "Line 7OO.").replace("Line 1500.", "Lines 1500.");
+  QList<Diff> diffs;
+  dmp.Diff_Timeout = 0;
+  assertTrue("diff_bounded: Within bound.", dmp.diff_bounded(a, b, 8, diffs));
+  assertEquals("diff_bounded: Minimal.", dmp.diff_main(a, b, false), diffs);
+  assertEquals("diff_bounded: Round trip.", (QStringList() << a << b), diff_rebuildtexts(diffs));
+  dmp.Diff_Timeout = 1.0f;
+
+  assertTrue("diff_bounded: Exact bound.", dmp.diff_bounded(a, b, 5, diffs));
+  assertFalse("diff_bounded: Exceeded.", dmp.diff_bounded(a, b, 4, diffs));
+  assertTrue("diff_bounded: Exceeded clears.", diffs.isEmpty());
+
+  // Texts of very different lengths fail fast.
+  assertFalse("diff_bounded: Length difference.", dmp.diff_bounded(a, a.left(100), 50, diffs));
+
+  assertTrue("diff_bounded: Equality.", dmp.diff_bounded("abc", "abc", 0, diffs));
+  assertEquals("diff_bounded: Equality diffs.", diffList(Diff(EQUAL, "abc")), diffs);
+
+  assertFalse("diff_bounded: No edits.", dmp.diff_bounded("abc", "abd", 0, diffs));
+
+  assertFalse("diff_bounded: No edits, same length.", dmp.diff_bounded(a, QString(a).replace(0, 1, "#"), 0, diffs));
+
+  // A substitution counts as a deletion plus an insertion.
+  assertTrue("diff_bounded: Substitution.", dmp.diff_bounded("cat", "map", 4, diffs));
+  assertEquals("diff_bounded: Substitution diffs.", diffList(Diff(DELETE, "c"), Diff(INSERT, "m"), Diff(EQUAL, "a"), Diff(DELETE, "t"), Diff(INSERT, "p")), diffs);
+
+  // Test null inputs.
+  try {
+    dmp.diff_bounded(NULL, NULL, 1, diffs);
+    assertFalse("diff_bounded: Null inputs.", true);
+  } catch (const char *ex) {
+    // Exception expected.
+  }
+}
+
+void diff_match_patch_test::testDiffBitLcs() {
+  // Bit-parallel LCS of short texts.
+  const DiffDeadline deadline(std::numeric_limits<clock_t>::max());
+  assertEquals("diff_bitLcs: Equality.", diffList(Diff(EQUAL, "abc")), dmp.diff_bitLcs("abc", "abc", deadline));
+
+  assertEquals("diff_bitLcs: Substitution.", diffList(Diff(DELETE, "c"), Diff(INSERT, "m"), Diff(EQUAL, "a"), Diff(DELETE, "t"), Diff(INSERT, "p")), dmp.diff_bitLcs("cat", "map", deadline));
+
+  // Equalities are matched as early as possible, as diff_bisect does.
+  assertEquals("diff_bitLcs: Overlap.", diffList(Diff(DELETE, "1"), Diff(EQUAL, "a"), Diff(DELETE, "y"), Diff(EQUAL, "b"), Diff(DELETE, "2"), Diff(INSERT, "xab")), dmp.diff_bitLcs("1ayb2", "abxab", deadline));
+
+  assertEquals("diff_bitLcs: Longer text1.", diffList(Diff(INSERT, "x"), Diff(EQUAL, "a"), Diff(DELETE, "bc"), Diff(EQUAL, "d"), Diff(DELETE, "ef")), dmp.diff_bitLcs("abcdef", "xad", deadline));
+
+  assertEquals("diff_bitLcs: Unicode.", diffList(Diff(DELETE, QString::fromUtf8("\xc3\xa9")), Diff(INSERT, QString::fromUtf8("\xe2\x82\xac")), Diff(EQUAL, "x")), dmp.diff_bitLcs(QString::fromUtf8("\xc3\xa9x"), QString::fromUtf8("\xe2\x82\xacx"), deadline));
+
+  // As minimal as diff_bisect, up to the longest text the kernel takes.
+  uint seed = 1;
+  for (int x = 0; x < 200; x++) {
+    QString a = "";
+    QString b = "";
+    const int length = x % 3 == 0 ? 64 : 1 + x % 40;
+    for (int i = 0; i < length; i++) {
+      seed = seed * 1103515245 + 12345;
+      a += QChar('a' + (seed >> 16) % 4);
+      seed = seed * 1103515245 + 12345;
+      b += QChar('a' + (seed >> 16) % 4);
+    }
+    b += a.left(x % 7);
+    const QList<Diff> diffs = dmp.diff_bitLcs(a, b, deadline);
+    assertEquals("diff_bitLcs: Round trip.", (QStringList() << a << b), diff_rebuildtexts(diffs));
+    const QList<Diff> bisect = dmp.diff_bisect(a, b, deadline);
+    int edits = 0;
+    foreach (Diff aDiff, diffs) {
+      edits += aDiff.operation == EQUAL ? 0 : aDiff.text.length();
+    }
+    foreach (Diff aDiff, bisect) {
+      edits -= aDiff.operation == EQUAL ? 0 : aDiff.text.length();
+    }
+    assertEquals("diff_bitLcs: Minimal.", 0, edits);
+  }
+
+  // The token engine takes the same kernel.
+  diff_sequence<QVector<quint32> > dmp32;
+  QVector<quint32> seq1;
+  QVector<quint32> seq2;
+  seq1 << 1 << 7 << 2 << 3;
+  seq2 << 2 << 9 << 3 << 8;
+  QList<DiffRun> runs;
+  runs << DiffRun(DELETE, 2) << DiffRun(EQUAL, 1) << DiffRun(INSERT, 1) << DiffRun(EQUAL, 1) << DiffRun(INSERT, 1);
+  assertTrue("diff_sequence: Bit-parallel LCS.", runs == dmp32.diff_main(seq1, seq2));
+}
+
+void diff_match_patch_test::testDiffPrefilter() {
+  // Estimate the similarity of texts.
+  assertTrue("diff_similarity: Equality.", dmp.diff_similarity("abc", "abc") == 1.0f);
+
+  assertTrue("diff_similarity: Null case.", dmp.diff_similarity("", "") == 1.0f);
+
+  assertTrue("diff_similarity: Empty.", dmp.diff_similarity("", "abc") == 0.0f);
+
+  assertTrue("diff_similarity: Short texts.", dmp.diff_similarity("cat", "map") == 0.0f);
+
+  // Of the substrings abcdefgh, bcdefghi, cdefghij and defghijk, two are shared.
+  assertTrue("diff_similarity: Exact.", dmp.diff_similarity("abcdefghij", "bcdefghijk") == 0.5f);
+
+  // Only what differs is compared.
+  assertTrue("diff_similarity: Common ends.", dmp.diff_similarity("abcdefghij", "abcdefghik") == 0.0f);
+
+  QString a = "";
+  QString b = "";
+  for (int x = 0; x < 300; x++) {
+    a += QString("Line %1 of the text.\n").arg(x);
+    b += QString("%1,").arg(x * 7919 % 1000);
+  }
+  assertTrue("diff_similarity: Unrelated.", dmp.diff_similarity(a, b) < 0.05f);
+  const QString edited = QString(a).replace("Line 10 ", "Row 10 ").replace("Line 290 ", "Row 290 ");
+  assertTrue("diff_similarity: Related.", dmp.diff_similarity(a, edited) > 0.9f);
+
+  // Skip diffing dissimilar texts.
+  DiffPrefilter prefilter(0.05f, 100);
+  dmp.Diff_Prefilter = &prefilter;
+  assertEquals("diff_main: Prefilter skips.", diffList(Diff(EQUAL, "L"), Diff(DELETE, a.mid(1, a.length() - 2)), Diff(INSERT, b.mid(1, b.length() - 2)), Diff(EQUAL, "\n")), dmp.diff_main(a, "L" + b.mid(1, b.length() - 2) + "\n"));
+  assertEquals("diff_main: Prefilter checked.", 1, static_cast<int>(prefilter.checked()));
+  assertEquals("diff_main: Prefilter skipped.", 1, static_cast<int>(prefilter.skipped()));
+
+  QList<Diff> diffs = dmp.diff_main(a, edited);
+  assertEquals("diff_main: Prefilter passes.", (QStringList() << a << edited), diff_rebuildtexts(diffs));
+  assertEquals("diff_main: Prefilter passes minimal.", 8, dmp.diff_levenshtein(diffs));
+  assertEquals("diff_main: Prefilter counts passes.", 2, static_cast<int>(prefilter.checked()));
+  assertEquals("diff_main: Prefilter counts skips.", 1, static_cast<int>(prefilter.skipped()));
+
+  // Short texts and short changes are diffed without a check.
+  assertEquals("diff_main: Prefilter short texts.", diffList(Diff(DELETE, "c"), Diff(INSERT, "m"), Diff(EQUAL, "a"), Diff(DELETE, "t"), Diff(INSERT, "p")), dmp.diff_main("cat", "map"));
+  diffs = diffList(Diff(EQUAL, a.left(a.indexOf("Line 150"))), Diff(DELETE, "Line"), Diff(INSERT, "Row"), Diff(EQUAL, a.mid(a.indexOf("Line 150") + 4)));
+  assertEquals("diff_main: Prefilter short change.", diffs, dmp.diff_main(a, QString(a).replace("Line 150", "Row 150")));
+  assertEquals("diff_main: Prefilter short texts unchecked.", 2, static_cast<int>(prefilter.checked()));
+
+  // A short text inside a long one is diffed without a check.
+  const QString inside = "#" + a.mid(1000, 300) + "#";
+  dmp.Diff_Prefilter = NULL;
+  diffs = dmp.diff_main(inside, a);
+  dmp.Diff_Prefilter = &prefilter;
+  assertEquals("diff_main: Prefilter contained.", diffs, dmp.diff_main(inside, a));
+  assertEquals("diff_main: Prefilter contained unchecked.", 2, static_cast<int>(prefilter.checked()));
+
+  prefilter.resetCounters();
+  assertEquals("DiffPrefilter: Reset.", 0, static_cast<int>(prefilter.checked() + prefilter.skipped()));
+  dmp.Diff_Prefilter = NULL;
+
+  // Test null inputs.
+  try {
+    dmp.diff_similarity(NULL, NULL);
+    assertFalse("diff_similarity: Null inputs.", true);
+  } catch (const char *ex) {
+    // Exception expected.
+  }
+}
+
+void diff_match_patch_test::testDiffSequence() {
+  // Diff sequences of token ids.
+  diff_sequence<QVector<quint32> > dmp32;
+  dmp32.Diff_Timeout = 0;
+  QVector<quint32> tokens1;
+  QVector<quint32> tokens2;
+  assertEquals("diff_sequence: Null case.", "", diff_runsToString(dmp32.diff_main(tokens1, tokens2)));
+
+  tokens1 << 1 << 2 << 3 << 4;
+  tokens2 << 1 << 3 << 4 << 5;
+  assertEquals("diff_sequence: Simple case.", "=1 -1 =2 +1", diff_runsToString(dmp32.diff_main(tokens1, tokens2)));
+
+  assertEquals("diff_sequence: Common prefix.", 1, dmp32.diff_commonPrefix(tokens1, tokens2));
+
+  assertEquals("diff_sequence: Common suffix.", 0, dmp32.diff_commonSuffix(tokens1, tokens2));
+
+  // Tokens give the same diff as the characters they stand for.
+  std::vector<qulonglong> hashes1;
+  std::vector<qulonglong> hashes2;
+  const QString text1 = "Apples are a fruit.";
+  const QString text2 = "Bananas are also fruit.";
+  for (int x = 0; x < text1.length(); x++) {
+    hashes1.push_back(Q_UINT64_C(0x100000000) * text1[x].unicode());
+  }
+  for (int x = 0; x < text2.length(); x++) {
+    hashes2.push_back(Q_UINT64_C(0x100000000) * text2[x].unicode());
+  }
+  diff_sequence<std::vector<qulonglong> > dmp64;
+  dmp64.Diff_Timeout = 0;
+  QList<DiffRun> runs = dmp64.diff_main(hashes1, hashes2);
+  assertEquals("diff_sequence: Hashes.", "-5 +6 =7 +3 =7", diff_runsToString(runs));
+
+  assertEquals("diff_sequence: Levenshtein.", 9, dmp64.diff_levenshtein(runs));
+
+  assertEquals("diff_sequence: Bisect.", "-5 +6 =7 +3 =7", diff_runsToString(dmp64.diff_bisect(hashes1, hashes2)));
+
+  DiffCancelToken token;
+  token.cancel();
+  dmp64.Diff_Cancel = &token;
+  assertEquals("diff_sequence: Cancelled.", "-12 +16 =7", diff_runsToString(dmp64.diff_main(hashes1, hashes2)));
+  dmp64.Diff_Cancel = NULL;
+
+  dmp64.Diff_WorkBudget = 1;
+  dmp64.Diff_Degrade = true;
+  assertEquals("diff_sequence: Degraded.", diff_runsToString(runs), diff_runsToString(dmp64.diff_main(hashes1, hashes2)));
+  dmp64.Diff_WorkBudget = 0;
+  dmp64.Diff_Degrade = false;
+
+  // Merge and shift runs as diff_cleanupMerge does.
+  diff_sequence<QString> dmpText;
+  runs.clear();
+  runs << DiffRun(EQUAL, 1) << DiffRun(INSERT, 2) << DiffRun(EQUAL, 1);
+  dmpText.diff_cleanupMerge("ac", "abac", runs);
+  assertEquals("diff_sequence: Slide edit left.", "+2 =2", diff_runsToString(runs));
+
+  runs.clear();
+  runs << DiffRun(DELETE, 1) << DiffRun(INSERT, 3) << DiffRun(DELETE, 2);
+  dmpText.diff_cleanupMerge("adc", "abc", runs);
+  assertEquals("diff_sequence: Prefix and suffix detection.", "=1 -1 +1 =1", diff_runsToString(runs));
+
+  runs.clear();
+  runs << DiffRun(EQUAL, 1) << DiffRun(DELETE, 1) << DiffRun(INSERT, 1) << DiffRun(EQUAL, 1);
+  dmpText.diff_cleanupMerge("abc", "axc", runs);
+  assertEquals("diff_sequence: No change case.", "=1 -1 +1 =1", diff_runsToString(runs));
+}
+
 
 //  MATCH TEST FUNCTIONS
 
@@ -717,6 +2034,88 @@ void diff_match_patch_test::testPatchFromText() {
   }
 }
 
+// Device which returns part of its data, then fails to read.
+class FailingDevice : public QBuffer {
+ public:
+  FailingDevice(QByteArray *data) : QBuffer(data) {}
+
+ protected:
+  qint64 readData(char *data, qint64 maxSize) {
+    if (pos() > 0) {
+      setErrorString("Read failed");
+      return -1;
+    }
+    return QBuffer::readData(data, qMin(maxSize, qint64(16)));
+  }
+};
+
+void diff_match_patch_test::testPatchReader() {
+  QBuffer device;
+  device.open(QIODevice::ReadOnly);
+  assertTrue("PatchReader: Empty.", dmp.patch_fromText(&device).isEmpty());
+  device.close();
+
+  QString strp = "@@ -21,18 +22,17 @@\n jump\n-s\n+ed\n  over \n-the\n+a\n %0Alaz\n";
+  Patch patch;
+  PatchReader reader(strp.toUtf8());
+  assertTrue("PatchReader: First patch.", reader.readPatch(patch));
+  assertEquals("PatchReader: #1.", strp, patch.toString());
+  assertFalse("PatchReader: No more patches.", reader.readPatch(patch));
+
+  strp = "@@ -1,9 +1,9 @@\n-f\n+F\n oo+fooba\n@@ -7,9 +7,9 @@\n obar\n-,\n+.\n  tes\n";
+  device.setData(strp.toUtf8());
+  device.open(QIODevice::ReadOnly);
+  assertEquals("PatchReader: Dual.", strp, dmp.patch_toText(dmp.patch_fromText(&device)));
+  device.close();
+
+  // Blank lines, a missing final newline and raw (unescaped) Unicode.
+  strp = QString("\n@@ -1 +1 @@\n\n-a\n+") + QChar((ushort)0x680) + QString("%DA%82\n@@ -3,0 +4 @@\n+b");
+  assertEquals("PatchReader: Lenient input.", dmp.patch_toText(dmp.patch_fromText(strp)), dmp.patch_toText(patch_readAll(strp)));
+
+  // Input spanning several device reads.
+  QString bigPatch;
+  for (int x = 0; x < 3000; x++) {
+    QString start = QString::number(x * 7 + 1);
+    bigPatch += "@@ -" + start + ",4 +" + start + ",5 @@\n ab\n-c%25\n+d%0A+\n x\n";
+  }
+  device.setData(bigPatch.toUtf8());
+  device.open(QIODevice::ReadOnly);
+  assertEquals("PatchReader: Large input.", dmp.patch_toText(dmp.patch_fromText(bigPatch)), dmp.patch_toText(dmp.patch_fromText(&device)));
+  device.close();
+
+  // Generates errors.
+  try {
+    patch_readAll("Bad\nPatch\n");
+    assertFalse("PatchReader: Bad header.", true);
+  } catch (QString ex) {
+    // Exception expected.
+  }
+
+  try {
+    patch_readAll("@@ -1 +1 @@\n*a\n");
+    assertFalse("PatchReader: Bad mode.", true);
+  } catch (QString ex) {
+    // Exception expected.
+  }
+
+  try {
+    patch_readAll("@@ -1 +1 @@\n-a%4\n");
+    assertFalse("PatchReader: Bad escape.", true);
+  } catch (QString ex) {
+    // Exception expected.
+  }
+  // A failed read is not the end of the input.
+  QByteArray data = QString("@@ -1 +1 @@\n-a\n+b\n@@ -5 +5 @@\n-c\n+d\n").toUtf8();
+  FailingDevice failing(&data);
+  failing.open(QIODevice::ReadOnly);
+  try {
+    dmp.patch_fromText(&failing);
+    assertFalse("PatchReader: Read error.", true);
+  } catch (QString ex) {
+    assertEquals("PatchReader: Read error message.", "Unable to read patch: Read failed", ex);
+  }
+}
+
 void diff_match_patch_test::testPatchToText() {
   QString strp = "@@ -21,18 +22,17 @@\n jump\n-s\n+ed\n  over \n-the\n+a\n  laz\n";
   QList<Patch> patches;
@@ -728,6 +2127,123 @@ void diff_match_patch_test::testPatchToText() {
   assertEquals("patch_toText: Dual", strp, dmp.patch_toText(patches));
 }
 
+void diff_match_patch_test::testPatchWriter() {
+  QByteArray bytes;
+  QBuffer device(&bytes);
+  device.open(QIODevice::WriteOnly);
+  QString strp = "@@ -1,9 +1,9 @@\n-f\n+F\n oo+fooba\n@@ -7,9 +7,9 @@\n obar\n-,\n+.\n  tes\n";
+  dmp.patch_toText(dmp.patch_fromText(strp), &device);
+  device.close();
+  assertEquals("PatchWriter: Patches.", strp, QString::fromUtf8(bytes.constData(), bytes.size()));
+
+  // Special characters, including a surrogate pair.
+  QList<Diff> diffs = diffList(Diff(EQUAL, QString::fromWCharArray((const wchar_t*) L"\u0680 \000 \t %", 7)), Diff(DELETE, QString::fromWCharArray((const wchar_t*) L"\u0681 \001 \n ^", 7)), Diff(INSERT, QString::fromWCharArray((const wchar_t*) L"\u0682 \002 \\ |", 7) + QChar((ushort)0xD83D) + QChar((ushort)0xDE00)), Diff(INSERT, "A-Z a-z 0-9 - _ . ! ~ * ' ( ) ; / ? : @ & = + $ , # "));
+  bytes.clear();
+  device.open(QIODevice::WriteOnly);
+  dmp.diff_toDelta(diffs, &device);
+  device.close();
+  assertEquals("PatchWriter: Delta.", dmp.diff_toDelta(diffs), QString::fromUtf8(bytes.constData(), bytes.size()));
+
+  QList<Patch> patches;
+  Patch p;
+  p.diffs = diffs;
+  p.length1 = 14;
+  p.length2 = 0;
+  patches << p << p;
+  bytes.clear();
+  device.open(QIODevice::WriteOnly);
+  dmp.patch_toText(patches, &device);
+  device.close();
+  assertEquals("PatchWriter: Escaped patch.", dmp.patch_toText(patches), QString::fromUtf8(bytes.constData(), bytes.size()));
+
+  // Output larger than the staging buffer.
+  QString text1;
+  QString text2;
+  for (int x = 0; x < 4000; x++) {
+    text1 += QString::number(x) + " The quick brown fox jumps over the lazy dog.\n";
+    text2 += QString::number(x) + (x % 3 ? " The quick brown fox jumps over the lazy dog.\n" : " That quick brown fox jumped over a lazy dog!\n");
+  }
+  patches = dmp.patch_make(text1, text2);
+  bytes.clear();
+  device.open(QIODevice::WriteOnly);
+  dmp.patch_toText(patches, &device);
+  device.close();
+  assertTrue("PatchWriter: Large output (setup).", bytes.size() > 64 * 1024);
+  assertEquals("PatchWriter: Large output.", dmp.patch_toText(patches), QString::fromUtf8(bytes.constData(), bytes.size()));
+}
+
+void diff_match_patch_test::testPatchBinary() {
+  assertTrue("patch_fromBinary: Empty.", dmp.patch_fromBinary(dmp.patch_toBinary(QList<Patch>())).isEmpty());
+
+  QString strp = "@@ -21,18 +22,17 @@\n jump\n-s\n+ed\n  over \n-the\n+a\n %0Alaz\n";
+  QList<Patch> patches = dmp.patch_fromText(strp);
+  assertEquals("patch_fromBinary: #1.", strp, dmp.patch_toText(dmp.patch_fromBinary(dmp.patch_toBinary(patches))));
+
+  // Rolling context makes start1 and start2 drift apart.
+  QString text1 = "The quick brown fox jumps over the lazy dog.";
+  QString text2 = QString("That quick brown fox jumped over a lazy dog.") + QChar((ushort)0x0682);
+  patches = dmp.patch_make(text1, text2);
+  strp = dmp.patch_toText(patches);
+  QByteArray data = dmp.patch_toBinary(patches);
+  assertEquals("patch_fromBinary: #2.", strp, dmp.patch_toText(dmp.patch_fromBinary(data)));
+  assertTrue("patch_toBinary: Compact.", data.size() < strp.toUtf8().size());
+
+  data = dmp.patch_toBinary(patches, text1);
+  assertEquals("patch_fromBinary: Checksum.", strp, dmp.patch_toText(dmp.patch_fromBinary(data, text1)));
+  assertEquals("patch_fromBinary: Checksum ignored.", strp, dmp.patch_toText(dmp.patch_fromBinary(data)));
+
+  // Generates errors.
+  try {
+    dmp.patch_fromBinary(data, text2);
+    assertFalse("patch_fromBinary: Wrong text.", true);
+  } catch (QString ex) {
+    // Exception expected.
+  }
+
+  try {
+    dmp.patch_fromBinary(data.left(data.size() - 1));
+    assertFalse("patch_fromBinary: Truncated.", true);
+  } catch (QString ex) {
+    // Exception expected.
+  }
+
+  try {
+    dmp.patch_fromBinary(strp.toUtf8());
+    assertFalse("patch_fromBinary: Not binary.", true);
+  } catch (QString ex) {
+    // Exception expected.
+  }
+
+  try {
+    dmp.patch_fromBinary(dmp.diff_toBinaryDelta(dmp.diff_main(text1, text2)));
+    assertFalse("patch_fromBinary: Delta.", true);
+  } catch (QString ex) {
+    // Exception expected.
+  }
+  // Varints carry no more than 32 bits.
+  const QByteArray header("DMP\x01P\0", 6);
+  try {
+    dmp.patch_fromBinary(header + QByteArray("\xFF\xFF\xFF\xFF\x1F\0\0\0\0", 9));
+    assertFalse("patch_fromBinary: Oversized varint.", true);
+  } catch (QString ex) {
+    // Exception expected.
+  }
+
+  try {
+    dmp.patch_fromBinary(header + QByteArray("\0\0\x80\x80\x80\x80\x08\0\0", 9));
+    assertFalse("patch_fromBinary: Length out of range.", true);
+  } catch (QString ex) {
+    // Exception expected.
+  }
+
+  try {
+    dmp.patch_fromBinary(header + QByteArray("\x01\0\0\0\0", 5));
+    assertFalse("patch_fromBinary: Start out of range.", true);
+  } catch (QString ex) {
+    // Exception expected.
+  }
+}
+
 void diff_match_patch_test::testPatchAddContext() {
   dmp.Patch_Margin = 4;
   Patch p;
@@ -1104,6 +2620,115 @@ void diff_match_patch_test::assertFalse(const QString &strCase, bool value) {
 }
 
 
+// Parse the UTF-8 form of text with a PatchReader.
+QList<Patch> diff_match_patch_test::patch_readAll(const QString &text) {
+  QList<Patch> patches;
+  PatchReader reader(text.toUtf8());
+  Patch patch;
+  while (reader.readPatch(patch)) {
+    patches.append(patch);
+  }
+  return patches;
+}
+
+// Write both texts to temporary files and diff them with diff_filesToDelta.
+QString diff_match_patch_test::diff_filesToDelta(const QString &text1,
+                                                 const QString &text2) {
+  QTemporaryFile file1;
+  QTemporaryFile file2;
+  if (!file1.open() || !file2.open()) {
+    qFatal("Unable to create temporary files.");
+  }
+  file1.write(text1.toUtf8());
+  file2.write(text2.toUtf8());
+  file1.close();
+  file2.close();
+  QBuffer device;
+  device.open(QIODevice::WriteOnly);
+  dmp.diff_filesToDelta(file1.fileName(), file2.fileName(), &device);
+  const QString delta = dmp.diff_filesToDelta(file1.fileName(), file2.fileName());
+  assertEquals("diff_filesToDelta: Device.", delta, QString::fromUtf8(device.data()));
+  return delta;
+}
+
+// Collects the diffs sent by diff_stream.
+class DiffCollector : public DiffSink {
+ public:
+  QList<Diff> diffs;
+  void receiveDiff(const Diff &aDiff) {
+    diffs.append(aDiff);
+  }
+};
+
+// A sequential device which only has data after waiting for it, a few
+// bytes at a time.
+class TrickleDevice : public QBuffer {
+ public:
+  TrickleDevice(QByteArray *data) : QBuffer(data), remaining(data->size()), ready(false) {}
+  bool isSequential() const {
+    return true;
+  }
+  bool waitForReadyRead(int msecs) {
+    Q_UNUSED(msecs)
+    ready = true;
+    return remaining > 0;
+  }
+
+ protected:
+  qint64 readData(char *data, qint64 maxSize) {
+    if (!ready) {
+      return 0;
+    }
+    ready = false;
+    const qint64 count = QBuffer::readData(data, qMin(maxSize, qint64(3)));
+    remaining -= count;
+    return count;
+  }
+
+ private:
+  qint64 remaining;
+  bool ready;
+};
+
+// Diff the UTF-8 forms of both texts with diff_stream, from both random
+// access and sequential devices.
+QList<Diff> diff_match_patch_test::diff_stream(const QString &text1,
+                                               const QString &text2) {
+  QByteArray bytes1 = text1.toUtf8();
+  QByteArray bytes2 = text2.toUtf8();
+  QBuffer device1(&bytes1);
+  QBuffer device2(&bytes2);
+  device1.open(QIODevice::ReadOnly);
+  device2.open(QIODevice::ReadOnly);
+  DiffCollector collector;
+  dmp.diff_stream(&device1, &device2, &collector);
+  TrickleDevice trickle1(&bytes1);
+  TrickleDevice trickle2(&bytes2);
+  trickle1.open(QIODevice::ReadOnly);
+  trickle2.open(QIODevice::ReadOnly);
+  DiffCollector trickleCollector;
+  dmp.diff_stream(&trickle1, &trickle2, &trickleCollector);
+  assertEquals("diff_stream: Sequential.", collector.diffs, trickleCollector.diffs);
+  return collector.diffs;
+}
+
+// Interleave two short poems into texts which share many lines out of order.
+void diff_match_patch_test::poemTexts(QString &a, QString &b, int rounds,
+                                      bool paragraphs) {
+  a = "`Twas brillig, and the slithy toves\nDid gyre and gimble in the wabe:\n";
+  a += paragraphs ? "\n" : "";
+  a += "All mimsy were the borogoves,\nAnd the mome raths outgrabe.\n";
+  a += paragraphs ? "\n" : "";
+  b = "I am the very model of a modern major general,\nI've information vegetable, animal, and mineral,\n";
+  b += paragraphs ? "\n" : "";
+  b += "I know the kings of England, and I quote the fights historical,\nFrom Marathon to Waterloo, in order categorical.\n";
+  b += paragraphs ? "\n" : "";
+  for (int x = 0; x < rounds; x++) {
+    a = a + b + a;
+    b = b + a + b;
+  }
+}
+
 // Construct the two texts which made up the diff originally.
 QStringList diff_match_patch_test::diff_rebuildtexts(QList<Diff> diffs) {
   QStringList text;
@@ -1119,6 +2744,16 @@ QStringList diff_match_patch_test::diff_rebuildtexts(QList<Diff> diffs) {
   return text;
 }
 
+// Describe a list of runs in the style of a delta, e.g. "=3 -2 +1".
+QString diff_match_patch_test::diff_runsToString(const QList<DiffRun> &runs) {
+  QStringList text;
+  foreach (DiffRun run, runs) {
+    const QString sign = run.operation == EQUAL ? "=" : run.operation == DELETE ? "-" : "+";
+    text << sign + QString::number(run.length);
+  }
+  return text.join(" ");
+}
+
 void diff_match_patch_test::assertEmpty(const QString &strCase, const QStringList &list) {
   if (!list.isEmpty()) {
     throw strCase;
@@ -34,6 +34,7 @@ class diff_match_patch_test {
   void testDiffHalfmatch();
   void testDiffLinesToChars();
   void testDiffCharsToLines();
+  void testDiffWordsToChars();
   void testDiffCleanupMerge();
   void testDiffCleanupSemanticLossless();
   void testDiffCleanupSemantic();
@@ -41,10 +42,31 @@ class diff_match_patch_test {
   void testDiffPrettyHtml();
   void testDiffText();
   void testDiffDelta();
+  void testDiffBinaryDelta();
+  void testDiffFilesToDelta();
+  void testDiffStream();
   void testDiffXIndex();
+  void testDiffIndex();
   void testDiffLevenshtein();
+  void testDiffEditDistance();
   void testDiffBisect();
   void testDiffMain();
+  void testDiffMainNarrow();
+  void testDiffWordMode();
+  void testDiffHierarchical();
+  void testDiffMoves();
+  void testDiffAnchorMode();
+  void testDiffDocument();
+  void testDiffCache();
+  void testDiffOptions();
+  void testDiffMany();
+  void testDiffCancel();
+  void testDiffWorkBudget();
+  void testDiffDegrade();
+  void testDiffBounded();
+  void testDiffBitLcs();
+  void testDiffPrefilter();
+  void testDiffSequence();
 
   //  MATCH TEST FUNCTIONS
   void testMatchAlphabet();
@@ -54,7 +76,10 @@ class diff_match_patch_test {
   //  PATCH TEST FUNCTIONS
   void testPatchObj();
   void testPatchFromText();
+  void testPatchReader();
   void testPatchToText();
+  void testPatchWriter();
+  void testPatchBinary();
   void testPatchAddContext();
   void testPatchMake();
   void testPatchSplitMax();
@@ -77,8 +102,18 @@ class diff_match_patch_test {
   void assertFalse(const QString &strCase, bool value);
   void assertEmpty(const QString &strCase, const QStringList &list);
 
+  // Interleave two short poems into texts which share many lines out of order.
+  void poemTexts(QString &a, QString &b, int rounds, bool paragraphs);
   // Construct the two texts which made up the diff originally.
   QStringList diff_rebuildtexts(QList<Diff> diffs);
+  // Parse the UTF-8 form of text with a PatchReader.
+  QList<Patch> patch_readAll(const QString &text);
+  // Write both texts to temporary files and diff them with diff_filesToDelta.
+  QString diff_filesToDelta(const QString &text1, const QString &text2);
+  // Diff the UTF-8 forms of both texts with diff_stream.
+  QList<Diff> diff_stream(const QString &text1, const QString &text2);
+  // Describe a list of runs in the style of a delta, e.g. "=3 -2 +1".
+  QString diff_runsToString(const QList<DiffRun> &runs);
   // Private function for quickly building lists of diffs.
   QList<Diff> diffList(
       // Diff(INSERT, NULL) is invalid and thus is used as the default argument.
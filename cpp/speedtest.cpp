@@ -0,0 +1,799 @@
+/*
+ * Copyright 2008 Google Inc. All Rights Reserved.
+ * Author: fraser@google.com (Neil Fraser)
+ * Author: mikeslemmer@gmail.com (Mike Slemmer)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Diff Match and Patch -- Speed Test
+ * http://code.google.com/p/google-diff-match-patch/
+ */
+
+#include <algorithm>
+// Code known to compile and run with Qt 4.3 through Qt 4.7.
+#include <QtCore>
+#include "diff_match_patch.h"
+
+// Usage: speedtest [Speedtest1.txt Speedtest2.txt]
+// The two sample texts default to the ones shipped with the Objective C port.
+
+
+/**
+ * Load a UTF-8 text file.
+ * @param path Name of the file.
+ * @return Contents of the file.
+ */
+static QString readFile(const QString &path) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    qFatal("Unable to read %s", qPrintable(path));
+  }
+  return QString::fromUtf8(file.readAll());
+}
+
+
+/**
+ * Report the time taken to process some data.
+ * @param name Name of the test.
+ * @param ms Elapsed time in milliseconds.
+ * @param bytes Amount of data processed.
+ */
+static void report(const char *name, int ms, qint64 bytes) {
+  const double seconds = std::max(ms, 1) / 1000.0;
+  qDebug("%-32s %6d ms %9.1f MB/s", name, ms,
+      bytes / seconds / (1024 * 1024));
+}
+
+
+/**
+ * Make up a document of 70 column lines from the words of a sample text.
+ * @param text Sample text.
+ * @param length Length of the document.
+ * @return The document.
+ */
+static QString makeDocument(const QString &text, int length) {
+  const QStringList words = text.simplified().split(" ");
+  QString doc;
+  unsigned int seed = 1;
+  int column = 0;
+  while (doc.length() < length) {
+    seed = seed * 1103515245 + 12345;
+    const QString &word = words[(seed >> 8) % words.size()];
+    doc += word;
+    column += word.length() + 1;
+    if (column > 70) {
+      doc += '\n';
+      column = 0;
+    } else {
+      doc += ' ';
+    }
+  }
+  return doc;
+}
+
+
+/**
+ * Time a full character diff of the two sample texts.
+ */
+static void speedtestDiffMain(diff_match_patch &dmp, const QString &text1,
+                              const QString &text2) {
+  QTime t;
+  t.start();
+  dmp.diff_main(text1, text2, false);
+  report("diff_main", t.elapsed(), (text1.length() + text2.length()) * 2);
+}
+
+
+/**
+ * Compare diffing QStrings with diffing the UTF-8 bytes directly.
+ */
+static void speedtestDiffUtf8(diff_match_patch &dmp, const QString &text1,
+                              const QString &text2) {
+  const QByteArray bytes1 = text1.toUtf8();
+  const QByteArray bytes2 = text2.toUtf8();
+
+  QTime t;
+  t.start();
+  const QList<Diff> diffs1 = dmp.diff_main(text1, text2, false);
+  report("diff_main(QString)", t.elapsed(), bytes1.size() + bytes2.size());
+
+  t.start();
+  const QList<Diff> diffs2 = dmp.diff_mainUtf8(bytes1, bytes2);
+  report("diff_mainUtf8", t.elapsed(), bytes1.size() + bytes2.size());
+
+  if (dmp.diff_text1(diffs2) != text1 || dmp.diff_text2(diffs2) != text2) {
+    qFatal("diff_mainUtf8: Results differ.");
+  }
+  qDebug("Levenshtein distance: %d for QString, %d for UTF-8.",
+      dmp.diff_levenshtein(diffs1), dmp.diff_levenshtein(diffs2));
+}
+
+
+/**
+ * Compare a character diff with a word diff of the sample texts, with and
+ * without character-level refinement of the replaced words.
+ */
+static void speedtestWordMode(diff_match_patch &dmp, const QString &text1,
+                              const QString &text2) {
+  const qint64 bytes = (text1.length() + text2.length()) * 2;
+
+  QTime t;
+  t.start();
+  const QList<Diff> diffs1 = dmp.diff_main(text1, text2, false);
+  report("diff_main", t.elapsed(), bytes);
+
+  t.start();
+  const QList<Diff> diffs2 = dmp.diff_wordMode(text1, text2);
+  report("diff_wordMode", t.elapsed(), bytes);
+
+  t.start();
+  const QList<Diff> diffs3 = dmp.diff_wordMode(text1, text2, true);
+  report("diff_wordMode(refine)", t.elapsed(), bytes);
+
+  if (dmp.diff_text1(diffs2) != text1 || dmp.diff_text2(diffs2) != text2
+      || dmp.diff_text1(diffs3) != text1 || dmp.diff_text2(diffs3) != text2) {
+    qFatal("diff_wordMode: Results differ.");
+  }
+  qDebug("Levenshtein distance: %d by character, %d by word, %d refined.",
+      dmp.diff_levenshtein(diffs1), dmp.diff_levenshtein(diffs2),
+      dmp.diff_levenshtein(diffs3));
+}
+
+
+/**
+ * Compare diff_main in line mode with diff_hierarchical on a large made-up
+ * document with scattered small edits, each serially and on several threads.
+ */
+static void speedtestHierarchical(diff_match_patch &dmp, const QString &text1) {
+  QString doc = makeDocument(text1, 4 * 1024 * 1024);
+  // Break the document into paragraphs of ten lines.
+  QStringList lines = doc.split('\n');
+  for (int x = 10; x < lines.size(); x += 10) {
+    lines[x].prepend('\n');
+  }
+  doc = lines.join("\n");
+  for (int x = 0; x < lines.size(); x += 50) {
+    lines[x] = lines[x].left(lines[x].length() / 2) + " edited"
+        + lines[x].mid(lines[x].length() / 2);
+  }
+  const QString edited = lines.join("\n");
+  const qint64 bytes = (doc.length() + edited.length()) * 2;
+  QList<Granularity> levels;
+  levels << PARAGRAPHS << LINES << WORDS << CHARACTERS;
+
+  QTime t;
+  t.start();
+  const QList<Diff> diffs1 = dmp.diff_main(doc, edited, true);
+  report("diff_main(checklines)", t.elapsed(), bytes);
+
+  t.start();
+  const QList<Diff> diffs2 = dmp.diff_hierarchical(doc, edited, levels);
+  report("diff_hierarchical", t.elapsed(), bytes);
+
+  const int threads = dmp.Diff_Threads;
+  dmp.Diff_Threads = QThread::idealThreadCount();
+  t.start();
+  const QList<Diff> diffs3 = dmp.diff_main(doc, edited, true);
+  report("diff_main(checklines, threads)", t.elapsed(), bytes);
+
+  t.start();
+  const QList<Diff> diffs4 = dmp.diff_hierarchical(doc, edited, levels);
+  report("diff_hierarchical(threads)", t.elapsed(), bytes);
+  dmp.Diff_Threads = threads;
+
+  if (dmp.diff_text1(diffs2) != doc || dmp.diff_text2(diffs2) != edited
+      || diffs1 != diffs3 || diffs2 != diffs4) {
+    qFatal("diff_hierarchical: Results differ.");
+  }
+  qDebug("Levenshtein distance: %d in line mode, %d hierarchical.",
+      dmp.diff_levenshtein(diffs1), dmp.diff_levenshtein(diffs2));
+}
+
+
+/**
+ * Compare line-mode diff_main with and without splitting on unique lines,
+ * on a large made-up document with lines changed, added and removed.
+ */
+static void speedtestAnchors(diff_match_patch &dmp, const QString &text1) {
+  const QString doc = makeDocument(text1, 4 * 1024 * 1024);
+  const QStringList lines = doc.split('\n');
+  QStringList editedLines;
+  for (int x = 0; x < lines.size(); x++) {
+    if (x % 89 == 0) {
+      editedLines.append("An added line.");
+    }
+    if (x % 97 == 0) {
+      continue;
+    }
+    editedLines.append(x % 50 == 0 ? lines[x] + " edited" : lines[x]);
+  }
+  const QString edited = editedLines.join("\n");
+  const qint64 bytes = (doc.length() + edited.length()) * 2;
+
+  QTime t;
+  t.start();
+  const QList<Diff> diffs1 = dmp.diff_main(doc, edited, true);
+  report("diff_main(checklines)", t.elapsed(), bytes);
+
+  dmp.Diff_AnchorLines = 1000;
+  t.start();
+  const QList<Diff> diffs2 = dmp.diff_main(doc, edited, true);
+  report("diff_main(anchors)", t.elapsed(), bytes);
+
+  const int threads = dmp.Diff_Threads;
+  dmp.Diff_Threads = QThread::idealThreadCount();
+  t.start();
+  const QList<Diff> diffs3 = dmp.diff_main(doc, edited, true);
+  report("diff_main(anchors, threads)", t.elapsed(), bytes);
+  dmp.Diff_Threads = threads;
+  dmp.Diff_AnchorLines = 0;
+
+  if (dmp.diff_text1(diffs2) != doc || dmp.diff_text2(diffs2) != edited
+      || diffs2 != diffs3) {
+    qFatal("diff_main(anchors): Results differ.");
+  }
+  qDebug("Levenshtein distance: %d in line mode, %d anchored.",
+      dmp.diff_levenshtein(diffs1), dmp.diff_levenshtein(diffs2));
+}
+
+
+/**
+ * Compare diffing one base against many revisions with diff_main(QString)
+ * and with a DiffDocument prepared once.
+ */
+static void speedtestDocument(diff_match_patch &dmp, const QString &text1) {
+  const QString doc = makeDocument(text1, 1024 * 1024);
+  const QStringList lines = doc.split('\n');
+  QStringList revisions;
+  for (int r = 0; r < 50; r++) {
+    // Each revision changes a handful of lines.
+    QStringList editedLines = lines;
+    for (int x = r * 7; x < editedLines.size(); x += 1000 + r) {
+      editedLines[x] += " revision " + QString::number(r);
+    }
+    revisions.append(editedLines.join("\n"));
+  }
+  const qint64 bytes = (doc.length() * 2) * 2 * revisions.size();
+
+  QTime t;
+  t.start();
+  QList<QList<Diff> > diffs1;
+  foreach (const QString &revision, revisions) {
+    diffs1.append(dmp.diff_main(doc, revision, true));
+  }
+  report("diff_main x50", t.elapsed(), bytes);
+
+  t.start();
+  const DiffDocument base(doc);
+  QList<QList<Diff> > diffs2;
+  foreach (const QString &revision, revisions) {
+    diffs2.append(dmp.diff_main(base, revision));
+  }
+  report("diff_main(DiffDocument) x50", t.elapsed(), bytes);
+
+  for (int r = 0; r < revisions.size(); r++) {
+    if (dmp.diff_text2(diffs2[r]) != revisions[r]
+        || dmp.diff_levenshtein(diffs1[r]) != dmp.diff_levenshtein(diffs2[r])) {
+      qFatal("diff_main(DiffDocument): Results differ.");
+    }
+  }
+}
+
+
+/**
+ * Compare diff_main with and without the block-move pre-pass on a document
+ * whose sections have been shuffled, under a one second timeout.
+ */
+static void speedtestMoves(diff_match_patch &dmp, const QString &text1) {
+  const QString doc = makeDocument(text1, 1024 * 1024);
+  // Cut the document into 16 sections and move every fourth to the end.
+  const int size = doc.length() / 16;
+  QString moved;
+  QString kept;
+  for (int x = 0; x < 16; x++) {
+    (x % 4 == 1 ? moved : kept) += doc.mid(x * size, x == 15 ? -1 : size);
+  }
+  const QString edited = kept + moved;
+  const qint64 bytes = (doc.length() + edited.length()) * 2;
+  const float timeout = dmp.Diff_Timeout;
+  dmp.Diff_Timeout = 1;
+
+  QTime t;
+  t.start();
+  const QList<Diff> diffs1 = dmp.diff_main(doc, edited, false);
+  report("diff_main", t.elapsed(), bytes);
+
+  t.start();
+  const QList<Diff> diffs3 = dmp.diff_main(doc, edited, true);
+  report("diff_main(checklines)", t.elapsed(), bytes);
+
+  dmp.Diff_MoveBlockSize = 64;
+  QList<DiffMove> moves;
+  t.start();
+  const QList<Diff> diffs2 = dmp.diff_moves(doc, edited, moves);
+  report("diff_moves", t.elapsed(), bytes);
+  dmp.Diff_MoveBlockSize = 0;
+  dmp.Diff_Timeout = timeout;
+
+  if (dmp.diff_text1(diffs2) != doc || dmp.diff_text2(diffs2) != edited) {
+    qFatal("diff_moves: Results differ.");
+  }
+  qDebug("Delta size: %d by character, %d by line, %d with the pre-pass.",
+      dmp.diff_toDelta(diffs1).length(), dmp.diff_toDelta(diffs3).length(),
+      dmp.diff_toDelta(diffs2).length());
+  qDebug("%d moves found.", moves.size());
+}
+
+
+/**
+ * Compare repeated diff_main calls on the same pair with and without a
+ * DiffCache.
+ */
+static void speedtestCache(diff_match_patch &dmp, const QString &text1,
+                           const QString &text2) {
+  const qint64 bytes = (text1.length() + text2.length()) * 2 * 20;
+
+  QTime t;
+  t.start();
+  for (int x = 0; x < 20; x++) {
+    dmp.diff_main(text1, text2);
+  }
+  report("diff_main x20", t.elapsed(), bytes);
+
+  DiffCache cache;
+  dmp.Diff_Cache = &cache;
+  t.start();
+  for (int x = 0; x < 20; x++) {
+    dmp.diff_main(text1, text2);
+  }
+  report("diff_main x20 (cached)", t.elapsed(), bytes);
+  dmp.Diff_Cache = NULL;
+  qDebug("%lld hits, %lld misses, %d bytes cached.", cache.hits(),
+      cache.misses(), cache.totalBytes());
+}
+
+
+/**
+ * Compare a diff bounded by Diff_Timeout with one bounded by a work budget,
+ * which gives the same result on every run.
+ */
+static void speedtestWorkBudget(diff_match_patch &dmp, const QString &text1,
+                                const QString &text2) {
+  const qint64 bytes = (text1.length() + text2.length()) * 2;
+  const float timeout = dmp.Diff_Timeout;
+  dmp.Diff_Timeout = 0.1f;
+  QTime t;
+  t.start();
+  const QList<Diff> diffs1 = dmp.diff_main(text1, text2, false);
+  report("diff_main (0.1 s timeout)", t.elapsed(), bytes);
+
+  dmp.Diff_Timeout = 0;
+  dmp.Diff_WorkBudget = 10 * 1000 * 1000;
+  t.start();
+  const QList<Diff> diffs2 = dmp.diff_main(text1, text2, false);
+  report("diff_main (work budget)", t.elapsed(), bytes);
+  if (dmp.diff_main(text1, text2, false) != diffs2) {
+    qFatal("diff_main: Work budget not repeatable.");
+  }
+  dmp.Diff_WorkBudget = 0;
+  dmp.Diff_Timeout = timeout;
+  qDebug("Levenshtein distance: %d with the timeout, %d with the budget.",
+      dmp.diff_levenshtein(diffs1), dmp.diff_levenshtein(diffs2));
+}
+
+
+/**
+ * Compare the delta of a character diff which runs out of time with and
+ * without Diff_Degrade.
+ */
+static void speedtestDegrade(diff_match_patch &dmp, const QString &text1) {
+  const QString doc = makeDocument(text1, 256 * 1024);
+  QStringList lines = doc.split('\n');
+  for (int x = 0; x < lines.size(); x += 13) {
+    lines[x] = lines[x].toUpper();
+  }
+  const QString edited = lines.join("\n");
+  const qint64 bytes = (doc.length() + edited.length()) * 2;
+  const float timeout = dmp.Diff_Timeout;
+  dmp.Diff_Timeout = 0.1f;
+
+  QTime t;
+  t.start();
+  const QList<Diff> diffs1 = dmp.diff_main(doc, edited, false);
+  report("diff_main (0.1 s timeout)", t.elapsed(), bytes);
+
+  dmp.Diff_Degrade = true;
+  t.start();
+  const QList<Diff> diffs2 = dmp.diff_main(doc, edited, false);
+  report("diff_main (degraded)", t.elapsed(), bytes);
+  dmp.Diff_Degrade = false;
+  dmp.Diff_Timeout = timeout;
+
+  if (dmp.diff_text1(diffs2) != doc || dmp.diff_text2(diffs2) != edited) {
+    qFatal("diff_main(Diff_Degrade): Results differ.");
+  }
+  qDebug("Delta size: %d timed out, %d degraded.",
+      dmp.diff_toDelta(diffs1).length(), dmp.diff_toDelta(diffs2).length());
+}
+
+
+/**
+ * Compare diff_main() with diff_bounded() on two near-identical documents.
+ */
+static void speedtestBounded(diff_match_patch &dmp, const QString &text1) {
+  const QString doc = makeDocument(text1, 1024 * 1024);
+  QString edited = doc;
+  for (int x = 1000; x < edited.length(); x += 50 * 1000) {
+    edited[x] = edited[x] == QChar('x') ? QChar('y') : QChar('x');
+  }
+  const qint64 bytes = (doc.length() + edited.length()) * 2;
+
+  QTime t;
+  t.start();
+  const QList<Diff> diffs1 = dmp.diff_main(doc, edited, false);
+  report("diff_main", t.elapsed(), bytes);
+
+  QList<Diff> diffs2;
+  t.start();
+  const bool within = dmp.diff_bounded(doc, edited, 64, diffs2);
+  report("diff_bounded (64 edits)", t.elapsed(), bytes);
+  if (!within || diffs1 != diffs2) {
+    qFatal("diff_bounded: Results differ.");
+  }
+
+  t.start();
+  if (dmp.diff_bounded(doc, edited, 16, diffs2)) {
+    qFatal("diff_bounded: Bound not detected.");
+  }
+  report("diff_bounded (16 edits, exceeded)", t.elapsed(), bytes);
+}
+
+
+/**
+ * Time workloads made of many short diffs, which diff_compute() hands to
+ * the bit-parallel LCS kernel: short line pairs, and a line-mode diff whose
+ * replaced lines are rediffed character by character.
+ */
+static void speedtestBitLcs(diff_match_patch &dmp, const QString &text1) {
+  const QStringList lines = makeDocument(text1, 512 * 1024).split('\n');
+  QStringList edited = lines;
+  unsigned int seed = 1;
+  for (int x = 0; x < edited.size(); x++) {
+    QStringList words = edited[x].split(' ');
+    seed = seed * 1103515245 + 12345;
+    words.swap((seed >> 8) % words.size(), (seed >> 16) % words.size());
+    seed = seed * 1103515245 + 12345;
+    words[(seed >> 8) % words.size()] = words[(seed >> 16) % words.size()];
+    edited[x] = words.join(" ");
+  }
+
+  qint64 bytes = 0;
+  QTime t;
+  t.start();
+  for (int x = 0; x < lines.size(); x++) {
+    dmp.diff_main(lines[x], edited[x], false);
+    bytes += (lines[x].length() + edited[x].length()) * 2;
+  }
+  report("diff_main (short lines)", t.elapsed(), bytes);
+
+  // Edit every fourth line of the document, for a line-mode rediff.
+  QStringList mixed = lines;
+  for (int x = 0; x < mixed.size(); x += 4) {
+    mixed[x] = edited[x];
+  }
+  const QString doc1 = lines.join("\n");
+  const QString doc2 = mixed.join("\n");
+  t.start();
+  const QList<Diff> diffs = dmp.diff_main(doc1, doc2, true);
+  report("diff_main (line mode)", t.elapsed(),
+         (doc1.length() + doc2.length()) * 2);
+  if (dmp.diff_text1(diffs) != doc1 || dmp.diff_text2(diffs) != doc2) {
+    qFatal("diff_main: Results differ.");
+  }
+}
+
+
+/**
+ * Compare scoring pairs of texts with diff_levenshtein(), which needs a
+ * diff, with diff_editDistance(), with and without a bound.
+ */
+static void speedtestEditDistance(diff_match_patch &dmp, const QString &text1,
+                                  const QString &text2) {
+  const int length = 2000;
+  const int pairs = 100;
+  const int step = qMax(1, (qMin(text1.length(), text2.length()) - length)
+                           / pairs);
+  const qint64 bytes = qint64(pairs) * length * 2 * 2;
+
+  QTime t;
+  t.start();
+  qint64 total1 = 0;
+  for (int x = 0; x < pairs; x++) {
+    total1 += dmp.diff_levenshtein(dmp.diff_main(text1.mid(x * step, length),
+        text2.mid(x * step, length), false));
+  }
+  report("diff_levenshtein(diff_main)", t.elapsed(), bytes);
+
+  t.start();
+  qint64 total2 = 0;
+  for (int x = 0; x < pairs; x++) {
+    total2 += dmp.diff_editDistance(text1.mid(x * step, length),
+                                    text2.mid(x * step, length));
+  }
+  report("diff_editDistance", t.elapsed(), bytes);
+
+  t.start();
+  int near = 0;
+  for (int x = 0; x < pairs; x++) {
+    if (dmp.diff_editDistance(text1.mid(x * step, length),
+                              text2.mid(x * step, length), 100) != -1) {
+      near++;
+    }
+  }
+  report("diff_editDistance (bound 100)", t.elapsed(), bytes);
+  qDebug("Total distance: %lld from diffs, %lld exact; %d pairs within 100.",
+      total1, total2, near);
+}
+
+
+/**
+ * Compare diffing a mix of related and unrelated pairs of texts with and
+ * without a DiffPrefilter.
+ */
+static void speedtestPrefilter(diff_match_patch &dmp, const QString &text1,
+                               const QString &text2) {
+  typedef QPair<QString, QString> TextPair;
+  const int length = 4000;
+  const int pairs = 20;
+  const int step = qMax(1, (qMin(text1.length(), text2.length()) - length)
+                           / pairs);
+  // Unrelated pairs set a text against encoded binary data.
+  const char *digits =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  unsigned int seed = 1;
+  QList<TextPair> related;
+  QList<TextPair> unrelated;
+  for (int x = 0; x < pairs; x++) {
+    QString data;
+    for (int i = 0; i < length; i++) {
+      seed = seed * 1103515245 + 12345;
+      data += QChar(digits[(seed >> 16) % 64]);
+    }
+    related.append(TextPair(text1.mid(x * step, length),
+                            text2.mid(x * step, length)));
+    unrelated.append(TextPair(text1.mid(x * step, length), data));
+  }
+  const qint64 bytes = qint64(pairs) * length * 2 * 2 * 2;
+  float lowest = 1.0f;
+  float highest = 0.0f;
+  foreach (const TextPair &pair, related) {
+    lowest = qMin(lowest, dmp.diff_similarity(pair.first, pair.second));
+  }
+  foreach (const TextPair &pair, unrelated) {
+    highest = qMax(highest, dmp.diff_similarity(pair.first, pair.second));
+  }
+
+  const float timeout = dmp.Diff_Timeout;
+  dmp.Diff_Timeout = 1.0f;
+  QTime t;
+  t.start();
+  for (int x = 0; x < pairs; x++) {
+    dmp.diff_main(related[x].first, related[x].second);
+    dmp.diff_main(unrelated[x].first, unrelated[x].second);
+  }
+  report("diff_main (mixed pairs)", t.elapsed(), bytes);
+
+  DiffPrefilter prefilter;
+  dmp.Diff_Prefilter = &prefilter;
+  t.start();
+  for (int x = 0; x < pairs; x++) {
+    dmp.diff_main(related[x].first, related[x].second);
+    dmp.diff_main(unrelated[x].first, unrelated[x].second);
+  }
+  report("diff_main (prefiltered)", t.elapsed(), bytes);
+  dmp.Diff_Prefilter = NULL;
+  dmp.Diff_Timeout = timeout;
+  qDebug("Similarity: at least %.3f related, at most %.3f unrelated; "
+      "%lld of %lld pairs skipped.", lowest, highest, prefilter.skipped(),
+      prefilter.checked());
+}
+
+
+/**
+ * Compare diffing thousands of small pairs one at a time with diff_many()
+ * on every available thread.
+ */
+static void speedtestMany(diff_match_patch &dmp, const QString &text1,
+                          const QString &text2) {
+  typedef QPair<QString, QString> TextPair;
+  QList<TextPair> pairs;
+  qint64 bytes = 0;
+  const int length = qMax(1, qMin(text1.length(), text2.length()) - 400);
+  for (int x = 0; x < 5000; x++) {
+    const int start = (x * 7919) % length;
+    pairs.append(TextPair(text1.mid(start, 200), text2.mid(start, 200)));
+    bytes += (pairs.last().first.length() + pairs.last().second.length()) * 2;
+  }
+
+  QTime t;
+  t.start();
+  QList<QList<Diff> > diffs1;
+  foreach (const TextPair &pair, pairs) {
+    diffs1.append(dmp.diff_main(pair.first, pair.second));
+  }
+  report("diff_main x5000", t.elapsed(), bytes);
+
+  dmp.Diff_Threads = QThread::idealThreadCount();
+  t.start();
+  const QList<QList<Diff> > diffs2 = dmp.diff_many(pairs);
+  report("diff_many x5000", t.elapsed(), bytes);
+  dmp.Diff_Threads = 1;
+
+  for (int x = 0; x < pairs.size(); x++) {
+    if (dmp.diff_text2(diffs2[x]) != pairs[x].second) {
+      qFatal("diff_many: Results differ.");
+    }
+  }
+  qDebug("%d threads.", QThread::idealThreadCount());
+}
+
+
+/**
+ * Compare patch_fromText(QString) with the streaming PatchReader on a
+ * multi-megabyte patch.
+ */
+static void speedtestPatchFromText(diff_match_patch &dmp,
+                                   const QString &text1,
+                                   const QString &text2) {
+  const QString onePatch = dmp.patch_toText(dmp.patch_make(text1, text2));
+  QString patchText;
+  while (patchText.length() < 8 * 1024 * 1024) {
+    patchText += onePatch;
+  }
+  QByteArray patchBytes = patchText.toUtf8();
+
+  QTime t;
+  t.start();
+  QList<Patch> patches1 = dmp.patch_fromText(patchText);
+  report("patch_fromText(QString)", t.elapsed(), patchBytes.size());
+
+  t.start();
+  QBuffer device(&patchBytes);
+  device.open(QIODevice::ReadOnly);
+  QList<Patch> patches2 = dmp.patch_fromText(&device);
+  report("patch_fromText(QIODevice)", t.elapsed(), patchBytes.size());
+
+  if (dmp.patch_toText(patches1) != dmp.patch_toText(patches2)) {
+    qFatal("patch_fromText: Results differ.");
+  }
+}
+
+
+/**
+ * Compare patch_toText(QString) with writing straight to a device.
+ */
+static void speedtestPatchToText(diff_match_patch &dmp, const QString &text1,
+                                 const QString &text2) {
+  const QList<Patch> onePatch = dmp.patch_make(text1, text2);
+  QList<Patch> patches;
+  while (patches.size() < 20000) {
+    patches += onePatch;
+  }
+
+  QTime t;
+  t.start();
+  const QByteArray bytes1 = dmp.patch_toText(patches).toUtf8();
+  report("patch_toText(QString)", t.elapsed(), bytes1.size());
+
+  t.start();
+  QByteArray bytes2;
+  QBuffer device(&bytes2);
+  device.open(QIODevice::WriteOnly);
+  dmp.patch_toText(patches, &device);
+  report("patch_toText(QIODevice)", t.elapsed(), bytes2.size());
+
+  if (bytes1 != bytes2) {
+    qFatal("patch_toText: Results differ.");
+  }
+}
+
+
+/**
+ * Compare the size and speed of the text and binary patch and delta formats.
+ */
+static void speedtestBinary(diff_match_patch &dmp, const QString &text1,
+                            const QString &text2) {
+  const QList<Patch> onePatch = dmp.patch_make(text1, text2);
+  QList<Patch> patches;
+  while (patches.size() < 20000) {
+    patches += onePatch;
+  }
+  const QList<Diff> diffs = dmp.diff_main(text1, text2, false);
+  const int rounds = 200;
+
+  QTime t;
+  t.start();
+  const QString patchText = dmp.patch_toText(patches);
+  report("patch_toText", t.elapsed(), patchText.toUtf8().size());
+  t.start();
+  const QByteArray patchBinary = dmp.patch_toBinary(patches);
+  report("patch_toBinary", t.elapsed(), patchBinary.size());
+  t.start();
+  dmp.patch_fromText(patchText);
+  report("patch_fromText", t.elapsed(), patchText.toUtf8().size());
+  t.start();
+  const QList<Patch> decoded = dmp.patch_fromBinary(patchBinary);
+  report("patch_fromBinary", t.elapsed(), patchBinary.size());
+  if (dmp.patch_toText(decoded) != patchText) {
+    qFatal("patch_fromBinary: Results differ.");
+  }
+
+  QString delta;
+  t.start();
+  for (int x = 0; x < rounds; x++) {
+    delta = dmp.diff_toDelta(diffs);
+  }
+  report("diff_toDelta", t.elapsed(), delta.toUtf8().size() * rounds);
+  QByteArray binaryDelta;
+  t.start();
+  for (int x = 0; x < rounds; x++) {
+    binaryDelta = dmp.diff_toBinaryDelta(diffs);
+  }
+  report("diff_toBinaryDelta", t.elapsed(), binaryDelta.size() * rounds);
+  t.start();
+  for (int x = 0; x < rounds; x++) {
+    dmp.diff_fromDelta(text1, delta);
+  }
+  report("diff_fromDelta", t.elapsed(), delta.toUtf8().size() * rounds);
+  t.start();
+  for (int x = 0; x < rounds; x++) {
+    dmp.diff_fromBinaryDelta(text1, binaryDelta);
+  }
+  report("diff_fromBinaryDelta", t.elapsed(), binaryDelta.size() * rounds);
+
+  qDebug("Patch size: %d bytes as text, %d bytes as binary.",
+      patchText.toUtf8().size(), patchBinary.size());
+  qDebug("Delta size: %d bytes as text, %d bytes as binary.",
+      delta.toUtf8().size(), binaryDelta.size());
+}
+
+
+int main(int argc, char **argv) {
+  const QString text1 = readFile(argc > 2 ? QString(argv[1])
+      : QString("../objectivec/Speedtest1.txt"));
+  const QString text2 = readFile(argc > 2 ? QString(argv[2])
+      : QString("../objectivec/Speedtest2.txt"));
+
+  diff_match_patch dmp;
+  dmp.Diff_Timeout = 0;
+
+  speedtestDiffMain(dmp, text1, text2);
+  speedtestDiffUtf8(dmp, text1, text2);
+  speedtestWordMode(dmp, text1, text2);
+  speedtestHierarchical(dmp, text1);
+  speedtestAnchors(dmp, text1);
+  speedtestMoves(dmp, text1);
+  speedtestDocument(dmp, text1);
+  speedtestCache(dmp, text1, text2);
+  speedtestMany(dmp, text1, text2);
+  speedtestWorkBudget(dmp, text1, text2);
+  speedtestDegrade(dmp, text1);
+  speedtestBounded(dmp, text1);
+  speedtestBitLcs(dmp, text1);
+  speedtestEditDistance(dmp, text1, text2);
+  speedtestPrefilter(dmp, text1, text2);
+  speedtestPatchFromText(dmp, text1, text2);
+  speedtestPatchToText(dmp, text1, text2);
+  speedtestBinary(dmp, text1, text2);
+  return 0;
+}
@@ -0,0 +1,13 @@
+# Speed test for diff_match_patch.
+# Run from this directory so that the sample texts can be found.
+TEMPLATE = app
+TARGET = speedtest
+CONFIG += qt release
+
+mac {
+  CONFIG -= app_bundle
+}
+
+HEADERS = diff_match_patch.h diff_match_patch_core.h
+
+SOURCES = diff_match_patch.cpp speedtest.cpp